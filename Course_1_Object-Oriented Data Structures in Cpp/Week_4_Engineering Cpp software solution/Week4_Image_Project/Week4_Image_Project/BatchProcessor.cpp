@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "Pipeline.h"
+#include "BatchProcessor.h"
+
+namespace {
+  // One image on its way through the batch
+  struct BatchItem {
+    std::string output;
+    PNG image;
+  };
+
+  std::vector<std::string> split(std::string const & text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) { parts.push_back(part); }
+    return parts;
+  }
+
+  bool parseInt(std::string const & text, int & value) {
+    char * end = NULL;
+    errno = 0;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) { return false; }
+    value = static_cast<int>(parsed);
+    return true;
+  }
+
+  bool endsWith(std::string const & text, std::string const & suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+  }
+
+  std::string baseName(std::string const & path) {
+    std::size_t slash = path.find_last_of('/');
+    return (slash == std::string::npos) ? path : path.substr(slash + 1);
+  }
+}
+
+/*
+ * TransformSpec
+ */
+
+TransformSpec::TransformSpec() { }
+
+bool TransformSpec::parse(std::string const & spec) {
+  stages_.clear();
+
+  std::vector<std::string> stages = split(spec, ',');
+  for (std::string const & stage : stages) {
+    std::vector<std::string> fields = split(stage, ':');
+    std::string name = fields.empty() ? "" : fields[0];
+    int x = 0, y = 0;
+
+    if (name == "grayscale" && fields.size() == 1) {
+      stages_.push_back([](Pipeline & pipeline) { pipeline.grayscale(); });
+    } else if (name == "illinify" && fields.size() == 1) {
+      stages_.push_back([](Pipeline & pipeline) { pipeline.illinify(); });
+    } else if (name == "spotlight" && fields.size() == 3 && parseInt(fields[1], x) && parseInt(fields[2], y)) {
+      stages_.push_back([=](Pipeline & pipeline) { pipeline.spotlight(x, y); });
+    } else if (name == "watermark" && (fields.size() == 2 ||
+               (fields.size() == 4 && parseInt(fields[2], x) && parseInt(fields[3], y)))) {
+      std::shared_ptr<PNG> stencil = std::make_shared<PNG>();
+      if (!stencil->readFromFile(fields[1])) {
+        std::cerr << "Could not read watermark stencil " << fields[1] << std::endl;
+        stages_.clear();
+        return false;
+      }
+      std::shared_ptr<PNG const> shared = stencil;
+      stages_.push_back([=](Pipeline & pipeline) { pipeline.watermark(shared, x, y); });
+    } else {
+      std::cerr << "Invalid transform stage \"" << stage << "\"" << std::endl;
+      stages_.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::size_t TransformSpec::size() const {
+  return stages_.size();
+}
+
+PNG TransformSpec::apply(PNG image) const {
+  Pipeline pipeline(std::move(image));
+  for (auto const & stage : stages_) { stage(pipeline); }
+  return pipeline.run();
+}
+
+/*
+ * Batches
+ */
+
+BatchOptions::BatchOptions() : queueCapacity(4) {
+  // compression is usually the slowest stage, so it gets the spare threads
+  unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+  decodeThreads = std::max(1u, hardware / 4);
+  transformThreads = std::max(1u, hardware / 4);
+  encodeThreads = std::max(1u, hardware - (hardware / 4) * 2);
+}
+
+double BatchReport::imagesPerSecond() const {
+  return (seconds > 0) ? processed / seconds : 0.0;
+}
+
+bool listBatchInputs(std::string const & path, std::vector<std::string> & inputs) {
+  inputs.clear();
+
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    std::cerr << "Could not find " << path << std::endl;
+    return false;
+  }
+
+  if (S_ISDIR(info.st_mode)) {
+    DIR * dir = opendir(path.c_str());
+    if (dir == NULL) {
+      std::cerr << "Could not open directory " << path << std::endl;
+      return false;
+    }
+    for (dirent * entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      if (endsWith(name, ".png")) { inputs.push_back(path + "/" + name); }
+    }
+    closedir(dir);
+    std::sort(inputs.begin(), inputs.end());
+    return true;
+  }
+
+  std::ifstream manifest(path.c_str());
+  if (!manifest) {
+    std::cerr << "Could not open manifest " << path << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(manifest, line)) {
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    line.erase(0, line.find_first_not_of(" \t"));
+    if (!line.empty() && line[0] != '#') { inputs.push_back(line); }
+  }
+  return true;
+}
+
+BatchReport runBatch(std::vector<std::string> const & inputs, std::string const & outputDirectory,
+                     TransformSpec const & spec, BatchOptions const & options) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  BoundedQueue<BatchItem> decoded(options.queueCapacity);
+  BoundedQueue<BatchItem> transformed(options.queueCapacity);
+  std::atomic<unsigned> nextInput(0), processed(0), failed(0);
+
+  // inputs with the same name would be written to the same output file by
+  // two encoders at once, so only the first of them is processed
+  std::vector<std::string> outputs(inputs.size());
+  std::map<std::string, std::string> writers;
+  for (unsigned index = 0; index < inputs.size(); index++) {
+    std::string output = outputDirectory + "/" + baseName(inputs[index]);
+    auto writer = writers.insert(std::make_pair(output, inputs[index]));
+    if (writer.second) {
+      outputs[index] = output;
+    } else {
+      std::cerr << "Skipping " << inputs[index] << ": " << output << " is already the output of "
+                << writer.first->second << std::endl;
+      failed++;
+    }
+  }
+
+  std::vector<std::thread> decoders, transformers, encoders;
+  for (unsigned i = 0; i < std::max(1u, options.decodeThreads); i++) {
+    decoders.push_back(std::thread([&] {
+      for (unsigned index = nextInput++; index < inputs.size(); index = nextInput++) {
+        if (outputs[index].empty()) { continue; }
+        BatchItem item;
+        item.output = outputs[index];
+        if (!item.image.readFromFile(inputs[index])) {
+          failed++;
+          continue;
+        }
+        decoded.push(std::move(item));
+      }
+    }));
+  }
+
+  for (unsigned i = 0; i < std::max(1u, options.transformThreads); i++) {
+    transformers.push_back(std::thread([&] {
+      BatchItem item;
+      while (decoded.pop(item)) {
+        item.image = spec.apply(std::move(item.image));
+        transformed.push(std::move(item));
+      }
+    }));
+  }
+
+  for (unsigned i = 0; i < std::max(1u, options.encodeThreads); i++) {
+    encoders.push_back(std::thread([&] {
+      BatchItem item;
+      while (transformed.pop(item)) {
+        if (item.image.writeToFile(item.output, options.encoder)) { processed++; } else { failed++; }
+      }
+    }));
+  }
+
+  // each stage ends once the stage before it is done and its queue is empty
+  for (std::thread & thread : decoders) { thread.join(); }
+  decoded.close();
+  for (std::thread & thread : transformers) { thread.join(); }
+  transformed.close();
+  for (std::thread & thread : encoders) { thread.join(); }
+
+  BatchReport report;
+  report.processed = processed;
+  report.failed = failed;
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return report;
+}
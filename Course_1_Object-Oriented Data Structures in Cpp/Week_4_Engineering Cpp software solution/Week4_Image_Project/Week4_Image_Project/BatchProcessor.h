@@ -0,0 +1,173 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "Pipeline.h"
+using namespace uiuc;
+
+/**
+ * A first-in first-out queue between threads that holds at most `capacity`
+ * items. push waits while the queue is full and pop waits while it is
+ * empty, so a fast producer cannot run arbitrarily far ahead of a slow
+ * consumer.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity == 0 ? 1 : capacity), closed_(false) { }
+
+  /**
+   * Adds an item, waiting for room if the queue is full.
+   * @return false if the queue was closed, in which case `item` is dropped.
+   */
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notFull_.wait(lock, [this] { return items_.size() < capacity_ || closed_; });
+    if (closed_) { return false; }
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  /**
+   * Takes the oldest item, waiting for one if the queue is empty.
+   * @return false once the queue is closed and empty.
+   */
+  bool pop(T & item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    notEmpty_.wait(lock, [this] { return !items_.empty() || closed_; });
+    if (items_.empty()) { return false; }
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  /**
+   * Closes the queue: no more items can be pushed, and pop returns false
+   * once the remaining items are taken.
+   */
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+  }
+
+private:
+  std::size_t capacity_;                  /*< Maximum number of items */
+  bool closed_;                           /*< Whether close was called */
+  std::deque<T> items_;                   /*< The items, oldest first */
+  std::mutex mutex_;                      /*< Guards everything above */
+  std::condition_variable notFull_;       /*< Signals pushers that there is room */
+  std::condition_variable notEmpty_;      /*< Signals poppers that there is an item */
+};
+
+/**
+ * A sequence of transforms parsed from a text spec, applied to each image
+ * of a batch as one fused Pipeline pass. The spec is a comma-separated list
+ * of stages:
+ *
+ *   grayscale
+ *   illinify
+ *   spotlight:X:Y
+ *   watermark:STENCIL.png[:X:Y]
+ *
+ * e.g. "grayscale,spotlight:450:150,watermark:overlay.png". Watermark
+ * stencils are read once when the spec is parsed and shared by all images.
+ */
+class TransformSpec {
+public:
+  /**
+   * Creates a spec with no stages.
+   */
+  TransformSpec();
+
+  /**
+   * Parses a spec, replacing any current stages.
+   * @param spec The spec text.
+   * @return true, if every stage was valid (otherwise a message is
+   *         printed to cerr).
+   */
+  bool parse(std::string const & spec);
+
+  /**
+   * Gets the number of stages.
+   */
+  std::size_t size() const;
+
+  /**
+   * Applies every stage to an image.
+   * @param image The image to be transformed.
+   * @return The transformed image.
+   */
+  PNG apply(PNG image) const;
+
+private:
+  std::vector<std::function<void(Pipeline &)>> stages_;   /*< Adds each stage to a pipeline */
+};
+
+/**
+ * Settings of runBatch.
+ */
+struct BatchOptions {
+  unsigned int decodeThreads;       /*< Threads reading and decoding input files */
+  unsigned int transformThreads;    /*< Threads applying the transforms */
+  unsigned int encodeThreads;       /*< Threads encoding and writing output files */
+  unsigned int queueCapacity;       /*< Images that may wait between two stages */
+  PNGEncoderOptions encoder;        /*< Settings for the output files */
+
+  BatchOptions();
+};
+
+/**
+ * Outcome of runBatch.
+ */
+struct BatchReport {
+  unsigned int processed;           /*< Images read, transformed and written */
+  unsigned int failed;              /*< Images that could not be read or written */
+  double seconds;                   /*< Wall-clock time of the whole batch */
+
+  /**
+   * Gets the throughput of the batch.
+   * @return Processed images per second.
+   */
+  double imagesPerSecond() const;
+};
+
+/**
+ * Gets the input files of a batch. `path` is either a directory, whose
+ * .png files are used in name order, or a manifest file listing one input
+ * path per line; blank lines and lines starting with '#' are ignored.
+ * @param path Directory or manifest file.
+ * @param inputs Receives the input paths.
+ * @return true, if `path` could be read.
+ */
+bool listBatchInputs(std::string const & path, std::vector<std::string> & inputs);
+
+/**
+ * Transforms a batch of PNG files. Decoding, transforming and encoding run
+ * as three stages on their own threads, connected by bounded queues, so
+ * file I/O and compression overlap with the pixel kernels while only a few
+ * images are in memory at once. Each output file has the name of its input
+ * file and is written to `outputDirectory`; of several inputs with the same
+ * name (from different directories), only the first is processed and the
+ * others count as failed.
+ * @param inputs The input files.
+ * @param outputDirectory Existing directory for the output files.
+ * @param spec The transforms to apply.
+ * @param options Thread counts, queue size and encoder settings.
+ * @return How many images were processed, and how fast.
+ */
+BatchReport runBatch(std::vector<std::string> const & inputs, std::string const & outputDirectory,
+                     TransformSpec const & spec, BatchOptions const & options);
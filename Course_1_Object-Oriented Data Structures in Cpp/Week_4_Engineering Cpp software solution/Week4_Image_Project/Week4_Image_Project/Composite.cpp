@@ -0,0 +1,96 @@
+#include <algorithm>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "Composite.h"
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define COMPOSITE_SIMD 1
+#endif
+
+using uiuc::HSLAPixel;
+
+CompositeRect clipStencil(unsigned imageWidth, unsigned imageHeight,
+                          unsigned stencilWidth, unsigned stencilHeight, int offsetX, int offsetY) {
+  long xBegin = std::max(0L, static_cast<long>(offsetX));
+  long xEnd = std::min(static_cast<long>(imageWidth), static_cast<long>(offsetX) + stencilWidth);
+  long yBegin = std::max(0L, static_cast<long>(offsetY));
+  long yEnd = std::min(static_cast<long>(imageHeight), static_cast<long>(offsetY) + stencilHeight);
+
+  CompositeRect rect = { 0, 0, 0, 0, 0, 0 };
+  if (xBegin >= xEnd || yBegin >= yEnd) { return rect; }
+
+  rect.x = xBegin;
+  rect.y = yBegin;
+  rect.stencilX = xBegin - offsetX;
+  rect.stencilY = yBegin - offsetY;
+  rect.width = xEnd - xBegin;
+  rect.height = yEnd - yBegin;
+  return rect;
+}
+
+void convertStencilRows(uiuc::PNG const & stencil, unsigned yBegin, unsigned yEnd) {
+  const unsigned band = uiuc::PNG::BAND_HEIGHT;
+  for (unsigned y = yBegin; y < yEnd; y = ((y / band) + 1) * band) { stencil.row(y); }
+}
+
+void watermarkRowScalar(HSLAPixel * pixels, HSLAPixel const * stencil, unsigned count,
+                        WatermarkMode mode, double threshold) {
+  for (unsigned i = 0; i < count; i++) {
+    if (mode == WatermarkMode::Threshold) {
+      if ( stencil[i].l >= threshold )
+      {
+        pixels[i].l = std::min( pixels[i].l + 0.2, 1.0 );
+      }
+    } else {
+      pixels[i].l = std::min( pixels[i].l + 0.2 * (stencil[i].l * stencil[i].a), 1.0 );
+    }
+  }
+}
+
+#ifdef COMPOSITE_SIMD
+void watermarkRow(HSLAPixel * pixels, HSLAPixel const * stencil, unsigned count,
+                  WatermarkMode mode, double threshold) {
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d boost = _mm_set1_pd(0.2);
+  const __m128d limit = _mm_set1_pd(threshold);
+  unsigned i = 0;
+
+  // HSLAPixels are 32 bytes apart, so the two luminances of a step are
+  // gathered into one register, blended without branches and scattered back.
+  // _mm_min_pd(one, sum) picks like std::min(sum, 1.0), NaNs included.
+  if (mode == WatermarkMode::Threshold) {
+    for (; i + 2 <= count; i += 2) {
+      __m128d l = _mm_loadh_pd(_mm_load_sd(&pixels[i].l), &pixels[i + 1].l);
+      __m128d stencilL = _mm_loadh_pd(_mm_load_sd(&stencil[i].l), &stencil[i + 1].l);
+
+      __m128d mask = _mm_cmpge_pd(stencilL, limit);
+      __m128d brightened = _mm_min_pd(one, _mm_add_pd(l, boost));
+      __m128d result = _mm_or_pd(_mm_and_pd(mask, brightened), _mm_andnot_pd(mask, l));
+
+      _mm_storel_pd(&pixels[i].l, result);
+      _mm_storeh_pd(&pixels[i + 1].l, result);
+    }
+  } else {
+    for (; i + 2 <= count; i += 2) {
+      __m128d l = _mm_loadh_pd(_mm_load_sd(&pixels[i].l), &pixels[i + 1].l);
+      __m128d stencilL = _mm_loadh_pd(_mm_load_sd(&stencil[i].l), &stencil[i + 1].l);
+      __m128d stencilA = _mm_loadh_pd(_mm_load_sd(&stencil[i].a), &stencil[i + 1].a);
+
+      __m128d weight = _mm_mul_pd(stencilL, stencilA);
+      __m128d result = _mm_min_pd(one, _mm_add_pd(l, _mm_mul_pd(boost, weight)));
+
+      _mm_storel_pd(&pixels[i].l, result);
+      _mm_storeh_pd(&pixels[i + 1].l, result);
+    }
+  }
+
+  watermarkRowScalar(pixels + i, stencil + i, count - i, mode, threshold);
+}
+#else
+void watermarkRow(HSLAPixel * pixels, HSLAPixel const * stencil, unsigned count,
+                  WatermarkMode mode, double threshold) {
+  watermarkRowScalar(pixels, stencil, count, mode, threshold);
+}
+#endif
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+
+/**
+ * How a stencil brightens the pixels it covers.
+ */
+enum class WatermarkMode {
+  /** Adds 0.2 to the luminance where the stencil luminance is at least a threshold (1 by default) */
+  Threshold,
+
+  /** Adds 0.2 * (stencil luminance) * (stencil alpha) to the luminance */
+  AlphaWeighted
+};
+
+/**
+ * The part of an image covered by a stencil placed with its top left corner
+ * at (offsetX, offsetY) of the image, together with the matching part of
+ * the stencil.
+ */
+struct CompositeRect {
+  unsigned x;          /*< First covered column of the image */
+  unsigned y;          /*< First covered row of the image */
+  unsigned stencilX;   /*< Stencil column over image column x */
+  unsigned stencilY;   /*< Stencil row over image row y */
+  unsigned width;      /*< Number of covered columns, 0 if there is no overlap */
+  unsigned height;     /*< Number of covered rows, 0 if there is no overlap */
+};
+
+/**
+ * Clips a stencil placed at (`offsetX`, `offsetY`) against an image.
+ * @return The overlap; its width and height are 0 if there is none.
+ */
+CompositeRect clipStencil(unsigned imageWidth, unsigned imageHeight,
+                          unsigned stencilWidth, unsigned stencilHeight, int offsetX, int offsetY);
+
+/**
+ * Watermarks `count` contiguous pixels with the stencil pixels over them,
+ * two pixels per step with SSE2 where available. Luminance is capped at 1.
+ * @param pixels The pixels to be modified.
+ * @param stencil The stencil pixels, `count` of them.
+ * @param count Number of pixels.
+ * @param mode How the stencil brightens the pixels.
+ * @param threshold Luminance the stencil needs for WatermarkMode::Threshold.
+ */
+void watermarkRow(uiuc::HSLAPixel * pixels, uiuc::HSLAPixel const * stencil, unsigned count,
+                  WatermarkMode mode, double threshold);
+
+/**
+ * Scalar reference version of watermarkRow.
+ */
+void watermarkRowScalar(uiuc::HSLAPixel * pixels, uiuc::HSLAPixel const * stencil, unsigned count,
+                        WatermarkMode mode, double threshold);
+
+/**
+ * Converts rows [`yBegin`, `yEnd`) of a lazily read stencil to HSL now, one
+ * row per band, so that reading them later (from any thread) never writes
+ * to the stencil. Does nothing for images that are not lazily read.
+ */
+void convertStencilRows(uiuc::PNG const & stencil, unsigned yBegin, unsigned yEnd);
+
+/**
+ * Row kernel that watermarks an image with a stencil placed at an offset,
+ * called as `kernel(pixels, y, width)` (see PNG::forEachRow). The overlap
+ * is computed once up front, so rows and columns outside of it are never
+ * visited. The covered stencil rows are converted up front too: unless the
+ * offset is a multiple of PNG::BAND_HEIGHT, a stencil band spans two tiles
+ * of the image, which may run on different threads.
+ */
+struct CompositeKernel {
+  uiuc::PNG const & stencil;
+  CompositeRect rect;
+  WatermarkMode mode;
+  double threshold;
+
+  CompositeKernel(uiuc::PNG const & image, uiuc::PNG const & stencilImage, int offsetX, int offsetY,
+                  WatermarkMode blendMode, double stencilThreshold = 1.0)
+    : stencil(stencilImage),
+      rect(clipStencil(image.width(), image.height(), stencilImage.width(), stencilImage.height(), offsetX, offsetY)),
+      mode(blendMode), threshold(stencilThreshold) {
+    convertStencilRows(stencil, rect.stencilY, rect.stencilY + rect.height);
+  }
+
+  void operator()(uiuc::HSLAPixel * pixels, unsigned y, unsigned width) const {
+    if (y < rect.y || y - rect.y >= rect.height) { return; }
+    watermarkRow(pixels + rect.x, stencil.row(rect.stencilY + (y - rect.y)) + rect.stencilX, rect.width, mode, threshold);
+  }
+};
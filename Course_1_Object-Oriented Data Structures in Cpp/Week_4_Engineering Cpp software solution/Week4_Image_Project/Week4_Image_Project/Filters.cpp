@@ -0,0 +1,282 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "uiuc/ParallelExecutor.h"
+#include "Filters.h"
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define FILTERS_SIMD 1
+#endif
+
+using uiuc::PNG;
+using uiuc::HSLAPixel;
+using uiuc::ParallelExecutor;
+
+namespace {
+  // Rows per tile of the passes over a plane
+  const unsigned TILE_ROWS = 4 * PNG::BAND_HEIGHT;
+
+  /** Runs `task(yBegin, yEnd)` for every tile of `rows` rows, serially or on `executor` */
+  void forEachTile(unsigned height, unsigned rows, ParallelExecutor * executor,
+                   std::function<void(unsigned, unsigned)> const & task) {
+    unsigned tiles = (height + rows - 1) / rows;
+    std::function<void(unsigned int)> runTile = [&](unsigned int tile) {
+      task(tile * rows, std::min(height, (tile + 1) * rows));
+    };
+
+    if (executor != NULL) {
+      executor->parallelFor(tiles, runTile);
+    } else {
+      for (unsigned tile = 0; tile < tiles; tile++) { runTile(tile); }
+    }
+  }
+
+  /** Clamps a possibly out of range index to [0, size) */
+  unsigned clampIndex(long index, unsigned size) {
+    if (index < 0) { return 0; }
+    if (index >= static_cast<long>(size)) { return size - 1; }
+    return index;
+  }
+
+  /*
+   * Row kernels. Every pixel is one float, so a step handles four pixels.
+   */
+
+  /** destination[x] = sum of weights[k] * rows[k][x] over the `count` rows */
+  void weightedSum(float const * const * rows, float const * weights, unsigned count, float * destination, unsigned width) {
+    unsigned x = 0;
+#ifdef FILTERS_SIMD
+    for (; x + 4 <= width; x += 4) {
+      __m128 sum = _mm_setzero_ps();
+      for (unsigned k = 0; k < count; k++) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows[k] + x)));
+      }
+      _mm_storeu_ps(destination + x, sum);
+    }
+#endif
+    for (; x < width; x++) {
+      float sum = 0;
+      for (unsigned k = 0; k < count; k++) { sum += weights[k] * rows[k][x]; }
+      destination[x] = sum;
+    }
+  }
+
+  /** sums[x] += add[x] - remove[x] */
+  void slideSums(float * sums, float const * add, float const * remove, unsigned width) {
+    unsigned x = 0;
+#ifdef FILTERS_SIMD
+    for (; x + 4 <= width; x += 4) {
+      __m128 difference = _mm_sub_ps(_mm_loadu_ps(add + x), _mm_loadu_ps(remove + x));
+      _mm_storeu_ps(sums + x, _mm_add_ps(_mm_loadu_ps(sums + x), difference));
+    }
+#endif
+    for (; x < width; x++) { sums[x] += add[x] - remove[x]; }
+  }
+
+  /** destination[x] = source[x] * scale */
+  void scaleRow(float const * source, float scale, float * destination, unsigned width) {
+    unsigned x = 0;
+#ifdef FILTERS_SIMD
+    __m128 factor = _mm_set1_ps(scale);
+    for (; x + 4 <= width; x += 4) {
+      _mm_storeu_ps(destination + x, _mm_mul_ps(_mm_loadu_ps(source + x), factor));
+    }
+#endif
+    for (; x < width; x++) { destination[x] = source[x] * scale; }
+  }
+
+  /*
+   * The passes.
+   */
+
+  void convolveRows(float const * source, float * destination, unsigned width, unsigned height,
+                    std::vector<float> const & kernel, ParallelExecutor * executor) {
+    unsigned radius = kernel.size() / 2;
+    forEachTile(height, TILE_ROWS, executor, [&](unsigned yBegin, unsigned yEnd) {
+      // the row with `radius` copies of its edge pixels on either side, so
+      // that output pixel x is the weighted sum of padded[x .. x + 2r]
+      std::vector<float> padded(width + (2 * radius));
+      std::vector<float const *> taps(kernel.size());
+      for (unsigned k = 0; k < kernel.size(); k++) { taps[k] = &padded[k]; }
+
+      for (unsigned y = yBegin; y < yEnd; y++) {
+        float const * row = source + (static_cast<std::size_t>(y) * width);
+        for (unsigned i = 0; i < padded.size(); i++) { padded[i] = row[clampIndex(static_cast<long>(i) - radius, width)]; }
+        weightedSum(taps.data(), kernel.data(), kernel.size(), destination + (static_cast<std::size_t>(y) * width), width);
+      }
+    });
+  }
+
+  void convolveColumns(float const * source, float * destination, unsigned width, unsigned height,
+                       std::vector<float> const & kernel, ParallelExecutor * executor) {
+    unsigned radius = kernel.size() / 2;
+    forEachTile(height, TILE_ROWS, executor, [&](unsigned yBegin, unsigned yEnd) {
+      std::vector<float const *> taps(kernel.size());
+      for (unsigned y = yBegin; y < yEnd; y++) {
+        for (unsigned k = 0; k < kernel.size(); k++) {
+          taps[k] = source + (static_cast<std::size_t>(clampIndex(static_cast<long>(y) + k - radius, height)) * width);
+        }
+        weightedSum(taps.data(), kernel.data(), kernel.size(), destination + (static_cast<std::size_t>(y) * width), width);
+      }
+    });
+  }
+
+  void boxRows(float const * source, float * destination, unsigned width, unsigned height,
+               unsigned radius, ParallelExecutor * executor) {
+    double scale = 1.0 / ((2 * radius) + 1);
+    forEachTile(height, TILE_ROWS, executor, [&](unsigned yBegin, unsigned yEnd) {
+      for (unsigned y = yBegin; y < yEnd; y++) {
+        float const * row = source + (static_cast<std::size_t>(y) * width);
+        float * out = destination + (static_cast<std::size_t>(y) * width);
+
+        double sum = 0;
+        for (long k = -static_cast<long>(radius); k <= static_cast<long>(radius); k++) { sum += row[clampIndex(k, width)]; }
+        for (unsigned x = 0; x < width; x++) {
+          out[x] = static_cast<float>(sum * scale);
+          sum += row[clampIndex(static_cast<long>(x) + radius + 1, width)] - row[clampIndex(static_cast<long>(x) - radius, width)];
+        }
+      }
+    });
+  }
+
+  void boxColumns(float const * source, float * destination, unsigned width, unsigned height,
+                  unsigned radius, ParallelExecutor * executor) {
+    float scale = 1.0f / ((2 * radius) + 1);
+    // each tile starts by summing a whole window, so tiles are kept much
+    // taller than the window to keep that start-up cost small
+    unsigned rows = std::max(TILE_ROWS, 4 * ((2 * radius) + 1));
+    forEachTile(height, rows, executor, [&](unsigned yBegin, unsigned yEnd) {
+      std::vector<float> sums(width, 0.0f);
+      for (long k = static_cast<long>(yBegin) - radius; k <= static_cast<long>(yBegin) + radius; k++) {
+        float const * row = source + (static_cast<std::size_t>(clampIndex(k, height)) * width);
+        for (unsigned x = 0; x < width; x++) { sums[x] += row[x]; }
+      }
+
+      for (unsigned y = yBegin; y < yEnd; y++) {
+        scaleRow(sums.data(), scale, destination + (static_cast<std::size_t>(y) * width), width);
+        float const * entering = source + (static_cast<std::size_t>(clampIndex(static_cast<long>(y) + radius + 1, height)) * width);
+        float const * leaving = source + (static_cast<std::size_t>(clampIndex(static_cast<long>(y) - radius, height)) * width);
+        slideSums(sums.data(), entering, leaving, width);
+      }
+    });
+  }
+}
+
+LuminanceFilter LuminanceFilter::box(unsigned radius) {
+  LuminanceFilter filter = { Kind::Box, radius, 0, 0 };
+  return filter;
+}
+
+LuminanceFilter LuminanceFilter::gaussian(double sigma) {
+  LuminanceFilter filter = { Kind::Gaussian, 0, sigma, 0 };
+  return filter;
+}
+
+LuminanceFilter LuminanceFilter::sharpen(double amount, double sigma) {
+  LuminanceFilter filter = { Kind::Sharpen, 0, sigma, amount };
+  return filter;
+}
+
+LuminanceFilter LuminanceFilter::sobel() {
+  LuminanceFilter filter = { Kind::Sobel, 0, 0, 0 };
+  return filter;
+}
+
+std::vector<float> gaussianKernel(double sigma) {
+  if (!(sigma > 0)) { return std::vector<float>(1, 1.0f); }   // also catches NaN
+
+  unsigned radius = static_cast<unsigned>(std::ceil(3 * sigma));
+  std::vector<double> weights((2 * radius) + 1);
+  double total = 0;
+  for (unsigned i = 0; i < weights.size(); i++) {
+    double distance = static_cast<double>(i) - radius;
+    weights[i] = std::exp(-(distance * distance) / (2 * sigma * sigma));
+    total += weights[i];
+  }
+
+  std::vector<float> kernel(weights.size());
+  for (unsigned i = 0; i < weights.size(); i++) { kernel[i] = static_cast<float>(weights[i] / total); }
+  return kernel;
+}
+
+void boxBlurPlane(float const * source, float * destination, unsigned width, unsigned height,
+                  unsigned radius, ParallelExecutor * executor) {
+  std::vector<float> rows(static_cast<std::size_t>(width) * height);
+  boxRows(source, rows.data(), width, height, radius, executor);
+  boxColumns(rows.data(), destination, width, height, radius, executor);
+}
+
+void convolvePlane(float const * source, float * destination, unsigned width, unsigned height,
+                   std::vector<float> const & rowKernel, std::vector<float> const & columnKernel,
+                   ParallelExecutor * executor) {
+  std::vector<float> rows(static_cast<std::size_t>(width) * height);
+  convolveRows(source, rows.data(), width, height, rowKernel, executor);
+  convolveColumns(rows.data(), destination, width, height, columnKernel, executor);
+}
+
+void applyLuminanceFilter(PNG & image, LuminanceFilter const & filter, ParallelExecutor * executor) {
+  unsigned width = image.width();
+  unsigned height = image.height();
+  if (width == 0 || height == 0) { return; }
+
+  // filters that would leave every pixel as it is
+  if ((filter.kind == LuminanceFilter::Kind::Box && filter.radius == 0) ||
+      (filter.kind == LuminanceFilter::Kind::Gaussian && !(filter.sigma > 0)) ||
+      (filter.kind == LuminanceFilter::Kind::Sharpen && (!(filter.sigma > 0) || filter.amount == 0))) {
+    return;
+  }
+
+  unsigned imageRows = ParallelExecutor::tileRows(image);
+  std::size_t size = static_cast<std::size_t>(width) * height;
+  std::vector<float> luminance(size);
+  forEachTile(height, imageRows, executor, [&](unsigned yBegin, unsigned yEnd) {
+    for (unsigned y = yBegin; y < yEnd; y++) {
+      HSLAPixel const * row = image.row(y);
+      float * plane = &luminance[static_cast<std::size_t>(y) * width];
+      for (unsigned x = 0; x < width; x++) { plane[x] = static_cast<float>(row[x].l); }
+    }
+  });
+
+  std::vector<float> filtered(size);
+  std::vector<float> gradientY;
+  switch (filter.kind) {
+    case LuminanceFilter::Kind::Box:
+      boxBlurPlane(luminance.data(), filtered.data(), width, height, filter.radius, executor);
+      break;
+    case LuminanceFilter::Kind::Gaussian:
+    case LuminanceFilter::Kind::Sharpen: {
+      std::vector<float> kernel = gaussianKernel(filter.sigma);
+      convolvePlane(luminance.data(), filtered.data(), width, height, kernel, kernel, executor);
+      break;
+    }
+    case LuminanceFilter::Kind::Sobel: {
+      std::vector<float> smooth = { 1, 2, 1 };
+      std::vector<float> derivative = { -1, 0, 1 };
+      gradientY.resize(size);
+      convolvePlane(luminance.data(), filtered.data(), width, height, derivative, smooth, executor);
+      convolvePlane(luminance.data(), gradientY.data(), width, height, smooth, derivative, executor);
+      break;
+    }
+  }
+
+  forEachTile(height, imageRows, executor, [&](unsigned yBegin, unsigned yEnd) {
+    for (unsigned y = yBegin; y < yEnd; y++) {
+      HSLAPixel * row = image.row(y);
+      std::size_t offset = static_cast<std::size_t>(y) * width;
+      for (unsigned x = 0; x < width; x++) {
+        double value = filtered[offset + x];
+        if (filter.kind == LuminanceFilter::Kind::Sharpen) {
+          value = luminance[offset + x] + filter.amount * (luminance[offset + x] - value);
+        } else if (filter.kind == LuminanceFilter::Kind::Sobel) {
+          value = std::sqrt((value * value) + (gradientY[offset + x] * gradientY[offset + x])) / 4;
+        }
+        row[x].l = std::min(std::max(value, 0.0), 1.0);
+      }
+    }
+  });
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+
+#include "uiuc/PNG.h"
+#include "uiuc/ParallelExecutor.h"
+
+/*
+ * Neighborhood filters on the luminance of an image: box blur, Gaussian
+ * blur, sharpening and Sobel edges. See boxBlur, gaussianBlur, sharpen and
+ * sobelEdges in ImageTransform.h for the image-level versions.
+ *
+ * The luminance is copied into a plane of floats, so four pixels fit in one
+ * SSE register, and every filter runs as separable passes: one along rows,
+ * one along columns. Both passes clamp at the edges, i.e. pixels outside of
+ * the image take the value of the nearest edge pixel. Work is split into
+ * tiles of rows, which run on a ParallelExecutor when one is given.
+ */
+
+/**
+ * The filters that applyLuminanceFilter can run.
+ */
+struct LuminanceFilter {
+  enum class Kind {
+    /** Mean of the (2 * radius + 1)^2 pixels around each pixel */
+    Box,
+
+    /** Gaussian-weighted mean with standard deviation sigma */
+    Gaussian,
+
+    /** Unsharp mask: luminance + amount * (luminance - Gaussian blur with sigma) */
+    Sharpen,
+
+    /** Sobel gradient magnitude, scaled so that a step from 0 to 1 gives 1 */
+    Sobel
+  };
+
+  Kind kind;
+  unsigned radius;    /*< Box radius, in pixels */
+  double sigma;       /*< Gaussian standard deviation, in pixels */
+  double amount;      /*< Sharpening strength */
+
+  static LuminanceFilter box(unsigned radius);
+  static LuminanceFilter gaussian(double sigma);
+  static LuminanceFilter sharpen(double amount, double sigma);
+  static LuminanceFilter sobel();
+};
+
+/**
+ * Replaces the luminance of every pixel of `image` by `filter` applied to
+ * the luminances around it, capped to [0, 1]. Hue, saturation and alpha are
+ * not changed.
+ * @param image The image to be filtered.
+ * @param filter The filter.
+ * @param executor Executor to split the work across, or NULL to run on the
+ *        calling thread. The result is the same either way.
+ */
+void applyLuminanceFilter(uiuc::PNG & image, LuminanceFilter const & filter, uiuc::ParallelExecutor * executor);
+
+/**
+ * Gets the weights of a normalized Gaussian kernel with standard deviation
+ * `sigma`, reaching out 3 * sigma pixels (rounded up) on each side.
+ * @return 2 * radius + 1 weights that add up to 1; just the weight 1 if
+ *         `sigma` is not positive (or is NaN).
+ */
+std::vector<float> gaussianKernel(double sigma);
+
+/**
+ * Box-blurs a plane of `width` x `height` floats (row-major). Each pass
+ * keeps a running sum of the window, adding the value entering it and
+ * subtracting the value leaving it, so the cost per pixel does not depend
+ * on the radius.
+ * @param source The plane to be blurred.
+ * @param destination Receives the blurred plane; must not be `source`.
+ */
+void boxBlurPlane(float const * source, float * destination, unsigned width, unsigned height,
+                  unsigned radius, uiuc::ParallelExecutor * executor);
+
+/**
+ * Convolves a plane of `width` x `height` floats (row-major) with
+ * `rowKernel` along rows and then with `columnKernel` along columns.
+ * Destination pixel x of a row is the sum of kernel[k] * source[x + k - r]
+ * for a kernel of 2r + 1 weights.
+ * @param source The plane to be convolved.
+ * @param destination Receives the result; must not be `source`.
+ */
+void convolvePlane(float const * source, float * destination, unsigned width, unsigned height,
+                   std::vector<float> const & rowKernel, std::vector<float> const & columnKernel,
+                   uiuc::ParallelExecutor * executor);
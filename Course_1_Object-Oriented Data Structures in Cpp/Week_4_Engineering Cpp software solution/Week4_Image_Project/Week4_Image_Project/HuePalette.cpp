@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "HuePalette.h"
+
+const unsigned int HuePalette::BINS_PER_DEGREE;
+const unsigned char HuePalette::AMBIGUOUS;
+
+namespace {
+  const unsigned int BINS = 360 * HuePalette::BINS_PER_DEGREE;
+
+  // bins this close to a boundary between two palette hues are not trusted
+  const double BOUNDARY_MARGIN = 1e-6;
+
+  double wrapHue(double hue) {
+    if (hue >= 0 && hue < 360) { return hue; }
+    hue = std::fmod(hue, 360.0);
+    if (hue < 0) { hue += 360; }
+    return (hue >= 360) ? 0 : hue;
+  }
+
+  // Distance around the color wheel, for hues in [0, 360)
+  double hueDistance(double hue, double paletteHue) {
+    return std::min( std::min( std::abs( hue - paletteHue ), std::abs( 360.0+paletteHue-hue ) ),
+                     std::abs( hue+360.0-paletteHue ) );
+  }
+}
+
+HuePalette::HuePalette(std::vector<double> const & hues) : bins_(BINS, AMBIGUOUS) {
+  for (unsigned i = 0; i < hues.size(); i++) { hues_.push_back(wrapHue(hues[i])); }
+  if (hues_.empty() || hues_.size() >= AMBIGUOUS) { return; }
+
+  // find where the nearest palette hue changes: points equally far from two
+  // palette hues that no other palette hue is closer to
+  std::vector<bool> boundary(BINS, false);
+  for (unsigned i = 0; i < hues_.size(); i++) {
+    for (unsigned j = i + 1; j < hues_.size(); j++) {
+      if (hues_[i] == hues_[j]) { continue; }
+
+      double midpoint = (hues_[i] + hues_[j]) / 2;
+      double candidates[2] = { midpoint, wrapHue(midpoint + 180) };
+      for (double point : candidates) {
+        double distance = hueDistance(point, hues_[i]);
+        if (hueDistance(point, hues_[_nearestIndex(point)]) < distance - BOUNDARY_MARGIN) { continue; }
+
+        long first = static_cast<long>(std::floor((point - BOUNDARY_MARGIN) * BINS_PER_DEGREE));
+        long last = static_cast<long>(std::floor((point + BOUNDARY_MARGIN) * BINS_PER_DEGREE));
+        for (long bin = first; bin <= last; bin++) {
+          boundary[(bin + BINS) % BINS] = true;
+        }
+      }
+    }
+  }
+
+  // every other bin maps entirely to one palette hue
+  for (unsigned bin = 0; bin < BINS; bin++) {
+    if (!boundary[bin]) {
+      bins_[bin] = _nearestIndex((bin + 0.5) / BINS_PER_DEGREE);
+    }
+  }
+}
+
+std::vector<double> const & HuePalette::hues() const {
+  return hues_;
+}
+
+unsigned HuePalette::_nearestIndex(double hue) const {
+  unsigned best = 0;
+  double bestDistance = hueDistance(hue, hues_[0]);
+
+  for (unsigned i = 1; i < hues_.size(); i++) {
+    double distance = hueDistance(hue, hues_[i]);
+    if (distance < bestDistance) {
+      best = i;
+      bestDistance = distance;
+    }
+  }
+
+  return best;
+}
+
+double HuePalette::nearestExact(double hue) const {
+  if (hues_.empty()) { return hue; }
+  return hues_[_nearestIndex(wrapHue(hue))];
+}
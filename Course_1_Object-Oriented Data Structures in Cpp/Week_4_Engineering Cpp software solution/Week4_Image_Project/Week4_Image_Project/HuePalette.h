@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * A set of hues that any hue can be snapped to, e.g. {216, 11} for
+ * illinify or a brand's 6-12 colors.
+ *
+ * Finding the nearest palette hue directly takes a circular distance per
+ * palette entry. Instead, the hue circle is split into bins of
+ * 1 / BINS_PER_DEGREE degrees and the nearest palette entry is precomputed
+ * for every bin, so a lookup is a single table access no matter how large
+ * the palette is. The few bins that contain a boundary between two palette
+ * entries fall back to the direct search, so the result is always exactly
+ * that of nearestExact.
+ */
+class HuePalette {
+public:
+  static const unsigned int BINS_PER_DEGREE = 8;
+
+  /**
+   * Creates a palette and its lookup table.
+   * @param hues The palette hues in degrees. When a hue is equally close to
+   *        several of them, the one listed first wins. Hues outside of
+   *        [0, 360) are wrapped into it.
+   */
+  explicit HuePalette(std::vector<double> const & hues);
+
+  /**
+   * Gets the palette hues, wrapped into [0, 360).
+   * @return The palette hues in the order they were given.
+   */
+  std::vector<double> const & hues() const;
+
+  /**
+   * Gets the palette hue closest to `hue` around the color wheel, using the
+   * lookup table. An empty palette leaves the hue unchanged.
+   * @param hue A hue in degrees.
+   * @return The nearest palette hue.
+   */
+  double nearest(double hue) const {
+    if (hue >= 0 && hue < 360) {
+      unsigned char entry = bins_[static_cast<unsigned>(hue * BINS_PER_DEGREE)];
+      if (entry != AMBIGUOUS) { return hues_[entry]; }
+    }
+    return nearestExact(hue);
+  }
+
+  /**
+   * Gets the palette hue closest to `hue` by comparing against every
+   * palette entry.
+   * @param hue A hue in degrees.
+   * @return The nearest palette hue.
+   */
+  double nearestExact(double hue) const;
+
+private:
+  static const unsigned char AMBIGUOUS = 255;   /*< Bin entry of bins that need nearestExact */
+
+  std::vector<double> hues_;                    /*< The palette hues, in [0, 360) */
+  std::vector<unsigned char> bins_;             /*< Index into hues_ for every bin, or AMBIGUOUS */
+
+  /**
+   * Gets the index of the palette hue closest to `hue`, which must be in
+   * [0, 360).
+   */
+  unsigned _nearestIndex(double hue) const;
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "uiuc/ImageStatistics.h"
+#include "HuePalette.h"
+
+/*
+ * Per-pixel kernels behind the ImageTransform functions. Each kernel is
+ * called as `kernel(pixel, x, y)` and only reads and writes the pixel it is
+ * given, so it can be run serially with PNG::forEachPixel or in parallel
+ * with uiuc::ParallelExecutor::forEachPixel with the same result.
+ */
+
+/**
+ * Sets the saturation of a pixel to 0.
+ */
+struct GrayscaleKernel {
+  void operator()(uiuc::HSLAPixel & pixel, unsigned x, unsigned y) const {
+    pixel.s = 0;
+  }
+};
+
+/**
+ * Decreases the luminance of a pixel by 0.5% per pixel of distance from the
+ * closest of one or more spotlight centers, up to 80% at 160 pixels or more.
+ *
+ * The luminance factor only depends on the squared distance, which is an
+ * integer below 160 * 160 inside of a spotlight, so it is looked up in a
+ * table instead of calling sqrt for every pixel. Outside of every spotlight
+ * the factor is the constant 0.2.
+ *
+ * Besides the per-pixel call, the kernel can be called on a whole row as
+ * `kernel(pixels, y, width)` (see PNG::forEachRow), which only walks the part
+ * of the row that each spotlight covers.
+ */
+struct SpotlightKernel {
+  static const int RADIUS = 160;                  /*< Distance at which the factor stops decreasing */
+
+  std::vector<std::pair<int, int>> centers;       /*< (x, y) of every spotlight */
+
+  SpotlightKernel(int x, int y) : centers(1, std::make_pair(x, y)) { }
+
+  explicit SpotlightKernel(std::vector<std::pair<int, int>> const & spotlights) : centers(spotlights) { }
+
+  /**
+   * Luminance factor by squared distance from a center, for squared
+   * distances below RADIUS * RADIUS.
+   */
+  static std::vector<double> const & factorTable() {
+    static const std::vector<double> table = [] {
+      // luminance degration = 0.5 % per pixel
+      std::vector<double> factors(RADIUS * RADIUS);
+      for (unsigned d2 = 0; d2 < factors.size(); d2++) {
+        factors[d2] = 1.0 - sqrt( static_cast<double>(d2) ) * 0.005;
+      }
+      return factors;
+    }();
+    return table;
+  }
+
+  /**
+   * Luminance factor outside of every spotlight.
+   */
+  static double outsideFactor() {
+    // maximal degration stop at r = 160
+    return 1.0 - RADIUS * 0.005;
+  }
+
+  /**
+   * Computes the luminance factor of every pixel of row `y`.
+   * @param factors Destination, `width` of them.
+   */
+  void rowFactors(unsigned y, unsigned width, double * factors) const {
+    std::vector<double> const & table = factorTable();
+    std::fill(factors, factors + width, outsideFactor());
+
+    for (auto const & center : centers) {
+      long dy = static_cast<long>(y) - center.second;
+      if (dy <= -RADIUS || dy >= RADIUS) { continue; }
+
+      // the spotlight covers |dx| <= half, the largest half with dx^2 + dy^2 < RADIUS^2
+      long remaining = static_cast<long>(RADIUS) * RADIUS - dy * dy;
+      long half = static_cast<long>(sqrt( static_cast<double>(remaining - 1) ));
+      while (half * half >= remaining) { half--; }
+      while ((half + 1) * (half + 1) < remaining) { half++; }
+
+      long xBegin = std::max(0L, center.first - half);
+      long xEnd = std::min(static_cast<long>(width) - 1, center.first + half);
+      if (xBegin > xEnd) { continue; }
+
+      // walk the squared distance incrementally: (dx + 1)^2 = dx^2 + 2 dx + 1
+      long dx = xBegin - center.first;
+      long d2 = dx * dx + dy * dy;
+      for (long x = xBegin; x <= xEnd; x++, dx++) {
+        factors[x] = std::max(factors[x], table[d2]);
+        d2 += 2 * dx + 1;
+      }
+    }
+  }
+
+  void operator()(uiuc::HSLAPixel * pixels, unsigned y, unsigned width) const {
+    static thread_local std::vector<double> factors;
+    factors.resize(width);
+    rowFactors(y, width, factors.data());
+
+    for (unsigned x = 0; x < width; x++) {
+      pixels[x].l = pixels[x].l * factors[x];
+    }
+  }
+
+  void operator()(uiuc::HSLAPixel & pixel, unsigned x, unsigned y) const {
+    std::vector<double> const & table = factorTable();
+    double factor = outsideFactor();
+
+    for (auto const & center : centers) {
+      long dx = static_cast<long>(x) - center.first;
+      long dy = static_cast<long>(y) - center.second;
+      if (dx <= -RADIUS || dx >= RADIUS || dy <= -RADIUS || dy >= RADIUS) { continue; }
+
+      long d2 = dx * dx + dy * dy;
+      if (d2 < static_cast<long>(RADIUS) * RADIUS) { factor = std::max(factor, table[d2]); }
+    }
+
+    pixel.l = pixel.l * factor;
+  }
+};
+
+/**
+ * Sets the hue of a pixel to the nearest hue of `palette`.
+ */
+struct RemapHueKernel {
+  HuePalette const & palette;
+
+  explicit RemapHueKernel(HuePalette const & hues) : palette(hues) { }
+
+  void operator()(uiuc::HSLAPixel & pixel, unsigned x, unsigned y) const {
+    pixel.h = palette.nearest(pixel.h);
+  }
+};
+
+/**
+ * The Illini palette: blue (216) and orange (11). Blue is listed first so
+ * that it wins ties, as it always has for illinify.
+ */
+inline HuePalette const & illiniPalette() {
+  static const HuePalette palette(std::vector<double>{ 216.0, 11.0 });
+  return palette;
+}
+
+/**
+ * Sets the hue of a pixel to Illini orange or blue, whichever is closer.
+ */
+struct IllinifyKernel : RemapHueKernel {
+  IllinifyKernel() : RemapHueKernel(illiniPalette()) { }
+};
+
+/**
+ * Increases the luminance of a pixel by 0.2 (up to 1) if the pixel at the
+ * same position in `stencil` has a luminance of 1 (or more), the same test
+ * as WatermarkMode::Threshold. Pixels outside of the stencil are left alone.
+ * Whole images are better watermarked with the row-wise CompositeKernel.
+ */
+struct WatermarkKernel {
+  uiuc::PNG const & stencil;
+
+  explicit WatermarkKernel(uiuc::PNG const & image) : stencil(image) { }
+
+  void operator()(uiuc::HSLAPixel & pixel, unsigned x, unsigned y) const {
+    if ( x >= stencil.width() || y >= stencil.height() ) { return; }
+
+    if ( stencil.row(y)[x].l >= 1.0 )
+    {
+      pixel.l = std::min( pixel.l + 0.2, 1.0 );
+    }
+  }
+};
+
+/**
+ * Maps the luminance of a pixel through the cumulative distribution of the
+ * luminances of an image (histogram equalization), which spreads the
+ * luminances of that image evenly over [0, 1]. Within a histogram bin the
+ * mapping is interpolated linearly, so distinct luminances stay distinct.
+ */
+struct EqualizeKernel {
+  std::vector<double> cumulative;   /*< Fraction of pixels below the start of each bin, then 1 */
+  double scale;                     /*< Bins per unit of luminance */
+
+  explicit EqualizeKernel(uiuc::ChannelStatistics const & luminance)
+    : cumulative(luminance.histogram.size() + 1, 0.0), scale(luminance.histogram.size()) {
+    std::uint64_t total = 0;
+    for (std::uint64_t count : luminance.histogram) { total += count; }
+    if (total == 0) { return; }
+
+    std::uint64_t below = 0;
+    for (unsigned b = 0; b < luminance.histogram.size(); b++) {
+      below += luminance.histogram[b];
+      cumulative[b + 1] = static_cast<double>(below) / total;
+    }
+  }
+
+  void operator()(uiuc::HSLAPixel & pixel, unsigned x, unsigned y) const {
+    double position = pixel.l * scale;
+    if (!(position > 0)) {
+      pixel.l = 0;
+    } else if (position >= scale) {
+      pixel.l = cumulative.back();
+    } else {
+      unsigned bin = static_cast<unsigned>(position);
+      pixel.l = cumulative[bin] + (position - bin) * (cumulative[bin + 1] - cumulative[bin]);
+    }
+  }
+};
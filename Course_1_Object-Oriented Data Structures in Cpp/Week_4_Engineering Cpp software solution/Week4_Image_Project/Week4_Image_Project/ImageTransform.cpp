@@ -1,10 +1,22 @@
 #include <iostream>
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
+#include <cstdint>
 
 #include "uiuc/PNG.h"
 #include "uiuc/HSLAPixel.h"
+#include "uiuc/PlanarPNG.h"
+#include "uiuc/FixedPNG.h"
+#include "uiuc/ParallelExecutor.h"
+#include "uiuc/PNGStream.h"
+#include "uiuc/Instrumentation.h"
+#include "uiuc/ImageStatistics.h"
 #include "ImageTransform.h"
+#include "ImageKernels.h"
+#include "Composite.h"
+#include "Filters.h"
+#include "Region.h"
 
 /* ******************
 (Begin multi-line comment...)
@@ -19,6 +31,62 @@ Email:
 
 using uiuc::PNG;
 using uiuc::HSLAPixel;
+using uiuc::PlanarPNG;
+using uiuc::FixedPNG;
+using uiuc::FixedPixel;
+using uiuc::ParallelExecutor;
+using uiuc::StageTimer;
+
+// Pixels processed by a transform of `image`, for its StageTimer
+static std::uint64_t pixelCount(PNG const & image) {
+  return static_cast<std::uint64_t>(image.width()) * image.height();
+}
+
+// Pixels processed by a transform of `region` of `image`, for its StageTimer
+static std::uint64_t pixelCount(PNG const & image, Region const & region) {
+  Region clipped = clipRegion(region, image.width(), image.height());
+  return static_cast<std::uint64_t>(clipped.width) * clipped.height;
+}
+
+// Pixels visited by a transform of `image` through `mask`, for its StageTimer
+static std::uint64_t pixelCount(PNG const & image, PNG const & mask) {
+  return static_cast<std::uint64_t>(std::min(image.width(), mask.width())) * std::min(image.height(), mask.height());
+}
+
+// Mask pixels with at least this luminance select the image pixel under them
+static const double MASK_THRESHOLD = 0.5;
+
+// Calls `kernel(pixel, x, y)` for the pixels inside of `region` only
+template <typename Kernel>
+static void forEachPixelInRegion(PNG & image, Region const & region, Kernel const & kernel) {
+  Region clipped = clipRegion(region, image.width(), image.height());
+  for (unsigned y = clipped.y; y < clipped.y + clipped.height; y++) {
+    HSLAPixel * pixels = image.row(y);
+    for (unsigned x = clipped.x; x < clipped.x + clipped.width; x++) {
+      kernel(pixels[x], x, y);
+    }
+  }
+}
+
+// Calls `kernel(pixel, x, y)` for the pixels selected by `mask`, placed over
+// the top left corner of the image; only the rows and columns it covers
+// are visited
+template <typename Kernel>
+static void forEachMaskedPixel(PNG & image, PNG const & mask, Kernel const & kernel) {
+  unsigned width = std::min(image.width(), mask.width());
+  unsigned height = std::min(image.height(), mask.height());
+  for (unsigned y = 0; y < height; y++) {
+    HSLAPixel * pixels = image.row(y);
+    HSLAPixel const * selection = mask.row(y);
+    for (unsigned x = 0; x < width; x++) {
+      if (selection[x].l >= MASK_THRESHOLD) { kernel(pixels[x], x, y); }
+    }
+  }
+}
+
+// Histogram bins behind equalizeLuminance; the mapping is interpolated
+// within a bin, so this only limits how closely it follows the image
+static const unsigned EQUALIZE_BINS = 1024;
 
 /**
  * Returns an image that has been transformed to grayscale.
@@ -29,17 +97,11 @@ using uiuc::HSLAPixel;
  */
 PNG grayscale(PNG image) {
   /// This function is already written for you so you can see how to
-  /// interact with our PNG class.
-  for (unsigned x = 0; x < image.width(); x++) {
-    for (unsigned y = 0; y < image.height(); y++) {
-      HSLAPixel & pixel = image.getPixel(x, y);
-
-      // `pixel` is a reference to the memory stored inside of the PNG `image`,
-      // which means you're changing the image directly. No need to `set`
-      // the pixel since you're directly changing the memory of the image.
-      pixel.s = 0;
-    }
-  }
+  /// interact with our PNG class. The per-pixel work lives in
+  /// `GrayscaleKernel` (ImageKernels.h), which sets `pixel.s = 0` on a
+  /// reference to the memory stored inside of the PNG `image`.
+  StageTimer timer("grayscale", pixelCount(image));
+  image.forEachPixel(GrayscaleKernel());
 
   return image;
 }
@@ -67,46 +129,33 @@ PNG grayscale(PNG image) {
  * @return The image with a spotlight.
  */
 PNG createSpotlight(PNG image, int centerX, int centerY) {
+  StageTimer timer("createSpotlight", pixelCount(image));
 
-  // luminance degration = 0.5 % per pixel
-  // = 0.005 per pixel
-  double luminance_degrade = 0.005;
-
-  for (unsigned x = 0; x < image.width(); x++) {
-    for (unsigned y = 0; y < image.height(); y++) {
-      
-      // get pixel reference from image
-      HSLAPixel & pixel = image.getPixel(x, y);
-      
-      // original pixel luminance
-      double original_luminance = pixel.l;
-
-      // calculate radius
-      //double radius = floor( sqrt( ( x - centerX )^2 + ( y - centerY )^2 ) );
-      double radius = ( sqrt( pow( x - centerX, 2 ) + pow( y - centerY, 2 ) ) );
-      
-      // maximal degration stop at r = 160
-      if ( radius >= 160.0 )
-      {
-        radius = 160.0;
-      }
-      
-      double  luminance_adjustment = radius * luminance_degrade;
-      
-      // update new pixel luminance
-      pixel.l = original_luminance * ( 1.0 - luminance_adjustment );
-
-      
-    }
-    //end of loop y
-    
-  }
-  //end of loop x
+  image.forEachRow(SpotlightKernel(centerX, centerY));
 
   return image;
   
 }
 //end of function PNG createSpotlight
+
+
+/**
+ * Returns an image with a spotlight at each of `centers`.
+ *
+ * Every pixel is dimmed as for createSpotlight by its distance to the
+ * closest center, so overlapping spotlights do not darken each other. All
+ * spotlights are applied in a single pass over the image.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param centers The (x, y) coordinates of the spotlight centers.
+ *
+ * @return The image with the spotlights.
+ */
+PNG createSpotlight(PNG image, std::vector<std::pair<int, int>> const & centers) {
+  StageTimer timer("createSpotlight", pixelCount(image));
+  image.forEachRow(SpotlightKernel(centers));
+  return image;
+}
  
 
 /**
@@ -120,48 +169,32 @@ PNG createSpotlight(PNG image, int centerX, int centerY) {
  * @return The illinify'd image.
 **/
 PNG illinify(PNG image) {
+  StageTimer timer("illinify", pixelCount(image));
 
+  image.forEachPixel(IllinifyKernel());
 
-  for (unsigned x = 0; x < image.width(); x++) {
-    for (unsigned y = 0; y < image.height(); y++) {
-      
-      HSLAPixel & pixel = image.getPixel(x, y);
-
-      // `pixel` is a reference to the memory stored inside of the PNG `image`,
-      // which means you're changing the image directly. No need to `set`
-      // the pixel since you're directly changing the memory of the image.
-      
-      double current_hue = pixel.h;
-      double illini_orange = 11.0;
-      double illini_blue = 216.0;
-      
-      //double dist_to_orange = current_hue - illini_orange;
-      //double dist_to_blue = current_hue - illini_blue;
-      
-      double dist_to_orange = min( abs( current_hue - illini_orange ), abs( 360.0+illini_orange-current_hue ) );
-      double dist_to_blue = min( abs( current_hue - illini_blue ), abs( 360.0+illini_blue-current_hue ) );
-      
-      
-      if( dist_to_orange < dist_to_blue )
-      {
-        pixel.h = illini_orange;
-      }
-      else
-      {
-        pixel.h = illini_blue;
-      }
-      //end of if...else...
-      
-    }
-    //end of loop y
-    
-  }
-  //end of loop x
+  return image;
+}
+//end of function PNG illinify(PNG image)
 
 
+/**
+ * Returns an image with every hue replaced by the nearest hue of `palette`.
+ *
+ * This is illinify with any set of hues. The nearest hue is looked up in
+ * the palette's table, so the cost per pixel does not grow with the number
+ * of palette hues.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param palette The hues to snap to.
+ *
+ * @return The recolored image.
+ */
+PNG remapHue(PNG image, HuePalette const & palette) {
+  StageTimer timer("remapHue", pixelCount(image));
+  image.forEachPixel(RemapHueKernel(palette));
   return image;
 }
-//end of function PNG illinify(PNG image)
  
 
 /**
@@ -169,7 +202,8 @@ PNG illinify(PNG image) {
 *
 * The luminance of every pixel of the second image is checked, if that
 * pixel's luminance is 1 (100%), then the pixel at the same location on
-* the first image has its luminance increased by 0.2.
+* the first image has its luminance increased by 0.2. Stencil pixels that
+* fall outside of the first image are ignored.
 *
 * @param firstImage  The first of the two PNGs, which is the base image.
 * @param secondImage The second of the two PNGs, which acts as the stencil.
@@ -177,34 +211,959 @@ PNG illinify(PNG image) {
 * @return The watermarked image.
 */
 PNG watermark(PNG firstImage, PNG secondImage) {
+  StageTimer timer("watermark", pixelCount(firstImage));
 
-  for (unsigned x = 0; x < secondImage.width(); x++) {
-    
-    for (unsigned y = 0; y < secondImage.height(); y++) {
-      
-      HSLAPixel & stencil_pixel = secondImage.getPixel(x, y);
-      HSLAPixel & base_pixel = firstImage.getPixel(x, y);
-      
-      if( 1.0 == stencil_pixel.l )
-      {
-        double luminance_upper_bound = 1.0;
-        double watermark_luminance_offset = 0.2;
-        // luminance + 0.2, but not exceed upper bound 1.0
-        double new_base_pixel_luminance = min( base_pixel.l + watermark_luminance_offset, luminance_upper_bound );
-        
-        // update base pixel luminance
-        base_pixel.l = new_base_pixel_luminance;
-      }
-      
-      
-      
-    }
-    //end of for y loop
-  }
-  //end of for x loop
+  // only the overlap of the two images can be watermarked
+  firstImage.forEachRow(CompositeKernel(firstImage, secondImage, 0, 0, WatermarkMode::Threshold));
 
+  return firstImage;
+}
+//end of function PNG watermark(PNG firstImage, PNG secondImage)
 
 
+/**
+ * Returns an image watermarked by a stencil placed with its top left
+ * corner at (`offsetX`, `offsetY`).
+ *
+ * The stencil may lie partly (or entirely) outside of the image; only the
+ * overlap is modified. With WatermarkMode::Threshold this is watermark
+ * with an offset; WatermarkMode::AlphaWeighted brightens each pixel by 0.2
+ * times the luminance and alpha of the stencil pixel over it instead.
+ *
+ * @param firstImage The base image.
+ * @param stencil The stencil.
+ * @param offsetX Image x coordinate of the stencil's left column.
+ * @param offsetY Image y coordinate of the stencil's top row.
+ * @param mode How the stencil brightens the image.
+ *
+ * @return The watermarked image.
+ */
+PNG watermark(PNG firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode) {
+  StageTimer timer("watermark", pixelCount(firstImage));
+  firstImage.forEachRow(CompositeKernel(firstImage, stencil, offsetX, offsetY, mode));
   return firstImage;
 }
-//end of function PNG watermark(PNG firstImage, PNG secondImage)
+
+
+/**
+ * Returns an image whose luminance has been box-blurred: every pixel's
+ * luminance becomes the mean of the (2 * `radius` + 1)^2 luminances around
+ * it, with the image's edge pixels repeated beyond its borders. Hue,
+ * saturation and alpha are kept. The cost does not depend on `radius`.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param radius Pixels on each side of a pixel that are averaged with it.
+ *
+ * @return The blurred image.
+ */
+PNG boxBlur(PNG image, unsigned radius) {
+  StageTimer timer("boxBlur", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::box(radius), NULL);
+  return image;
+}
+
+
+/**
+ * Returns an image whose luminance has been blurred with a Gaussian of
+ * standard deviation `sigma` pixels. Hue, saturation and alpha are kept.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param sigma Standard deviation of the blur, in pixels.
+ *
+ * @return The blurred image.
+ */
+PNG gaussianBlur(PNG image, double sigma) {
+  StageTimer timer("gaussianBlur", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::gaussian(sigma), NULL);
+  return image;
+}
+
+
+/**
+ * Returns an image whose luminance has been sharpened with an unsharp
+ * mask: the difference between each luminance and its Gaussian blur is
+ * added back `amount` times, capped to [0, 1].
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param amount Strength of the sharpening; 1 doubles local contrast.
+ * @param sigma Standard deviation of the blur, in pixels, i.e. the size of
+ *              the details that are sharpened.
+ *
+ * @return The sharpened image.
+ */
+PNG sharpen(PNG image, double amount, double sigma) {
+  StageTimer timer("sharpen", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sharpen(amount, sigma), NULL);
+  return image;
+}
+
+
+/**
+ * Returns an image whose luminance is the Sobel gradient magnitude of the
+ * original luminance, so edges are bright and flat areas are black. A hard
+ * edge from black to white gives luminance 1.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ *
+ * @return The edge image.
+ */
+PNG sobelEdges(PNG image) {
+  StageTimer timer("sobelEdges", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sobel(), NULL);
+  return image;
+}
+
+
+/**
+ * Returns an image whose luminance has been histogram-equalized: every
+ * luminance is replaced by the fraction of the image's pixels that are
+ * darker, so the luminances of the result are spread evenly over [0, 1].
+ * Hue, saturation and alpha are kept.
+ *
+ * The histogram is gathered in one read pass (see uiuc/ImageStatistics.h)
+ * and the luminances are remapped in one write pass.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ *
+ * @return The equalized image.
+ */
+PNG equalizeLuminance(PNG image) {
+  StageTimer timer("equalizeLuminance", pixelCount(image));
+  image.forEachPixel(EqualizeKernel(uiuc::computeStatistics(image, EQUALIZE_BINS).luminance));
+  return image;
+}
+
+
+/**
+ * Returns an image in which only the pixels inside of `region` have been
+ * transformed to grayscale. Rows and columns outside of the region are
+ * never visited.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param region The part of the image to transform; parts of it outside
+ *               of the image are ignored.
+ *
+ * @return The partly grayscale image.
+ */
+PNG grayscale(PNG image, Region const & region) {
+  StageTimer timer("grayscale", pixelCount(image, region));
+  forEachPixelInRegion(image, region, GrayscaleKernel());
+  return image;
+}
+
+
+/**
+ * Returns an image in which only the pixels inside of `region` have been
+ * darkened by a spotlight centered at (`centerX`, `centerY`), as in
+ * createSpotlight. The center may be outside of the region.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param centerX The center x coordinate of the spotlight.
+ * @param centerY The center y coordinate of the spotlight.
+ * @param region The part of the image to transform.
+ *
+ * @return The image with a spotlight inside of the region.
+ */
+PNG createSpotlight(PNG image, int centerX, int centerY, Region const & region) {
+  StageTimer timer("createSpotlight", pixelCount(image, region));
+  forEachPixelInRegion(image, region, SpotlightKernel(centerX, centerY));
+  return image;
+}
+
+
+/**
+ * Returns an image in which only the pixels inside of `region` have been
+ * transformed to Illini colors.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param region The part of the image to transform.
+ *
+ * @return The partly illinify'd image.
+ */
+PNG illinify(PNG image, Region const & region) {
+  StageTimer timer("illinify", pixelCount(image, region));
+  forEachPixelInRegion(image, region, IllinifyKernel());
+  return image;
+}
+
+
+/**
+ * Returns an image in which only the pixels selected by `mask` have been
+ * transformed to grayscale. The mask is placed over the top left corner of
+ * the image and selects the pixels under its pixels with a luminance of at
+ * least 0.5; pixels it does not cover are left alone.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param mask The selection.
+ *
+ * @return The partly grayscale image.
+ */
+PNG grayscale(PNG image, PNG const & mask) {
+  StageTimer timer("grayscale", pixelCount(image, mask));
+  forEachMaskedPixel(image, mask, GrayscaleKernel());
+  return image;
+}
+
+
+/**
+ * Returns an image in which only the pixels selected by `mask` (see
+ * grayscale above) have been darkened by a spotlight centered at
+ * (`centerX`, `centerY`).
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param centerX The center x coordinate of the spotlight.
+ * @param centerY The center y coordinate of the spotlight.
+ * @param mask The selection.
+ *
+ * @return The image with a spotlight on the selected pixels.
+ */
+PNG createSpotlight(PNG image, int centerX, int centerY, PNG const & mask) {
+  StageTimer timer("createSpotlight", pixelCount(image, mask));
+  forEachMaskedPixel(image, mask, SpotlightKernel(centerX, centerY));
+  return image;
+}
+
+
+/**
+ * Returns an image in which only the pixels selected by `mask` (see
+ * grayscale above) have been transformed to Illini colors.
+ *
+ * @param image A PNG object which holds the image data to be modified.
+ * @param mask The selection.
+ *
+ * @return The partly illinify'd image.
+ */
+PNG illinify(PNG image, PNG const & mask) {
+  StageTimer timer("illinify", pixelCount(image, mask));
+  forEachMaskedPixel(image, mask, IllinifyKernel());
+  return image;
+}
+
+
+/*
+ * Parallel versions of the transforms above. They run the same kernels
+ * across the threads of `executor`, one tile of rows at a time, and give
+ * exactly the same result as the serial versions.
+ */
+
+/**
+ * Returns an image that has been transformed to grayscale, using `executor`.
+ */
+PNG grayscale(PNG image, ParallelExecutor & executor) {
+  StageTimer timer("grayscale", pixelCount(image));
+  executor.forEachPixel(image, GrayscaleKernel());
+  return image;
+}
+
+/**
+ * Returns an image with a spotlight centered at (`centerX`, `centerY`),
+ * using `executor`.
+ */
+PNG createSpotlight(PNG image, int centerX, int centerY, ParallelExecutor & executor) {
+  StageTimer timer("createSpotlight", pixelCount(image));
+  executor.forEachRow(image, SpotlightKernel(centerX, centerY));
+  return image;
+}
+
+/**
+ * Returns an image with a spotlight at each of `centers`, using `executor`.
+ */
+PNG createSpotlight(PNG image, std::vector<std::pair<int, int>> const & centers, ParallelExecutor & executor) {
+  StageTimer timer("createSpotlight", pixelCount(image));
+  executor.forEachRow(image, SpotlightKernel(centers));
+  return image;
+}
+
+/**
+ * Returns a image transformed to Illini colors, using `executor`.
+ */
+PNG illinify(PNG image, ParallelExecutor & executor) {
+  StageTimer timer("illinify", pixelCount(image));
+  executor.forEachPixel(image, IllinifyKernel());
+  return image;
+}
+
+/**
+ * Returns an image with every hue replaced by the nearest hue of `palette`,
+ * using `executor`.
+ */
+PNG remapHue(PNG image, HuePalette const & palette, ParallelExecutor & executor) {
+  StageTimer timer("remapHue", pixelCount(image));
+  executor.forEachPixel(image, RemapHueKernel(palette));
+  return image;
+}
+
+/**
+ * Returns an image that has been watermarked by another image, using
+ * `executor`.
+ */
+PNG watermark(PNG firstImage, PNG secondImage, ParallelExecutor & executor) {
+  StageTimer timer("watermark", pixelCount(firstImage));
+  executor.forEachRow(firstImage, CompositeKernel(firstImage, secondImage, 0, 0, WatermarkMode::Threshold));
+  return firstImage;
+}
+
+/**
+ * Returns an image watermarked by a stencil placed at (`offsetX`,
+ * `offsetY`), using `executor`.
+ */
+PNG watermark(PNG firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode, ParallelExecutor & executor) {
+  StageTimer timer("watermark", pixelCount(firstImage));
+  executor.forEachRow(firstImage, CompositeKernel(firstImage, stencil, offsetX, offsetY, mode));
+  return firstImage;
+}
+
+
+
+/**
+ * Returns an image whose luminance has been box-blurred, using `executor`.
+ */
+PNG boxBlur(PNG image, unsigned radius, ParallelExecutor & executor) {
+  StageTimer timer("boxBlur", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::box(radius), &executor);
+  return image;
+}
+
+/**
+ * Returns an image whose luminance has been Gaussian-blurred, using
+ * `executor`.
+ */
+PNG gaussianBlur(PNG image, double sigma, ParallelExecutor & executor) {
+  StageTimer timer("gaussianBlur", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::gaussian(sigma), &executor);
+  return image;
+}
+
+/**
+ * Returns an image whose luminance has been sharpened, using `executor`.
+ */
+PNG sharpen(PNG image, double amount, double sigma, ParallelExecutor & executor) {
+  StageTimer timer("sharpen", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sharpen(amount, sigma), &executor);
+  return image;
+}
+
+/**
+ * Returns the Sobel edge image of `image`, using `executor`.
+ */
+PNG sobelEdges(PNG image, ParallelExecutor & executor) {
+  StageTimer timer("sobelEdges", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sobel(), &executor);
+  return image;
+}
+
+/**
+ * Returns an image whose luminance has been histogram-equalized, using
+ * `executor` for both passes.
+ */
+PNG equalizeLuminance(PNG image, ParallelExecutor & executor) {
+  StageTimer timer("equalizeLuminance", pixelCount(image));
+  executor.forEachPixel(image, EqualizeKernel(uiuc::computeStatistics(image, EQUALIZE_BINS, executor).luminance));
+  return image;
+}
+
+
+
+/*
+ * In-place versions of the transforms above. They modify `image` directly
+ * instead of working on (and returning) a copy, so a caller that no longer
+ * needs the original can avoid allocating a second frame.
+ */
+
+/**
+ * Transforms `image` to grayscale.
+ */
+void grayscaleInPlace(PNG & image) {
+  StageTimer timer("grayscaleInPlace", pixelCount(image));
+  image.forEachPixel(GrayscaleKernel());
+}
+
+/**
+ * Adds a spotlight centered at (`centerX`, `centerY`) to `image`.
+ */
+void createSpotlightInPlace(PNG & image, int centerX, int centerY) {
+  StageTimer timer("createSpotlightInPlace", pixelCount(image));
+  image.forEachRow(SpotlightKernel(centerX, centerY));
+}
+
+/**
+ * Adds a spotlight at each of `centers` to `image`.
+ */
+void createSpotlightInPlace(PNG & image, std::vector<std::pair<int, int>> const & centers) {
+  StageTimer timer("createSpotlightInPlace", pixelCount(image));
+  image.forEachRow(SpotlightKernel(centers));
+}
+
+/**
+ * Transforms `image` to Illini colors.
+ */
+void illinifyInPlace(PNG & image) {
+  StageTimer timer("illinifyInPlace", pixelCount(image));
+  image.forEachPixel(IllinifyKernel());
+}
+
+/**
+ * Replaces every hue of `image` by the nearest hue of `palette`.
+ */
+void remapHueInPlace(PNG & image, HuePalette const & palette) {
+  StageTimer timer("remapHueInPlace", pixelCount(image));
+  image.forEachPixel(RemapHueKernel(palette));
+}
+
+/**
+ * Watermarks `firstImage` with the stencil `secondImage`.
+ */
+void watermarkInPlace(PNG & firstImage, PNG const & secondImage) {
+  StageTimer timer("watermarkInPlace", pixelCount(firstImage));
+  firstImage.forEachRow(CompositeKernel(firstImage, secondImage, 0, 0, WatermarkMode::Threshold));
+}
+
+/**
+ * Watermarks `firstImage` with `stencil` placed at (`offsetX`, `offsetY`).
+ */
+void watermarkInPlace(PNG & firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode) {
+  StageTimer timer("watermarkInPlace", pixelCount(firstImage));
+  firstImage.forEachRow(CompositeKernel(firstImage, stencil, offsetX, offsetY, mode));
+}
+
+/**
+ * Transforms `image` to grayscale, using `executor`.
+ */
+void grayscaleInPlace(PNG & image, ParallelExecutor & executor) {
+  StageTimer timer("grayscaleInPlace", pixelCount(image));
+  executor.forEachPixel(image, GrayscaleKernel());
+}
+
+/**
+ * Adds a spotlight centered at (`centerX`, `centerY`) to `image`, using
+ * `executor`.
+ */
+void createSpotlightInPlace(PNG & image, int centerX, int centerY, ParallelExecutor & executor) {
+  StageTimer timer("createSpotlightInPlace", pixelCount(image));
+  executor.forEachRow(image, SpotlightKernel(centerX, centerY));
+}
+
+/**
+ * Adds a spotlight at each of `centers` to `image`, using `executor`.
+ */
+void createSpotlightInPlace(PNG & image, std::vector<std::pair<int, int>> const & centers, ParallelExecutor & executor) {
+  StageTimer timer("createSpotlightInPlace", pixelCount(image));
+  executor.forEachRow(image, SpotlightKernel(centers));
+}
+
+/**
+ * Transforms `image` to Illini colors, using `executor`.
+ */
+void illinifyInPlace(PNG & image, ParallelExecutor & executor) {
+  StageTimer timer("illinifyInPlace", pixelCount(image));
+  executor.forEachPixel(image, IllinifyKernel());
+}
+
+/**
+ * Replaces every hue of `image` by the nearest hue of `palette`, using
+ * `executor`.
+ */
+void remapHueInPlace(PNG & image, HuePalette const & palette, ParallelExecutor & executor) {
+  StageTimer timer("remapHueInPlace", pixelCount(image));
+  executor.forEachPixel(image, RemapHueKernel(palette));
+}
+
+/**
+ * Watermarks `firstImage` with the stencil `secondImage`, using `executor`.
+ */
+void watermarkInPlace(PNG & firstImage, PNG const & secondImage, ParallelExecutor & executor) {
+  StageTimer timer("watermarkInPlace", pixelCount(firstImage));
+  executor.forEachRow(firstImage, CompositeKernel(firstImage, secondImage, 0, 0, WatermarkMode::Threshold));
+}
+
+/**
+ * Watermarks `firstImage` with `stencil` placed at (`offsetX`, `offsetY`),
+ * using `executor`.
+ */
+void watermarkInPlace(PNG & firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode, ParallelExecutor & executor) {
+  StageTimer timer("watermarkInPlace", pixelCount(firstImage));
+  executor.forEachRow(firstImage, CompositeKernel(firstImage, stencil, offsetX, offsetY, mode));
+}
+
+
+
+/**
+ * Box-blurs the luminance of `image`.
+ */
+void boxBlurInPlace(PNG & image, unsigned radius) {
+  StageTimer timer("boxBlurInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::box(radius), NULL);
+}
+
+/**
+ * Gaussian-blurs the luminance of `image`.
+ */
+void gaussianBlurInPlace(PNG & image, double sigma) {
+  StageTimer timer("gaussianBlurInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::gaussian(sigma), NULL);
+}
+
+/**
+ * Sharpens the luminance of `image`.
+ */
+void sharpenInPlace(PNG & image, double amount, double sigma) {
+  StageTimer timer("sharpenInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sharpen(amount, sigma), NULL);
+}
+
+/**
+ * Replaces the luminance of `image` by its Sobel gradient magnitude.
+ */
+void sobelEdgesInPlace(PNG & image) {
+  StageTimer timer("sobelEdgesInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sobel(), NULL);
+}
+
+/**
+ * Histogram-equalizes the luminance of `image`.
+ */
+void equalizeLuminanceInPlace(PNG & image) {
+  StageTimer timer("equalizeLuminanceInPlace", pixelCount(image));
+  image.forEachPixel(EqualizeKernel(uiuc::computeStatistics(image, EQUALIZE_BINS).luminance));
+}
+
+/**
+ * Transforms the pixels of `image` inside of `region` to grayscale.
+ */
+void grayscaleInPlace(PNG & image, Region const & region) {
+  StageTimer timer("grayscaleInPlace", pixelCount(image, region));
+  forEachPixelInRegion(image, region, GrayscaleKernel());
+}
+
+/**
+ * Adds a spotlight centered at (`centerX`, `centerY`) to the pixels of
+ * `image` inside of `region`.
+ */
+void createSpotlightInPlace(PNG & image, int centerX, int centerY, Region const & region) {
+  StageTimer timer("createSpotlightInPlace", pixelCount(image, region));
+  forEachPixelInRegion(image, region, SpotlightKernel(centerX, centerY));
+}
+
+/**
+ * Transforms the pixels of `image` inside of `region` to Illini colors.
+ */
+void illinifyInPlace(PNG & image, Region const & region) {
+  StageTimer timer("illinifyInPlace", pixelCount(image, region));
+  forEachPixelInRegion(image, region, IllinifyKernel());
+}
+
+/**
+ * Transforms the pixels of `image` selected by `mask` to grayscale.
+ */
+void grayscaleInPlace(PNG & image, PNG const & mask) {
+  StageTimer timer("grayscaleInPlace", pixelCount(image, mask));
+  forEachMaskedPixel(image, mask, GrayscaleKernel());
+}
+
+/**
+ * Adds a spotlight centered at (`centerX`, `centerY`) to the pixels of
+ * `image` selected by `mask`.
+ */
+void createSpotlightInPlace(PNG & image, int centerX, int centerY, PNG const & mask) {
+  StageTimer timer("createSpotlightInPlace", pixelCount(image, mask));
+  forEachMaskedPixel(image, mask, SpotlightKernel(centerX, centerY));
+}
+
+/**
+ * Transforms the pixels of `image` selected by `mask` to Illini colors.
+ */
+void illinifyInPlace(PNG & image, PNG const & mask) {
+  StageTimer timer("illinifyInPlace", pixelCount(image, mask));
+  forEachMaskedPixel(image, mask, IllinifyKernel());
+}
+
+/**
+ * Box-blurs the luminance of `image`, using `executor`.
+ */
+void boxBlurInPlace(PNG & image, unsigned radius, ParallelExecutor & executor) {
+  StageTimer timer("boxBlurInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::box(radius), &executor);
+}
+
+/**
+ * Gaussian-blurs the luminance of `image`, using `executor`.
+ */
+void gaussianBlurInPlace(PNG & image, double sigma, ParallelExecutor & executor) {
+  StageTimer timer("gaussianBlurInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::gaussian(sigma), &executor);
+}
+
+/**
+ * Sharpens the luminance of `image`, using `executor`.
+ */
+void sharpenInPlace(PNG & image, double amount, double sigma, ParallelExecutor & executor) {
+  StageTimer timer("sharpenInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sharpen(amount, sigma), &executor);
+}
+
+/**
+ * Replaces the luminance of `image` by its Sobel gradient magnitude, using
+ * `executor`.
+ */
+void sobelEdgesInPlace(PNG & image, ParallelExecutor & executor) {
+  StageTimer timer("sobelEdgesInPlace", pixelCount(image));
+  applyLuminanceFilter(image, LuminanceFilter::sobel(), &executor);
+}
+
+/**
+ * Histogram-equalizes the luminance of `image`, using `executor`.
+ */
+void equalizeLuminanceInPlace(PNG & image, ParallelExecutor & executor) {
+  StageTimer timer("equalizeLuminanceInPlace", pixelCount(image));
+  executor.forEachPixel(image, EqualizeKernel(uiuc::computeStatistics(image, EQUALIZE_BINS, executor).luminance));
+}
+
+
+
+/*
+ * Streaming versions of the transforms above. They read `inFile` and write
+ * `outFile` a band of rows at a time (see uiuc/PNGStream.h), so images far
+ * larger than memory can be transformed. Each returns true on success.
+ */
+
+/**
+ * Writes a grayscale version of the image in `inFile` to `outFile`.
+ */
+bool grayscaleFile(std::string const & inFile, std::string const & outFile) {
+  StageTimer timer("grayscaleFile");
+  return streamTransform(inFile, outFile, GrayscaleKernel());
+}
+
+/**
+ * Writes the image in `inFile` with a spotlight centered at (`centerX`,
+ * `centerY`) to `outFile`.
+ */
+bool createSpotlightFile(std::string const & inFile, std::string const & outFile, int centerX, int centerY) {
+  StageTimer timer("createSpotlightFile");
+  return streamTransform(inFile, outFile, SpotlightKernel(centerX, centerY));
+}
+
+/**
+ * Writes an illinify'd version of the image in `inFile` to `outFile`.
+ */
+bool illinifyFile(std::string const & inFile, std::string const & outFile) {
+  StageTimer timer("illinifyFile");
+  return streamTransform(inFile, outFile, IllinifyKernel());
+}
+
+/**
+ * Writes the image in `inFile`, with every hue replaced by the nearest hue
+ * of `palette`, to `outFile`.
+ */
+bool remapHueFile(std::string const & inFile, std::string const & outFile, HuePalette const & palette) {
+  StageTimer timer("remapHueFile");
+  return streamTransform(inFile, outFile, RemapHueKernel(palette));
+}
+
+/**
+ * Writes the image in `inFile`, watermarked by `stencil`, to `outFile`.
+ */
+bool watermarkFile(std::string const & inFile, std::string const & outFile, PNG const & stencil) {
+  StageTimer timer("watermarkFile");
+  return streamTransform(inFile, outFile, WatermarkKernel(stencil));
+}
+
+
+
+/*
+ * Planar versions of the transforms above. Each one only walks the plane(s)
+ * it actually reads or writes, so e.g. grayscale never touches h, l or a.
+ */
+
+/**
+ * Returns a planar image that has been transformed to grayscale.
+ *
+ * @param image A PlanarPNG object which holds the image data to be modified.
+ *
+ * @return The grayscale image.
+ */
+PlanarPNG grayscale(PlanarPNG image) {
+  float * s = image.saturation();
+  unsigned size = image.width() * image.height();
+
+  for (unsigned i = 0; i < size; i++) {
+    s[i] = 0;
+  }
+
+  return image;
+}
+
+
+/**
+ * Returns a planar image with a spotlight centered at (`centerX`, `centerY`).
+ * Only the luminance plane is touched.
+ *
+ * @param image A PlanarPNG object which holds the image data to be modified.
+ * @param centerX The center x coordinate of the spotlight.
+ * @param centerY The center y coordinate of the spotlight.
+ *
+ * @return The image with a spotlight.
+ */
+PlanarPNG createSpotlight(PlanarPNG image, int centerX, int centerY) {
+  SpotlightKernel kernel(centerX, centerY);
+  std::vector<double> factors(image.width());
+  float * l = image.luminance();
+
+  for (unsigned y = 0; y < image.height(); y++) {
+    float * row = l + (y * image.width());
+    kernel.rowFactors(y, image.width(), factors.data());
+
+    for (unsigned x = 0; x < image.width(); x++) {
+      row[x] = row[x] * factors[x];
+    }
+  }
+
+  return image;
+}
+
+
+/**
+ * Returns a planar image with every hue replaced by the nearest hue of
+ * `palette`. Only the hue plane is touched.
+ *
+ * @param image A PlanarPNG object which holds the image data to be modified.
+ * @param palette The hues to snap to.
+ *
+ * @return The recolored image.
+ */
+PlanarPNG remapHue(PlanarPNG image, HuePalette const & palette) {
+  float * h = image.hue();
+  unsigned size = image.width() * image.height();
+
+  for (unsigned i = 0; i < size; i++) {
+    h[i] = palette.nearest(h[i]);
+  }
+
+  return image;
+}
+
+
+/**
+ * Returns a planar image transformed to Illini colors.
+ * Only the hue plane is touched.
+ *
+ * @param image A PlanarPNG object which holds the image data to be modified.
+ *
+ * @return The illinify'd image.
+ */
+PlanarPNG illinify(PlanarPNG image) {
+  return remapHue(image, illiniPalette());
+}
+
+
+/**
+ * Returns a planar image that has been watermarked by another image.
+ * Only the luminance planes of the two images are touched. Pixels of the
+ * stencil that fall outside of the base image are ignored.
+ *
+ * @param firstImage  The base image.
+ * @param secondImage The stencil.
+ *
+ * @return The watermarked image.
+ */
+PlanarPNG watermark(PlanarPNG firstImage, PlanarPNG const & secondImage) {
+  unsigned width = min( firstImage.width(), secondImage.width() );
+  unsigned height = min( firstImage.height(), secondImage.height() );
+  float * base = firstImage.luminance();
+  float const * stencil = secondImage.luminance();
+
+  for (unsigned y = 0; y < height; y++) {
+    float * base_row = base + (y * firstImage.width());
+    float const * stencil_row = stencil + (y * secondImage.width());
+
+    for (unsigned x = 0; x < width; x++) {
+      if ( 1.0f == stencil_row[x] )
+      {
+        base_row[x] = min( base_row[x] + 0.2f, 1.0f );
+      }
+    }
+  }
+
+  return firstImage;
+}
+
+
+
+/*
+ * Fixed-point versions of the transforms above. They work on 8-byte
+ * FixedPixels instead of 32-byte HSLAPixels and only use integer arithmetic
+ * per pixel, except for the spotlight's shared factor table. Written to an
+ * 8-bit PNG file, their results match the PNG transforms to within one
+ * step of a color channel.
+ */
+
+/**
+ * Returns a fixed-point image that has been transformed to grayscale.
+ *
+ * @param image A FixedPNG object which holds the image data to be modified.
+ *
+ * @return The grayscale image.
+ */
+FixedPNG grayscale(FixedPNG image) {
+  for (unsigned y = 0; y < image.height(); y++) {
+    FixedPixel * row = image.row(y);
+    for (unsigned x = 0; x < image.width(); x++) {
+      row[x].s = 0;
+    }
+  }
+
+  return image;
+}
+
+
+/**
+ * Returns a fixed-point image with a spotlight centered at (`centerX`,
+ * `centerY`).
+ *
+ * @param image A FixedPNG object which holds the image data to be modified.
+ * @param centerX The center x coordinate of the spotlight.
+ * @param centerY The center y coordinate of the spotlight.
+ *
+ * @return The image with a spotlight.
+ */
+FixedPNG createSpotlight(FixedPNG image, int centerX, int centerY) {
+  SpotlightKernel kernel(centerX, centerY);
+  std::vector<double> factors(image.width());
+
+  for (unsigned y = 0; y < image.height(); y++) {
+    FixedPixel * row = image.row(y);
+    kernel.rowFactors(y, image.width(), factors.data());
+
+    // every factor is at most 1, so the result stays within 16 bits
+    for (unsigned x = 0; x < image.width(); x++) {
+      row[x].l = static_cast<std::uint16_t>(row[x].l * factors[x] + 0.5);
+    }
+  }
+
+  return image;
+}
+
+
+/**
+ * Returns a fixed-point image with every hue replaced by the nearest hue of
+ * `palette`.
+ *
+ * @param image A FixedPNG object which holds the image data to be modified.
+ * @param palette The hues to snap to.
+ *
+ * @return The recolored image.
+ */
+FixedPNG remapHue(FixedPNG image, HuePalette const & palette) {
+  // there are only HUE_STEPS hues, so each is snapped once up front and
+  // every pixel is a single table lookup
+  std::vector<std::uint16_t> snapped(FixedPixel::HUE_STEPS);
+  for (unsigned hue = 0; hue < FixedPixel::HUE_STEPS; hue++) {
+    HSLAPixel pixel(palette.nearest(hue * (360.0 / FixedPixel::HUE_STEPS)), 0, 0, 0);
+    snapped[hue] = uiuc::toFixed(pixel).h;
+  }
+
+  for (unsigned y = 0; y < image.height(); y++) {
+    FixedPixel * row = image.row(y);
+    for (unsigned x = 0; x < image.width(); x++) {
+      row[x].h = snapped[row[x].h];
+    }
+  }
+
+  return image;
+}
+
+
+/**
+ * Returns a fixed-point image transformed to Illini colors.
+ *
+ * @param image A FixedPNG object which holds the image data to be modified.
+ *
+ * @return The illinify'd image.
+ */
+FixedPNG illinify(FixedPNG image) {
+  return remapHue(image, illiniPalette());
+}
+
+
+/**
+ * Returns a fixed-point image that has been watermarked by another image:
+ * luminances are increased by 0.2 (up to 1) where the stencil's luminance
+ * is 1. Pixels of the stencil that fall outside of the base image are
+ * ignored.
+ *
+ * @param firstImage  The base image.
+ * @param secondImage The stencil.
+ *
+ * @return The watermarked image.
+ */
+FixedPNG watermark(FixedPNG firstImage, FixedPNG const & secondImage) {
+  // 0.2 * ONE is exactly 13107
+  const std::uint32_t increase = FixedPixel::ONE / 5;
+  unsigned width = min( firstImage.width(), secondImage.width() );
+  unsigned height = min( firstImage.height(), secondImage.height() );
+
+  for (unsigned y = 0; y < height; y++) {
+    FixedPixel * base_row = firstImage.row(y);
+    FixedPixel const * stencil_row = secondImage.row(y);
+
+    for (unsigned x = 0; x < width; x++) {
+      if ( stencil_row[x].l == FixedPixel::ONE )
+      {
+        base_row[x].l = static_cast<std::uint16_t>( min( base_row[x].l + increase, FixedPixel::ONE ) );
+      }
+    }
+  }
+
+  return firstImage;
+}
+
+
+
+/*
+ * Region versions of the transforms above. A RegionImage shares its source
+ * image and owns a copy of one region of it, so they only ever touch the
+ * pixels of the region and never copy the rest of the image.
+ */
+
+/**
+ * Returns a region image whose region has been transformed to grayscale.
+ *
+ * @param image A RegionImage object which holds the region to be modified.
+ *
+ * @return The region image with a grayscale region.
+ */
+RegionImage grayscale(RegionImage image) {
+  grayscaleInPlace(image.patch());
+  return image;
+}
+
+
+/**
+ * Returns a region image whose region has been darkened by a spotlight
+ * centered at (`centerX`, `centerY`) of the whole image.
+ *
+ * @param image A RegionImage object which holds the region to be modified.
+ * @param centerX The center x coordinate of the spotlight in the image.
+ * @param centerY The center y coordinate of the spotlight in the image.
+ *
+ * @return The region image with a spotlight in its region.
+ */
+RegionImage createSpotlight(RegionImage image, int centerX, int centerY) {
+  Region region = image.region();
+  createSpotlightInPlace(image.patch(), centerX - static_cast<int>(region.x), centerY - static_cast<int>(region.y));
+  return image;
+}
+
+
+/**
+ * Returns a region image whose region has been transformed to Illini
+ * colors.
+ *
+ * @param image A RegionImage object which holds the region to be modified.
+ *
+ * @return The region image with an illinify'd region.
+ */
+RegionImage illinify(RegionImage image) {
+  illinifyInPlace(image.patch());
+  return image;
+}
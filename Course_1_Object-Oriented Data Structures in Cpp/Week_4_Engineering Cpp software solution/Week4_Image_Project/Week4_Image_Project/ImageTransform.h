@@ -1,9 +1,101 @@
 #pragma once
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "uiuc/PNG.h"
+#include "uiuc/PlanarPNG.h"
+#include "uiuc/FixedPNG.h"
+#include "uiuc/ParallelExecutor.h"
+#include "HuePalette.h"
+#include "Composite.h"
+#include "Filters.h"
+#include "Region.h"
 using namespace uiuc;
 
 PNG grayscale(PNG image);  
 PNG createSpotlight(PNG image, int centerX, int centerY);
+PNG createSpotlight(PNG image, std::vector<std::pair<int, int>> const & centers);
 PNG illinify(PNG image);
+PNG remapHue(PNG image, HuePalette const & palette);
 PNG watermark(PNG firstImage, PNG secondImage);
+PNG watermark(PNG firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode = WatermarkMode::Threshold);
+PNG boxBlur(PNG image, unsigned radius);
+PNG gaussianBlur(PNG image, double sigma);
+PNG sharpen(PNG image, double amount, double sigma = 1.0);
+PNG sobelEdges(PNG image);
+PNG equalizeLuminance(PNG image);
+PNG grayscale(PNG image, Region const & region);
+PNG createSpotlight(PNG image, int centerX, int centerY, Region const & region);
+PNG illinify(PNG image, Region const & region);
+PNG grayscale(PNG image, PNG const & mask);
+PNG createSpotlight(PNG image, int centerX, int centerY, PNG const & mask);
+PNG illinify(PNG image, PNG const & mask);
+
+PNG grayscale(PNG image, ParallelExecutor & executor);
+PNG createSpotlight(PNG image, int centerX, int centerY, ParallelExecutor & executor);
+PNG createSpotlight(PNG image, std::vector<std::pair<int, int>> const & centers, ParallelExecutor & executor);
+PNG illinify(PNG image, ParallelExecutor & executor);
+PNG remapHue(PNG image, HuePalette const & palette, ParallelExecutor & executor);
+PNG watermark(PNG firstImage, PNG secondImage, ParallelExecutor & executor);
+PNG watermark(PNG firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode, ParallelExecutor & executor);
+PNG boxBlur(PNG image, unsigned radius, ParallelExecutor & executor);
+PNG gaussianBlur(PNG image, double sigma, ParallelExecutor & executor);
+PNG sharpen(PNG image, double amount, double sigma, ParallelExecutor & executor);
+PNG sobelEdges(PNG image, ParallelExecutor & executor);
+PNG equalizeLuminance(PNG image, ParallelExecutor & executor);
+
+void grayscaleInPlace(PNG & image);
+void createSpotlightInPlace(PNG & image, int centerX, int centerY);
+void createSpotlightInPlace(PNG & image, std::vector<std::pair<int, int>> const & centers);
+void illinifyInPlace(PNG & image);
+void remapHueInPlace(PNG & image, HuePalette const & palette);
+void watermarkInPlace(PNG & firstImage, PNG const & secondImage);
+void watermarkInPlace(PNG & firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode = WatermarkMode::Threshold);
+void boxBlurInPlace(PNG & image, unsigned radius);
+void gaussianBlurInPlace(PNG & image, double sigma);
+void sharpenInPlace(PNG & image, double amount, double sigma = 1.0);
+void sobelEdgesInPlace(PNG & image);
+void equalizeLuminanceInPlace(PNG & image);
+void grayscaleInPlace(PNG & image, Region const & region);
+void createSpotlightInPlace(PNG & image, int centerX, int centerY, Region const & region);
+void illinifyInPlace(PNG & image, Region const & region);
+void grayscaleInPlace(PNG & image, PNG const & mask);
+void createSpotlightInPlace(PNG & image, int centerX, int centerY, PNG const & mask);
+void illinifyInPlace(PNG & image, PNG const & mask);
+
+void grayscaleInPlace(PNG & image, ParallelExecutor & executor);
+void createSpotlightInPlace(PNG & image, int centerX, int centerY, ParallelExecutor & executor);
+void createSpotlightInPlace(PNG & image, std::vector<std::pair<int, int>> const & centers, ParallelExecutor & executor);
+void illinifyInPlace(PNG & image, ParallelExecutor & executor);
+void remapHueInPlace(PNG & image, HuePalette const & palette, ParallelExecutor & executor);
+void watermarkInPlace(PNG & firstImage, PNG const & secondImage, ParallelExecutor & executor);
+void watermarkInPlace(PNG & firstImage, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode, ParallelExecutor & executor);
+void boxBlurInPlace(PNG & image, unsigned radius, ParallelExecutor & executor);
+void gaussianBlurInPlace(PNG & image, double sigma, ParallelExecutor & executor);
+void sharpenInPlace(PNG & image, double amount, double sigma, ParallelExecutor & executor);
+void sobelEdgesInPlace(PNG & image, ParallelExecutor & executor);
+void equalizeLuminanceInPlace(PNG & image, ParallelExecutor & executor);
+
+bool grayscaleFile(std::string const & inFile, std::string const & outFile);
+bool createSpotlightFile(std::string const & inFile, std::string const & outFile, int centerX, int centerY);
+bool illinifyFile(std::string const & inFile, std::string const & outFile);
+bool remapHueFile(std::string const & inFile, std::string const & outFile, HuePalette const & palette);
+bool watermarkFile(std::string const & inFile, std::string const & outFile, PNG const & stencil);
+
+PlanarPNG grayscale(PlanarPNG image);
+PlanarPNG createSpotlight(PlanarPNG image, int centerX, int centerY);
+PlanarPNG illinify(PlanarPNG image);
+PlanarPNG remapHue(PlanarPNG image, HuePalette const & palette);
+PlanarPNG watermark(PlanarPNG firstImage, PlanarPNG const & secondImage);
+
+FixedPNG grayscale(FixedPNG image);
+FixedPNG createSpotlight(FixedPNG image, int centerX, int centerY);
+FixedPNG illinify(FixedPNG image);
+FixedPNG remapHue(FixedPNG image, HuePalette const & palette);
+FixedPNG watermark(FixedPNG firstImage, FixedPNG const & secondImage);
+
+RegionImage grayscale(RegionImage image);
+RegionImage createSpotlight(RegionImage image, int centerX, int centerY);
+RegionImage illinify(RegionImage image);
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "uiuc/ParallelExecutor.h"
+#include "uiuc/Instrumentation.h"
+#include "Pipeline.h"
+#include "ImageKernels.h"
+#include "Composite.h"
+
+Pipeline::Pipeline(PNG image) : image_(std::move(image)) { }
+
+template <typename Kernel>
+Pipeline & Pipeline::_addStage(Kernel kernel) {
+  stages_.push_back([kernel](HSLAPixel * row, unsigned y, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+      kernel(row[x], x, y);
+    }
+  });
+  return *this;
+}
+
+template <typename Kernel>
+Pipeline & Pipeline::_addRowStage(Kernel kernel) {
+  stages_.push_back(kernel);
+  return *this;
+}
+
+Pipeline & Pipeline::grayscale() {
+  return _addStage(GrayscaleKernel());
+}
+
+Pipeline & Pipeline::spotlight(int centerX, int centerY) {
+  return _addRowStage(SpotlightKernel(centerX, centerY));
+}
+
+Pipeline & Pipeline::spotlight(std::vector<std::pair<int, int>> const & centers) {
+  return _addRowStage(SpotlightKernel(centers));
+}
+
+Pipeline & Pipeline::illinify() {
+  return _addStage(IllinifyKernel());
+}
+
+Pipeline & Pipeline::remapHue(HuePalette const & palette) {
+  palettes_.push_back(std::make_shared<HuePalette>(palette));
+  return _addStage(RemapHueKernel(*palettes_.back()));
+}
+
+Pipeline & Pipeline::watermark(PNG stencil) {
+  return watermark(stencil, 0, 0, WatermarkMode::Threshold);
+}
+
+Pipeline & Pipeline::watermark(PNG stencil, int offsetX, int offsetY, WatermarkMode mode) {
+  return watermark(std::make_shared<PNG const>(std::move(stencil)), offsetX, offsetY, mode);
+}
+
+Pipeline & Pipeline::watermark(std::shared_ptr<PNG const> stencil, int offsetX, int offsetY, WatermarkMode mode) {
+  // convert all of a lazily read stencil now, so that running this or any
+  // other pipeline sharing it only ever reads it
+  convertStencilRows(*stencil, 0, stencil->height());
+  stencils_.push_back(stencil);
+  return _addRowStage(CompositeKernel(image_, *stencil, offsetX, offsetY, mode));
+}
+
+Pipeline & Pipeline::apply(PixelStage stage) {
+  return _addStage(stage);
+}
+
+void Pipeline::_runRows(unsigned yBegin, unsigned yEnd) {
+  for (unsigned y = yBegin; y < yEnd; y++) {
+    HSLAPixel * row = image_.row(y);
+    for (unsigned i = 0; i < stages_.size(); i++) {
+      stages_[i](row, y, image_.width());
+    }
+  }
+}
+
+PNG Pipeline::run() {
+  StageTimer timer("pipeline", static_cast<std::uint64_t>(image_.width()) * image_.height());
+  _runRows(0, image_.height());
+  return std::move(image_);
+}
+
+PNG Pipeline::run(ParallelExecutor & executor) {
+  StageTimer timer("pipeline", static_cast<std::uint64_t>(image_.width()) * image_.height());
+  unsigned rows = ParallelExecutor::tileRows(image_);
+  unsigned tiles = (image_.height() + rows - 1) / rows;
+
+  executor.parallelFor(tiles, [&](unsigned int tile) {
+    _runRows(tile * rows, std::min(image_.height(), (tile + 1) * rows));
+  });
+
+  return std::move(image_);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "uiuc/ParallelExecutor.h"
+#include "HuePalette.h"
+#include "Composite.h"
+using namespace uiuc;
+
+/**
+ * Chains ImageTransform operations into a single pass over the image.
+ *
+ * Each call only records a stage; nothing is computed until run(), which
+ * walks the image once, row by row, and applies every stage to a row while
+ * it is still in cache. Since every stage is a per-pixel map, the result is
+ * the same as calling the transforms one after another, e.g.
+ *
+ *   Pipeline(png).grayscale().spotlight(450, 150).illinify().run()
+ *
+ * gives the same image as illinify(createSpotlight(grayscale(png), 450, 150))
+ * without the intermediate copies.
+ */
+class Pipeline {
+public:
+  /**
+   * Per-pixel stage, called as `stage(pixel, x, y)`.
+   */
+  typedef std::function<void(HSLAPixel &, unsigned, unsigned)> PixelStage;
+
+  /**
+   * Creates a pipeline that transforms a copy of `image`.
+   * @param image The source image.
+   */
+  explicit Pipeline(PNG image);
+
+  /**
+   * Adds a grayscale stage.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & grayscale();
+
+  /**
+   * Adds a spotlight stage centered at (`centerX`, `centerY`).
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & spotlight(int centerX, int centerY);
+
+  /**
+   * Adds a stage with a spotlight at each of `centers`; see the
+   * multi-spotlight createSpotlight.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & spotlight(std::vector<std::pair<int, int>> const & centers);
+
+  /**
+   * Adds an illinify stage.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & illinify();
+
+  /**
+   * Adds a stage that replaces every hue by the nearest hue of `palette`.
+   * The pipeline keeps its own copy of the palette.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & remapHue(HuePalette const & palette);
+
+  /**
+   * Adds a watermark stage using `stencil`. The pipeline keeps its own
+   * copy of the stencil.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & watermark(PNG stencil);
+
+  /**
+   * Adds a watermark stage with the stencil placed at (`offsetX`,
+   * `offsetY`); see the offset watermark in ImageTransform.h. The pipeline
+   * keeps its own copy of the stencil.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & watermark(PNG stencil, int offsetX, int offsetY, WatermarkMode mode = WatermarkMode::Threshold);
+
+  /**
+   * Adds a watermark stage like the one above, sharing `stencil` instead of
+   * copying it. Useful when many pipelines use the same stencil. A lazily
+   * read stencil is converted in full here, so pipelines sharing it can run
+   * on different threads (but should not be built at the same time).
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & watermark(std::shared_ptr<PNG const> stencil, int offsetX, int offsetY,
+                       WatermarkMode mode = WatermarkMode::Threshold);
+
+  /**
+   * Adds a custom per-pixel stage.
+   * @param stage Callable taking (HSLAPixel &, unsigned x, unsigned y). It
+   *        must only read and write the pixel it is given.
+   * @return The pipeline, for chaining.
+   */
+  Pipeline & apply(PixelStage stage);
+
+  /**
+   * Runs all stages in one pass and hands over the result. The pipeline
+   * should not be used afterwards.
+   * @return The transformed image.
+   */
+  PNG run();
+
+  /**
+   * Runs all stages in one pass, one tile of rows per task on `executor`,
+   * and hands over the result. Gives the same image as run().
+   * @return The transformed image.
+   */
+  PNG run(ParallelExecutor & executor);
+
+private:
+  typedef std::function<void(HSLAPixel *, unsigned, unsigned)> RowStage;
+
+  PNG image_;                                          /*< The image being transformed */
+  std::vector<RowStage> stages_;                       /*< Recorded stages, in order */
+  std::vector<std::shared_ptr<PNG const>> stencils_;   /*< Watermark stencils */
+  std::vector<std::shared_ptr<HuePalette>> palettes_;  /*< Copies of remapHue palettes */
+
+  /**
+   * Records a per-pixel kernel as a stage that runs over a whole row.
+   */
+  template <typename Kernel>
+  Pipeline & _addStage(Kernel kernel);
+
+  /**
+   * Records a kernel that can be called on a whole row at a time, as
+   * `kernel(row, y, width)`.
+   */
+  template <typename Kernel>
+  Pipeline & _addRowStage(Kernel kernel);
+
+  /**
+   * Applies every stage to rows [yBegin, yEnd).
+   */
+  void _runRows(unsigned yBegin, unsigned yEnd);
+};
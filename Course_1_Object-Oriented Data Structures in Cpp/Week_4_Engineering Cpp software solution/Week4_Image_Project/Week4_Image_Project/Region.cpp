@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <memory>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "Region.h"
+
+using uiuc::PNG;
+using uiuc::HSLAPixel;
+
+Region clipRegion(Region const & region, unsigned imageWidth, unsigned imageHeight) {
+  Region result = { 0, 0, 0, 0 };
+  if (region.x >= imageWidth || region.y >= imageHeight) { return result; }
+
+  result.x = region.x;
+  result.y = region.y;
+  result.width = std::min(region.width, imageWidth - region.x);
+  result.height = std::min(region.height, imageHeight - region.y);
+  if (result.width == 0 || result.height == 0) { result.width = result.height = 0; }
+  return result;
+}
+
+RegionImage::RegionImage(std::shared_ptr<PNG const> source, Region const & region)
+  : source_(source), region_(clipRegion(region, source->width(), source->height())),
+    patch_(region_.width, region_.height) {
+  // convert all of a lazily read source now, so that reading it later
+  // (from any thread) never writes to it
+  for (unsigned y = 0; y < source_->height(); y++) { source_->row(y); }
+
+  for (unsigned y = 0; y < region_.height; y++) {
+    HSLAPixel const * pixels = source_->row(region_.y + y) + region_.x;
+    std::copy(pixels, pixels + region_.width, patch_.row(y));
+  }
+}
+
+unsigned RegionImage::width() const {
+  return source_->width();
+}
+
+unsigned RegionImage::height() const {
+  return source_->height();
+}
+
+Region RegionImage::region() const {
+  return region_;
+}
+
+PNG const & RegionImage::source() const {
+  return *source_;
+}
+
+PNG & RegionImage::patch() {
+  return patch_;
+}
+
+PNG const & RegionImage::patch() const {
+  return patch_;
+}
+
+HSLAPixel const & RegionImage::getPixel(unsigned x, unsigned y) const {
+  // truncate first, so that an edge pixel inside of the region comes from the patch
+  if (width() > 0 && height() > 0) {
+    x = std::min(x, width() - 1);
+    y = std::min(y, height() - 1);
+  }
+  if (x >= region_.x && x - region_.x < region_.width && y >= region_.y && y - region_.y < region_.height) {
+    return patch_.row(y - region_.y)[x - region_.x];
+  }
+  return source_->getPixel(x, y);
+}
+
+PNG RegionImage::toPNG() const {
+  PNG image = *source_;
+  for (unsigned y = 0; y < region_.height; y++) {
+    HSLAPixel const * pixels = patch_.row(y);
+    std::copy(pixels, pixels + region_.width, image.row(region_.y + y) + region_.x);
+  }
+  return image;
+}
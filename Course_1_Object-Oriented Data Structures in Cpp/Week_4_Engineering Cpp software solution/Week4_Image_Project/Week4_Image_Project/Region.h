@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+
+/**
+ * A rectangle of an image: `width` columns from `x` and `height` rows from
+ * `y`. Transforms given a region only visit the rows and columns inside of
+ * it; parts outside of the image are ignored.
+ */
+struct Region {
+  unsigned x;          /*< First column */
+  unsigned y;          /*< First row */
+  unsigned width;      /*< Number of columns */
+  unsigned height;     /*< Number of rows */
+};
+
+/**
+ * Clips a region against an image.
+ * @return The part of `region` inside of a `imageWidth` x `imageHeight`
+ *         image; its width and height are 0 if there is none.
+ */
+Region clipRegion(Region const & region, unsigned imageWidth, unsigned imageHeight);
+
+/**
+ * An image made of a shared, unmodified source image and a private copy of
+ * one region of it, so that a region can be transformed without
+ * duplicating the rest of the image (copy-on-write at region granularity).
+ *
+ * Only the pixels of the region are copied, once, when the RegionImage is
+ * created; transforming it only touches that copy, and copying it copies
+ * only the region and a reference to the source. The full image is only
+ * put together when toPNG is called.
+ *
+ * Reading the rows of a lazily read PNG converts them, which writes to it,
+ * so the constructor converts all of the source first. RegionImages over
+ * one source can then be used from different threads, but they must not be
+ * created at the same time while the source is still lazily read.
+ */
+class RegionImage {
+public:
+  /**
+   * Creates a region image over `source`, copying the pixels of `region`
+   * (clipped to the source).
+   * @param source The image to share; it must not be modified while this
+   *        region image uses it.
+   * @param region The region that can be modified.
+   */
+  RegionImage(std::shared_ptr<uiuc::PNG const> source, Region const & region);
+
+  /**
+   * Gets the width of the whole image.
+   */
+  unsigned width() const;
+
+  /**
+   * Gets the height of the whole image.
+   */
+  unsigned height() const;
+
+  /**
+   * Gets the region that can be modified, clipped to the image.
+   */
+  Region region() const;
+
+  /**
+   * Gets the shared source image.
+   */
+  uiuc::PNG const & source() const;
+
+  /**
+   * Gets the private pixels of the region: pixel (x, y) of the patch is
+   * pixel (region().x + x, region().y + y) of the image.
+   */
+  uiuc::PNG & patch();
+  uiuc::PNG const & patch() const;
+
+  /**
+   * Gets the pixel at the given coordinates of the whole image: from the
+   * patch inside of the region, from the source elsewhere. Coordinates
+   * outside of the image are truncated to the nearest edge, as in
+   * PNG::getPixel.
+   * @param x X-coordinate of the pixel.
+   * @param y Y-coordinate of the pixel.
+   * @return The pixel at the given coordinates.
+   */
+  uiuc::HSLAPixel const & getPixel(unsigned x, unsigned y) const;
+
+  /**
+   * Puts the whole image together: a copy of the source with the patch
+   * pasted over the region.
+   * @return The combined image.
+   */
+  uiuc::PNG toPNG() const;
+
+private:
+  std::shared_ptr<uiuc::PNG const> source_;   /*< The shared, unmodified image */
+  Region region_;                             /*< The region, clipped to source_ */
+  uiuc::PNG patch_;                           /*< Private pixels of region_ */
+};
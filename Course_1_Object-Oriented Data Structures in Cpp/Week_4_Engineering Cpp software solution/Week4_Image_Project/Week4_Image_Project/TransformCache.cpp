@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+#include "uiuc/FastHash.h"
+#include "uiuc/RawImage.h"
+#include "ImageTransform.h"
+#include "TransformCache.h"
+
+namespace {
+  // Identifies spill files (and their layout version)
+  const char SPILL_MAGIC[8] = { 'H', 'S', 'L', 'A', 'c', 'c', '0', '1' };
+
+  std::string toHex(std::uint64_t value) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+  }
+
+  void writeUint32(std::ostream & out, std::uint32_t value) {
+    out.write(reinterpret_cast<char const *>(&value), sizeof(value));
+  }
+
+  bool readUint32(std::istream & in, std::uint32_t & value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+  }
+}
+
+TransformCache::TransformCache(std::size_t capacityBytes, std::string const & spillDirectory)
+  : capacityBytes_(capacityBytes), spillDirectory_(spillDirectory), bytes_(0),
+    hits_(0), diskHits_(0), misses_(0), evictions_(0) { }
+
+PNG TransformCache::grayscale(PNG const & image) {
+  return getOrCompute(image, "grayscale", [](PNG const & input) { return ::grayscale(input); });
+}
+
+PNG TransformCache::createSpotlight(PNG const & image, int centerX, int centerY) {
+  std::string operation = "spotlight(" + std::to_string(centerX) + "," + std::to_string(centerY) + ")";
+  return getOrCompute(image, operation, [=](PNG const & input) { return ::createSpotlight(input, centerX, centerY); });
+}
+
+PNG TransformCache::illinify(PNG const & image) {
+  return getOrCompute(image, "illinify", [](PNG const & input) { return ::illinify(input); });
+}
+
+PNG TransformCache::watermark(PNG const & image, PNG const & stencil) {
+  std::string operation = "watermark(" + toHex(stencil.computeFastHash()) + ")";
+  return getOrCompute(image, operation, [&](PNG const & input) { return ::watermark(input, stencil); });
+}
+
+PNG TransformCache::getOrCompute(PNG const & image, std::string const & operation,
+                                 std::function<PNG(PNG const &)> const & compute) {
+  std::string key = toHex(image.computeFastHash()) + ":" + operation;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, found->second);
+      hits_++;
+      return found->second->second;
+    }
+  }
+
+  // compute (or read back) without holding the lock; two threads asking for
+  // the same missing result may both compute it, which is harmless
+  PNG result;
+  bool fromDisk = !spillDirectory_.empty() && _unspill(key, result);
+  if (!fromDisk) { result = compute(image); }
+
+  EntryList toSpill;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fromDisk) { diskHits_++; } else { misses_++; }
+    if (index_.find(key) == index_.end()) { _insert(key, result, toSpill); }
+  }
+
+  for (auto const & entry : toSpill) {
+    _spill(entry.first, entry.second);
+  }
+  return result;
+}
+
+void TransformCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+std::size_t TransformCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+std::size_t TransformCache::diskHits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return diskHits_;
+}
+
+std::size_t TransformCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+std::size_t TransformCache::evictions() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return evictions_;
+}
+
+std::size_t TransformCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::size_t TransformCache::bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+std::size_t TransformCache::_imageBytes(PNG const & image) {
+  return static_cast<std::size_t>(image.width()) * image.height() * sizeof(HSLAPixel);
+}
+
+void TransformCache::_insert(std::string const & key, PNG const & image, EntryList & toSpill) {
+  std::size_t size = _imageBytes(image);
+  if (size > capacityBytes_) {
+    if (!spillDirectory_.empty()) { toSpill.push_back(std::make_pair(key, image)); }
+    return;
+  }
+
+  while (bytes_ + size > capacityBytes_) {
+    EntryList::iterator last = std::prev(entries_.end());
+    bytes_ -= _imageBytes(last->second);
+    index_.erase(last->first);
+    if (!spillDirectory_.empty()) {
+      toSpill.splice(toSpill.end(), entries_, last);
+    } else {
+      entries_.erase(last);
+    }
+    evictions_++;
+  }
+
+  entries_.push_front(std::make_pair(key, image));
+  index_[key] = entries_.begin();
+  bytes_ += size;
+}
+
+std::string TransformCache::_spillPath(std::string const & key) const {
+  return spillDirectory_ + "/" + toHex(fastHash64(key.data(), key.size())) + ".hsla";
+}
+
+bool TransformCache::_spill(std::string const & key, PNG const & image) const {
+  std::string path = _spillPath(key);
+  if (std::ifstream(path.c_str())) { return true; }   // results never change, so it is up to date
+
+  // write to a temporary name of our own first, so readers never see a
+  // partial file and two threads spilling the same key never share one
+  std::string partialPath = uiuc::temporaryPath(path);
+  {
+    std::ofstream out(partialPath.c_str(), std::ios::binary);
+    out.write(SPILL_MAGIC, sizeof(SPILL_MAGIC));
+    writeUint32(out, key.size());
+    out.write(key.data(), key.size());
+    writeUint32(out, image.width());
+    writeUint32(out, image.height());
+    for (unsigned y = 0; y < image.height(); y++) {
+      out.write(reinterpret_cast<char const *>(image.row(y)), image.width() * sizeof(HSLAPixel));
+    }
+
+    if (!out) {
+      cerr << "TransformCache: could not write " << partialPath << endl;
+      out.close();
+      std::remove(partialPath.c_str());
+      return false;
+    }
+  }
+
+  return std::rename(partialPath.c_str(), path.c_str()) == 0;
+}
+
+bool TransformCache::_unspill(std::string const & key, PNG & image) const {
+  std::ifstream in(_spillPath(key).c_str(), std::ios::binary);
+  if (!in) { return false; }
+
+  char magic[sizeof(SPILL_MAGIC)];
+  std::uint32_t keySize, width, height;
+  if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), SPILL_MAGIC)) { return false; }
+  if (!readUint32(in, keySize) || keySize != key.size()) { return false; }
+
+  // file names are hashes of keys, so make sure this is really our key
+  std::string storedKey(keySize, '\0');
+  if (!in.read(&storedKey[0], keySize) || storedKey != key) { return false; }
+  if (!readUint32(in, width) || !readUint32(in, height)) { return false; }
+
+  PNG result(width, height);
+  for (unsigned y = 0; y < height; y++) {
+    if (!in.read(reinterpret_cast<char *>(result.row(y)), width * sizeof(HSLAPixel))) { return false; }
+  }
+
+  image = std::move(result);
+  return true;
+}
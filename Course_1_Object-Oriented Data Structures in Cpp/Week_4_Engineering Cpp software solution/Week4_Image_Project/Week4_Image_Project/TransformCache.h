@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "uiuc/PNG.h"
+#include "uiuc/HSLAPixel.h"
+using namespace uiuc;
+
+/**
+ * An in-process LRU cache of transform results, keyed by the content of
+ * the input image and the operation applied to it.
+ *
+ * A result is identified by the 64-bit PNG::computeFastHash of its input
+ * together with a description of the operation, e.g. "spotlight(450,150)".
+ * Cached results are returned as copies, so callers may modify them freely.
+ *
+ * The cache holds at most `capacityBytes` of pixels in memory. When it is
+ * full, the least recently used results are evicted. If a spill directory
+ * is given, evicted results are written there losslessly (all four doubles
+ * of every pixel) and read back on a later miss instead of recomputing
+ * them. Spill files are named after their key, so a directory can be
+ * shared by later runs. All methods are safe to call from several threads.
+ */
+class TransformCache {
+public:
+  /**
+   * Creates an empty cache.
+   * @param capacityBytes Maximum number of bytes of pixels kept in memory.
+   * @param spillDirectory Existing directory for evicted results, or "" to
+   *        discard them.
+   */
+  explicit TransformCache(std::size_t capacityBytes, std::string const & spillDirectory = "");
+
+  TransformCache(TransformCache const & other) = delete;
+  TransformCache & operator= (TransformCache const & other) = delete;
+
+  /**
+   * Cached version of grayscale(image).
+   */
+  PNG grayscale(PNG const & image);
+
+  /**
+   * Cached version of createSpotlight(image, centerX, centerY).
+   */
+  PNG createSpotlight(PNG const & image, int centerX, int centerY);
+
+  /**
+   * Cached version of illinify(image).
+   */
+  PNG illinify(PNG const & image);
+
+  /**
+   * Cached version of watermark(image, stencil); the key includes the hash
+   * of the stencil.
+   */
+  PNG watermark(PNG const & image, PNG const & stencil);
+
+  /**
+   * Gets the result of `operation` on `image`, calling `compute(image)`
+   * only if it is neither in memory nor in the spill directory.
+   * @param image The input image.
+   * @param operation Description of the operation and all of its
+   *        arguments; different results must have different descriptions.
+   * @param compute Computes the result when it is not cached.
+   * @return The result.
+   */
+  PNG getOrCompute(PNG const & image, std::string const & operation, std::function<PNG(PNG const &)> const & compute);
+
+  /**
+   * Drops every result held in memory. Spill files are kept.
+   */
+  void clear();
+
+  /**
+   * Gets the number of results found in memory.
+   */
+  std::size_t hits() const;
+
+  /**
+   * Gets the number of results read back from the spill directory.
+   */
+  std::size_t diskHits() const;
+
+  /**
+   * Gets the number of results that had to be computed.
+   */
+  std::size_t misses() const;
+
+  /**
+   * Gets the number of results evicted from memory.
+   */
+  std::size_t evictions() const;
+
+  /**
+   * Gets the number of results currently in memory.
+   */
+  std::size_t size() const;
+
+  /**
+   * Gets the number of bytes of pixels currently in memory.
+   */
+  std::size_t bytes() const;
+
+private:
+  typedef std::list<std::pair<std::string, PNG>> EntryList;
+
+  std::size_t capacityBytes_;                                  /*< Maximum bytes of pixels in memory */
+  std::string spillDirectory_;                                 /*< Directory for evicted results, "" for none */
+  mutable std::mutex mutex_;                                   /*< Guards everything below */
+  EntryList entries_;                                          /*< Cached results, most recently used first */
+  std::unordered_map<std::string, EntryList::iterator> index_; /*< Key -> entry in entries_ */
+  std::size_t bytes_;                                          /*< Bytes of pixels in entries_ */
+  std::size_t hits_;                                           /*< Results found in memory */
+  std::size_t diskHits_;                                       /*< Results read from the spill directory */
+  std::size_t misses_;                                         /*< Results computed */
+  std::size_t evictions_;                                      /*< Results evicted from memory */
+
+  /**
+   * Gets the bytes of pixels of an image.
+   */
+  static std::size_t _imageBytes(PNG const & image);
+
+  /**
+   * Gets the path of the spill file for `key`.
+   */
+  std::string _spillPath(std::string const & key) const;
+
+  /**
+   * Writes `image` to the spill file for `key`.
+   * @return true, if the file was written.
+   */
+  bool _spill(std::string const & key, PNG const & image) const;
+
+  /**
+   * Reads the spill file for `key` into `image`.
+   * @return true, if there was a valid spill file for `key`.
+   */
+  bool _unspill(std::string const & key, PNG & image) const;
+
+  /**
+   * Adds a result as the most recently used entry. Results are evicted
+   * until it fits; if it is larger than the whole cache, it is not kept in
+   * memory at all. Must be called with mutex_ held.
+   * @param toSpill Receives the results that should go to the spill
+   *        directory, to be written once mutex_ is released.
+   */
+  void _insert(std::string const & key, PNG const & image, EntryList & toSpill);
+};
@@ -0,0 +1,127 @@
+/**
+ * @file Benchmark.cpp
+ * Implementation of the benchmark runner.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "Benchmark.h"
+
+namespace bench {
+  namespace {
+    volatile double sink;
+
+    std::string jsonString(std::string const & text) {
+      std::string result = "\"";
+      for (char c : text) {
+        if (c == '"' || c == '\\') { result += '\\'; }
+        result += c;
+      }
+      return result + "\"";
+    }
+
+    std::string currentDate() {
+      std::time_t now = std::time(nullptr);
+      char buffer[64];
+      std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+      return buffer;
+    }
+  }
+
+  double Result::megapixelsPerSecond() const {
+    return (realNanoseconds > 0) ? megapixels * 1e9 / realNanoseconds : 0;
+  }
+
+  void keep(double value) {
+    sink = value;
+  }
+
+  Runner::Runner(double minSeconds, std::string const & filter) : minSeconds_(minSeconds), filter_(filter) { }
+
+  bool Runner::enabled(std::string const & name) const {
+    return filter_.empty() || name.find(filter_) != std::string::npos;
+  }
+
+  void Runner::run(std::string const & name, double megapixels, std::function<void()> const & body) {
+    if (!enabled(name)) { return; }
+    body();
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    std::clock_t cpuStart = std::clock();
+    double elapsed = 0;
+    unsigned long iterations = 0;
+    do {
+      body();
+      iterations++;
+      elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds_);
+    double cpuElapsed = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+
+    Result result;
+    result.name = name;
+    result.megapixels = megapixels;
+    result.iterations = iterations;
+    result.realNanoseconds = elapsed * 1e9 / iterations;
+    result.cpuNanoseconds = cpuElapsed * 1e9 / iterations;
+    results_.push_back(result);
+
+    std::cout << std::left << std::setw(44) << name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(3) << result.realNanoseconds / 1e6 << " ms"
+              << std::setw(10) << iterations
+              << std::setw(12) << std::setprecision(1) << result.megapixelsPerSecond() << " MPix/s" << std::endl;
+  }
+
+  std::vector<Result> const & Runner::results() const {
+    return results_;
+  }
+
+  bool Runner::writeJson(std::string const & fileName,
+                         std::vector<std::pair<std::string, std::string>> const & context) const {
+    std::ostringstream out;
+    out << std::setprecision(10);
+    out << "{\n  \"context\": {\n";
+    out << "    \"date\": " << jsonString(currentDate()) << ",\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+    for (auto const & entry : context) {
+      out << "    " << jsonString(entry.first) << ": " << jsonString(entry.second) << ",\n";
+    }
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"\n";
+#else
+    out << "    \"library_build_type\": \"debug\"\n";
+#endif
+    out << "  },\n  \"benchmarks\": [";
+
+    for (std::size_t i = 0; i < results_.size(); i++) {
+      Result const & result = results_[i];
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    {\n";
+      out << "      \"name\": " << jsonString(result.name) << ",\n";
+      out << "      \"run_name\": " << jsonString(result.name) << ",\n";
+      out << "      \"run_type\": \"iteration\",\n";
+      out << "      \"iterations\": " << result.iterations << ",\n";
+      out << "      \"real_time\": " << result.realNanoseconds << ",\n";
+      out << "      \"cpu_time\": " << result.cpuNanoseconds << ",\n";
+      out << "      \"time_unit\": \"ns\",\n";
+      out << "      \"megapixels\": " << result.megapixels << ",\n";
+      out << "      \"items_per_second\": " << result.megapixelsPerSecond() * 1e6 << ",\n";
+      out << "      \"mpix_per_second\": " << result.megapixelsPerSecond() << "\n";
+      out << "    }";
+    }
+    out << "\n  ]\n}\n";
+
+    std::ofstream file(fileName.c_str());
+    file << out.str();
+    file.close();
+    if (!file) {
+      std::cerr << "Benchmark error: could not write " << fileName << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,87 @@
+/**
+ * @file Benchmark.h
+ * A small benchmark runner in the style of Google Benchmark: each benchmark
+ * is repeated until it has run for a minimum time, and the results can be
+ * saved as JSON in the same layout as Google Benchmark's --benchmark_out, so
+ * the usual comparison tools can track them release over release.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+  /**
+   * The timing of one benchmark.
+   */
+  struct Result {
+    std::string name;             /*< e.g. "grayscale/4MP" */
+    double megapixels;            /*< Pixels processed per iteration, in millions */
+    unsigned long iterations;     /*< Number of timed iterations */
+    double realNanoseconds;       /*< Wall-clock time per iteration */
+    double cpuNanoseconds;        /*< Process CPU time per iteration, summed over threads */
+
+    /**
+     * Gets the throughput of the benchmark.
+     * @return Millions of pixels per wall-clock second.
+     */
+    double megapixelsPerSecond() const;
+  };
+
+  /**
+   * Keeps the compiler from optimizing away a value that is computed only to
+   * be measured.
+   */
+  void keep(double value);
+
+  class Runner {
+  public:
+    /**
+     * Creates a runner.
+     * @param minSeconds Minimum time each benchmark is repeated for.
+     * @param filter Only benchmarks whose name contains this are run; all
+     *               of them if it is empty.
+     */
+    Runner(double minSeconds, std::string const & filter);
+
+    /**
+     * Checks whether a benchmark would be run, so callers can skip setting
+     * it up.
+     * @param name Name of the benchmark.
+     */
+    bool enabled(std::string const & name) const;
+
+    /**
+     * Times a benchmark and prints its result. `body` runs once untimed to
+     * warm up caches, then repeatedly until `minSeconds` have passed.
+     * @param name Name of the benchmark.
+     * @param megapixels Pixels processed by each call of `body`, in millions.
+     * @param body One iteration of the benchmark.
+     */
+    void run(std::string const & name, double megapixels, std::function<void()> const & body);
+
+    /**
+     * Gets the results of every benchmark run so far, in order.
+     */
+    std::vector<Result> const & results() const;
+
+    /**
+     * Saves the results as Google Benchmark style JSON.
+     * @param fileName Name of the file to be written.
+     * @param context Extra "context" entries, as name and value pairs.
+     * @return true, if the file was written.
+     */
+    bool writeJson(std::string const & fileName,
+                   std::vector<std::pair<std::string, std::string>> const & context) const;
+
+  private:
+    double minSeconds_;             /*< Minimum time per benchmark */
+    std::string filter_;            /*< Substring of the names to run */
+    std::vector<Result> results_;   /*< Results so far */
+  };
+}
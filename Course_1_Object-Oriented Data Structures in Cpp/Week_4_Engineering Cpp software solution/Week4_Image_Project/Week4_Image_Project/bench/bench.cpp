@@ -0,0 +1,342 @@
+/**
+ * @file bench.cpp
+ * Throughput benchmarks of the image project on synthetic images.
+ *
+ *   ./benchmark [--json FILE] [--sizes 1,4,16] [--filter TEXT] [--min-time SECONDS] [--threads N]
+ *
+ * Every benchmark runs once per size, in megapixels. Images are 32 bytes per
+ * pixel in memory and the transforms work on copies, so a 64 MP run needs
+ * several GB of memory; it is left out of the default sizes.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "../ImageTransform.h"
+#include "../Pipeline.h"
+#include "../Region.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/RGB_HSL.h"
+#include "../uiuc/ColorConversion.h"
+#include "../uiuc/FixedPNG.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "../uiuc/Resample.h"
+#include "../uiuc/ImageDiff.h"
+#include "../uiuc/ImageStatistics.h"
+
+using namespace uiuc;
+
+static int usage() {
+  std::cerr << "Usage: benchmark [--json FILE] [--sizes MEGAPIXELS,...] [--filter TEXT]"
+            << " [--min-time SECONDS] [--threads N]" << std::endl;
+  return 1;
+}
+
+static bool parseSizes(std::string const & text, std::vector<unsigned> & sizes) {
+  sizes.clear();
+  std::stringstream stream(text);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    int size = std::atoi(item.c_str());
+    if (size <= 0) { return false; }
+    sizes.push_back(size);
+  }
+  return !sizes.empty();
+}
+
+// A roughly square image of `megapixels` * 2^20 pixels, with smooth
+// gradients and some noise so that it compresses like a photograph
+static PNG createSyntheticImage(unsigned megapixels) {
+  unsigned width = static_cast<unsigned>(std::sqrt(megapixels * 1048576.0)) & ~15u;
+  unsigned height = (megapixels * 1048576u) / width;
+
+  PNG image(width, height);
+  unsigned state = 12345;
+  image.forEachPixel([&](HSLAPixel & pixel, unsigned x, unsigned y) {
+    state = state * 1103515245 + 12345;
+    double noise = ((state >> 16) & 255) / 255.0 * 0.05;
+    pixel.h = std::fmod(x * 360.0 / width + y * 0.1, 360.0);
+    pixel.s = 0.3 + 0.6 * y / height;
+    pixel.l = 0.2 + 0.6 * x / width + noise;
+    pixel.a = 1.0;
+  });
+  return image;
+}
+
+// A stencil as large as `image`, with bright diagonal stripes
+static PNG createStencil(PNG const & image) {
+  PNG stencil(image.width(), image.height());
+  stencil.forEachPixel([&](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel.l = ((x + y) % 64 < 16) ? 1.0 : 0.5;
+    pixel.a = 1.0;
+  });
+  return stencil;
+}
+
+static std::string benchName(std::string const & name, unsigned megapixels) {
+  std::stringstream stream;
+  stream << name << "/" << megapixels << "MP";
+  return stream.str();
+}
+
+static void runFileBenchmarks(bench::Runner & runner, PNG const & image, unsigned size, double megapixels,
+                              ParallelExecutor & executor) {
+  std::stringstream suffix;
+  suffix << "-" << size << "MP.png";
+  std::string inputFile = "bench-input" + suffix.str();
+  std::string outputFile = "bench-output" + suffix.str();
+
+  PNG source = image;
+  source.writeToFile(inputFile);
+
+  runner.run(benchName("readFromFile", size), megapixels, [&]() {
+    PNG png;
+    png.readFromFile(inputFile);
+    bench::keep(png.row(png.height() - 1)[0].l);
+  });
+  runner.run(benchName("readFromFileLazy+rows", size), megapixels, [&]() {
+    PNG png;
+    png.readFromFileLazy(inputFile);
+    double sum = 0;
+    for (unsigned y = 0; y < png.height(); y++) { sum += png.row(y)[0].l; }
+    bench::keep(sum);
+  });
+
+  runner.run(benchName("readFromFile/fixed", size), megapixels, [&]() {
+    FixedPNG png;
+    png.readFromFile(inputFile);
+    bench::keep(png.row(png.height() - 1)[0].l);
+  });
+
+  runner.run(benchName("writeToFile", size), megapixels, [&]() { source.writeToFile(outputFile); });
+
+  PNGEncoderOptions fast;
+  fast.level = 1;
+  runner.run(benchName("writeToFile/level1", size), megapixels, [&]() { source.writeToFile(outputFile, fast); });
+  runner.run(benchName("writeToFile/parallel", size), megapixels, [&]() {
+    source.writeToFile(outputFile, PNGEncoderOptions(), executor);
+  });
+
+  std::remove(inputFile.c_str());
+  std::remove(outputFile.c_str());
+}
+
+static void runColorBenchmarks(bench::Runner & runner, PNG const & image, unsigned size, double megapixels) {
+  std::size_t count = static_cast<std::size_t>(image.width()) * image.height();
+  std::vector<unsigned char> rgba(count * 4);
+  std::vector<HSLAPixel> hsla(count);
+  for (unsigned y = 0; y < image.height(); y++) {
+    hslaToRgba(image.row(y), &rgba[y * static_cast<std::size_t>(image.width()) * 4], image.width());
+  }
+
+  runner.run(benchName("rgb2hsl", size), megapixels, [&]() {
+    double sum = 0;
+    for (std::size_t i = 0; i < count; i++) {
+      rgbaColor color = { rgba[i * 4], rgba[(i * 4) + 1], rgba[(i * 4) + 2], rgba[(i * 4) + 3] };
+      sum += rgb2hsl(color).l;
+    }
+    bench::keep(sum);
+  });
+  runner.run(benchName("rgbaToHsla", size), megapixels, [&]() { rgbaToHsla(&rgba[0], &hsla[0], count); });
+
+  runner.run(benchName("hsl2rgb", size), megapixels, [&]() {
+    unsigned sum = 0;
+    for (std::size_t i = 0; i < count; i++) {
+      hslaColor color = { hsla[i].h, hsla[i].s, hsla[i].l, hsla[i].a };
+      sum += hsl2rgb(color).g;
+    }
+    bench::keep(sum);
+  });
+  runner.run(benchName("hslaToRgba", size), megapixels, [&]() { hslaToRgba(&hsla[0], &rgba[0], count); });
+
+  std::vector<FixedPixel> fixed(count);
+  runner.run(benchName("rgbaToFixed", size), megapixels, [&]() { rgbaToFixed(&rgba[0], &fixed[0], count); });
+  runner.run(benchName("fixedToRgba", size), megapixels, [&]() { fixedToRgba(&fixed[0], &rgba[0], count); });
+}
+
+static void runIterationBenchmarks(bench::Runner & runner, PNG const & image, unsigned size, double megapixels) {
+  runner.run(benchName("getPixel/rowMajor", size), megapixels, [&]() {
+    double sum = 0;
+    for (unsigned y = 0; y < image.height(); y++) {
+      for (unsigned x = 0; x < image.width(); x++) { sum += image.getPixel(x, y).l; }
+    }
+    bench::keep(sum);
+  });
+  // the order of the course's loops: x outer, y inner
+  runner.run(benchName("getPixel/columnMajor", size), megapixels, [&]() {
+    double sum = 0;
+    for (unsigned x = 0; x < image.width(); x++) {
+      for (unsigned y = 0; y < image.height(); y++) { sum += image.getPixel(x, y).l; }
+    }
+    bench::keep(sum);
+  });
+  runner.run(benchName("row", size), megapixels, [&]() {
+    double sum = 0;
+    image.forEachRow([&](HSLAPixel * pixels, unsigned, unsigned width) {
+      for (unsigned x = 0; x < width; x++) { sum += pixels[x].l; }
+    });
+    bench::keep(sum);
+  });
+}
+
+static void runTransformBenchmarks(bench::Runner & runner, PNG const & image, unsigned size, double megapixels,
+                                   ParallelExecutor & executor) {
+  PNG stencil = createStencil(image);
+  int centerX = image.width() / 2;
+  int centerY = image.height() / 2;
+  // in-place benchmarks keep transforming the same copy; every kernel costs
+  // the same whatever the pixel values, so this does not skew the timings
+  PNG work = image;
+
+  runner.run(benchName("grayscale", size), megapixels, [&]() { bench::keep(grayscale(image).row(0)[0].s); });
+  runner.run(benchName("grayscale/inPlace", size), megapixels, [&]() { grayscaleInPlace(work); });
+  runner.run(benchName("grayscale/parallel", size), megapixels, [&]() { grayscaleInPlace(work, executor); });
+
+  runner.run(benchName("createSpotlight", size), megapixels, [&]() {
+    bench::keep(createSpotlight(image, centerX, centerY).row(0)[0].l);
+  });
+  runner.run(benchName("createSpotlight/inPlace", size), megapixels, [&]() {
+    createSpotlightInPlace(work, centerX, centerY);
+  });
+  runner.run(benchName("createSpotlight/parallel", size), megapixels, [&]() {
+    createSpotlightInPlace(work, centerX, centerY, executor);
+  });
+
+  runner.run(benchName("illinify", size), megapixels, [&]() { bench::keep(illinify(image).row(0)[0].h); });
+  runner.run(benchName("illinify/inPlace", size), megapixels, [&]() { illinifyInPlace(work); });
+  runner.run(benchName("illinify/parallel", size), megapixels, [&]() { illinifyInPlace(work, executor); });
+
+  runner.run(benchName("watermark", size), megapixels, [&]() {
+    bench::keep(watermark(image, stencil, 0, 0).row(0)[0].l);
+  });
+  runner.run(benchName("watermark/inPlace", size), megapixels, [&]() {
+    watermarkInPlace(work, stencil, 0, 0);
+  });
+  runner.run(benchName("watermark/parallel", size), megapixels, [&]() {
+    watermarkInPlace(work, stencil, 0, 0, WatermarkMode::Threshold, executor);
+  });
+
+  // fixed-point images are a quarter of the size, so the same transforms
+  // stream a quarter of the memory
+  FixedPNG fixed(image);
+  runner.run(benchName("grayscale/fixed", size), megapixels, [&]() { bench::keep(grayscale(fixed).row(0)[0].s); });
+  runner.run(benchName("createSpotlight/fixed", size), megapixels, [&]() {
+    bench::keep(createSpotlight(fixed, centerX, centerY).row(0)[0].l);
+  });
+  runner.run(benchName("illinify/fixed", size), megapixels, [&]() { bench::keep(illinify(fixed).row(0)[0].h); });
+
+  // a quarter-area region in the middle of the image: the in-place version
+  // only visits the region, the RegionImage version only copies it
+  Region region = { image.width() / 4, image.height() / 4, image.width() / 2, image.height() / 2 };
+  std::shared_ptr<PNG const> shared = std::make_shared<PNG const>(image);
+  runner.run(benchName("grayscale/region", size), megapixels, [&]() {
+    bench::keep(grayscale(image, region).row(0)[0].s);
+  });
+  runner.run(benchName("grayscale/region/inPlace", size), megapixels, [&]() { grayscaleInPlace(work, region); });
+  runner.run(benchName("grayscale/regionImage", size), megapixels, [&]() {
+    bench::keep(grayscale(RegionImage(shared, region)).patch().row(0)[0].s);
+  });
+
+  runner.run(benchName("pipeline", size), megapixels, [&]() {
+    PNG result = Pipeline(image).grayscale().spotlight(centerX, centerY).illinify().run();
+    bench::keep(result.row(0)[0].l);
+  });
+  runner.run(benchName("pipeline/parallel", size), megapixels, [&]() {
+    PNG result = Pipeline(image).grayscale().spotlight(centerX, centerY).illinify().run(executor);
+    bench::keep(result.row(0)[0].l);
+  });
+
+  PNG copy = image;
+  runner.run(benchName("operator==", size), megapixels, [&]() { bench::keep(image == copy); });
+  runner.run(benchName("diffImages", size), megapixels, [&]() { bench::keep(diffImages(image, work).maxError); });
+  runner.run(benchName("diffImages/parallel", size), megapixels, [&]() {
+    bench::keep(diffImages(image, work, 0, NULL, executor).maxError);
+  });
+
+  runner.run(benchName("computeHash", size), megapixels, [&]() { bench::keep(image.computeHash()); });
+  runner.run(benchName("computeFastHash", size), megapixels, [&]() { bench::keep(image.computeFastHash()); });
+
+  runner.run(benchName("resample/bilinear", size), megapixels, [&]() {
+    bench::keep(resample(image, image.width() / 2, image.height() / 2, ResampleFilter::Bilinear).row(0)[0].l);
+  });
+  runner.run(benchName("resample/bilinear/parallel", size), megapixels, [&]() {
+    bench::keep(resample(image, image.width() / 2, image.height() / 2, ResampleFilter::Bilinear, executor).row(0)[0].l);
+  });
+
+  // box blurs at two radii should take about the same time
+  runner.run(benchName("boxBlur/r2", size), megapixels, [&]() { bench::keep(boxBlur(image, 2).row(0)[0].l); });
+  runner.run(benchName("boxBlur/r16", size), megapixels, [&]() { bench::keep(boxBlur(image, 16).row(0)[0].l); });
+  runner.run(benchName("boxBlur/r16/parallel", size), megapixels, [&]() { boxBlurInPlace(work, 16, executor); });
+  runner.run(benchName("gaussianBlur", size), megapixels, [&]() { bench::keep(gaussianBlur(image, 2.0).row(0)[0].l); });
+  runner.run(benchName("gaussianBlur/parallel", size), megapixels, [&]() { gaussianBlurInPlace(work, 2.0, executor); });
+  runner.run(benchName("sobelEdges", size), megapixels, [&]() { bench::keep(sobelEdges(image).row(0)[0].l); });
+  runner.run(benchName("sobelEdges/parallel", size), megapixels, [&]() { sobelEdgesInPlace(work, executor); });
+
+  runner.run(benchName("computeStatistics", size), megapixels, [&]() {
+    bench::keep(computeStatistics(image).luminance.mean);
+  });
+  runner.run(benchName("computeStatistics/parallel", size), megapixels, [&]() {
+    bench::keep(computeStatistics(image, 256, executor).luminance.mean);
+  });
+  runner.run(benchName("equalizeLuminance", size), megapixels, [&]() {
+    bench::keep(equalizeLuminance(image).row(0)[0].l);
+  });
+  runner.run(benchName("equalizeLuminance/parallel", size), megapixels, [&]() {
+    equalizeLuminanceInPlace(work, executor);
+  });
+}
+
+int main(int argc, char *argv[]) {
+  std::string jsonFile;
+  std::string filter;
+  std::vector<unsigned> sizes = { 1, 4, 16 };
+  double minSeconds = 0.5;
+  unsigned threads = 0;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) { return usage(); }
+    std::string value = argv[++i];
+
+    if (arg == "--json") { jsonFile = value; }
+    else if (arg == "--sizes") { if (!parseSizes(value, sizes)) { return usage(); } }
+    else if (arg == "--filter") { filter = value; }
+    else if (arg == "--min-time") { minSeconds = std::atof(value.c_str()); }
+    else if (arg == "--threads") { threads = std::atoi(value.c_str()); }
+    else { return usage(); }
+  }
+
+  bench::Runner runner(minSeconds, filter);
+  ParallelExecutor executor(threads);
+
+  for (unsigned size : sizes) {
+    PNG image = createSyntheticImage(size);
+    double megapixels = image.width() * static_cast<double>(image.height()) / 1e6;
+    std::cout << "--- " << size << " MP (" << image.width() << "x" << image.height() << ")" << std::endl;
+
+    runFileBenchmarks(runner, image, size, megapixels, executor);
+    runColorBenchmarks(runner, image, size, megapixels);
+    runIterationBenchmarks(runner, image, size, megapixels);
+    runTransformBenchmarks(runner, image, size, megapixels, executor);
+  }
+
+  if (!jsonFile.empty()) {
+    std::stringstream threadCount;
+    threadCount << executor.threads();
+    if (!runner.writeJson(jsonFile, { { "executable", argv[0] },
+                                      { "executor_threads", threadCount.str() },
+                                      { "color_conversion", colorConversionKernel() } })) {
+      return 1;
+    }
+    std::cout << "Results written to " << jsonFile << std::endl;
+  }
+  return 0;
+}
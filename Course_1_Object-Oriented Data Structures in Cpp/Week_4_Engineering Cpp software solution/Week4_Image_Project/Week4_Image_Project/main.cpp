@@ -2,29 +2,119 @@
  * @file main.cpp
  * A simple C++ program that manipulates an image.
  *
+ * Run without arguments, it transforms alma.png in a few ways. With
+ * --batch it applies a transform spec to a whole directory (or manifest)
+ * of images:
+ *
+ *   ./ImageTransform --batch INPUTS OUTPUT_DIR SPEC [--level N] [--queue N]
+ *                    [--threads DECODE,TRANSFORM,ENCODE] [--trace FILE]
+ *
+ * See TransformSpec in BatchProcessor.h for the spec syntax. --trace saves
+ * the timing of every decode, transform and encode stage as a Chrome trace
+ * (see uiuc/Instrumentation.h).
+ *
  * @author University of Illinois CS 225 Course Staff
  * @author Updated by University of Illinois CS 400 Course Staff
 **/
 
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
 #include "ImageTransform.h"
+#include "BatchProcessor.h"
 #include "uiuc/PNG.h"
+#include "uiuc/Instrumentation.h"
+
+// Limits of the batch options, which are all kept in memory or started at once
+static const unsigned MAX_QUEUE_CAPACITY = 1024;
+static const unsigned MAX_THREADS = 256;
+
+static int usage() {
+  std::cerr << "Usage: ImageTransform [--batch INPUTS OUTPUT_DIR SPEC [--level N] [--queue N]"
+            << " [--threads DECODE,TRANSFORM,ENCODE] [--trace FILE]]" << std::endl;
+  return 1;
+}
+
+// Parses a whole decimal number from `min` to `max`
+static bool parseUnsigned(std::string const & text, unsigned min, unsigned max, unsigned & value) {
+  if (text.empty() || text[0] < '0' || text[0] > '9') { return false; }   // strtoul accepts "-1"
+  char * end = NULL;
+  errno = 0;
+  unsigned long parsed = std::strtoul(text.c_str(), &end, 10);
+  if (*end != '\0' || errno == ERANGE || parsed < min || parsed > max) { return false; }
+  value = static_cast<unsigned>(parsed);
+  return true;
+}
+
+static int runBatchCommand(std::vector<std::string> const & args) {
+  if (args.size() < 4) { return usage(); }
+
+  BatchOptions options;
+  std::string traceFile;
+  for (unsigned i = 4; i < args.size(); i++) {
+    if (i + 1 >= args.size()) { return usage(); }
+    std::string const & value = args[++i];
+    if (args[i - 1] == "--level") {
+      if (!parseUnsigned(value, 0, 9, options.encoder.level)) { return usage(); }
+    } else if (args[i - 1] == "--queue") {
+      if (!parseUnsigned(value, 1, MAX_QUEUE_CAPACITY, options.queueCapacity)) { return usage(); }
+    } else if (args[i - 1] == "--threads") {
+      std::size_t first = value.find(','), second = value.find(',', first + 1);
+      if (first == std::string::npos || second == std::string::npos ||
+          !parseUnsigned(value.substr(0, first), 1, MAX_THREADS, options.decodeThreads) ||
+          !parseUnsigned(value.substr(first + 1, second - first - 1), 1, MAX_THREADS, options.transformThreads) ||
+          !parseUnsigned(value.substr(second + 1), 1, MAX_THREADS, options.encodeThreads)) { return usage(); }
+    } else if (args[i - 1] == "--trace") {
+      traceFile = value;
+    } else {
+      return usage();
+    }
+  }
+
+  std::vector<std::string> inputs;
+  TransformSpec spec;
+  if (!listBatchInputs(args[1], inputs) || !spec.parse(args[3])) { return 1; }
+
+  if (!traceFile.empty()) { uiuc::Instrumentation::enable(); }
+  BatchReport report = runBatch(inputs, args[2], spec, options);
+  if (!traceFile.empty() && !uiuc::Instrumentation::writeChromeTrace(traceFile)) { return 1; }
+  std::cout << report.processed << " images in " << report.seconds << " s ("
+            << report.imagesPerSecond() << " images/sec), " << report.failed << " failed" << std::endl;
+  return (report.failed == 0) ? 0 : 1;
+}
+
+int main(int argc, char * argv[]) {
+  if (argc > 1) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args[0] != "--batch") { return usage(); }
+    return runBatchCommand(args);
+  }
 
-int main() {
   uiuc::PNG png, png2, result;
 
   png.readFromFile("alma.png");
-  result = grayscale(png);
+
+  // `result` is allocated once; later copies of `png` reuse its pixel buffer
+  result = png;
+  grayscaleInPlace(result);
   result.writeToFile("out-grayscale.png");
   
-  result = createSpotlight(png, 450, 150);
+  result = png;
+  createSpotlightInPlace(result, 450, 150);
   result.writeToFile("out-spotlight.png");
 
-  result = illinify(png);
+  result = png;
+  illinifyInPlace(result);
   result.writeToFile("out-illinify.png");
 
+  // the original is not needed after this, so watermark it directly
   png2.readFromFile("overlay.png");
-  result = watermark(png, png2);
-  result.writeToFile("out-watermark.png");
+  watermarkInPlace(png, png2);
+  png.writeToFile("out-watermark.png");
   
   return 0;
 }
@@ -0,0 +1,18 @@
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "TestImages.h"
+
+PNG createTestPNG(unsigned width, unsigned height, unsigned seed) {
+  PNG png(width, height);
+  png.forEachPixel([seed](HSLAPixel & pixel, unsigned x, unsigned y) {
+    unsigned state = (x * 73856093u) ^ (y * 19349663u) ^ (seed * 83492791u);
+    state = state * 1103515245u + 12345u;
+    state ^= state >> 13;
+    state *= 0x5bd1e995u;
+    state ^= state >> 15;
+
+    double l = ((state >> 16) % 3 == 0) ? 1.0 : ((state >> 18) % 1000) / 1000.0;
+    pixel = HSLAPixel(state % 360, ((state >> 9) % 101) / 100.0, l, ((state >> 4) % 101) / 100.0);
+  });
+  return png;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../uiuc/PNG.h"
+
+using namespace uiuc;
+
+/**
+ * Creates a deterministic test image whose neighbouring pixels differ in
+ * every channel. About a third of the luminances are exactly 1 and the
+ * alphas vary, so thresholds and alpha weighting are exercised too.
+ * @param width Width of the image.
+ * @param height Height of the image.
+ * @param seed Different seeds give different images of the same size.
+ */
+PNG createTestPNG(unsigned width, unsigned height, unsigned seed = 0);
+
+/**
+ * Creates the 360 x 100 rainbow of the part 2 tests: hue x and saturation
+ * y / 100 at luminance 0.5 (defined with those tests).
+ */
+PNG createRainbowPNG();
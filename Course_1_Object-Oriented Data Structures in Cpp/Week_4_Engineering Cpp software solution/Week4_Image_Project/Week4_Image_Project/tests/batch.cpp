@@ -0,0 +1,125 @@
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../BatchProcessor.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "TestImages.h"
+
+// Writes and reads back a PNG, so it only holds what a PNG file can
+static PNG roundTrip(PNG const & png, std::string const & fileName) {
+  PNG copy = png;
+  copy.writeToFile(fileName);
+  PNG result;
+  result.readFromFile(fileName);
+  return result;
+}
+
+TEST_CASE("BoundedQueue hands items over in order and blocks when full", "[weight=1]") {
+  BoundedQueue<int> queue(2);
+  std::vector<int> received;
+
+  std::thread consumer([&] {
+    int item;
+    while (queue.pop(item)) { received.push_back(item); }
+  });
+  for (int i = 0; i < 100; i++) { REQUIRE( queue.push(i) ); }
+  queue.close();
+  consumer.join();
+
+  REQUIRE( received.size() == 100 );
+  for (int i = 0; i < 100; i++) { REQUIRE( received[i] == i ); }
+  REQUIRE( !queue.push(100) );
+}
+
+TEST_CASE("TransformSpec parses stages and rejects bad ones", "[weight=1]") {
+  PNG stencil = createTestPNG(30, 20, 9);
+  stencil.writeToFile("out-batch-stencil.png");
+
+  TransformSpec spec;
+  REQUIRE( spec.parse("grayscale,spotlight:40:-5,illinify,watermark:out-batch-stencil.png:3:4") );
+  REQUIRE( spec.size() == 4 );
+
+  REQUIRE( !spec.parse("grayscale,blur") );
+  REQUIRE( spec.size() == 0 );
+  REQUIRE( !spec.parse("spotlight:1") );
+  REQUIRE( !spec.parse("spotlight:a:b") );
+  REQUIRE( !spec.parse("spotlight:4294967336:0") );
+  REQUIRE( !spec.parse("spotlight:0:-99999999999999999999") );
+  REQUIRE( !spec.parse("watermark:out-missing.png") );
+}
+
+TEST_CASE("runBatch transforms every input like the single-image functions", "[weight=1]") {
+  mkdir("out-batch", 0755);
+  mkdir("out-batch/in", 0755);
+  mkdir("out-batch/out", 0755);
+
+  std::vector<PNG> images;
+  for (unsigned i = 0; i < 7; i++) {
+    images.push_back(roundTrip(createTestPNG(60 + i * 13, 40 + i * 7, i), "out-batch/in/image" + std::to_string(i) + ".png"));
+  }
+
+  std::ofstream("out-batch/manifest.txt") << "# test inputs\n\nout-batch/in/image2.png\n  out-batch/in/image5.png  \n";
+  std::vector<std::string> inputs;
+  REQUIRE( listBatchInputs("out-batch/manifest.txt", inputs) );
+  REQUIRE( inputs == std::vector<std::string>({ "out-batch/in/image2.png", "out-batch/in/image5.png" }) );
+
+  REQUIRE( listBatchInputs("out-batch/in", inputs) );
+  REQUIRE( inputs.size() == 7 );
+  REQUIRE( inputs[0] == "out-batch/in/image0.png" );
+  inputs.push_back("out-batch/in/missing.png");
+
+  TransformSpec spec;
+  REQUIRE( spec.parse("spotlight:30:20,illinify") );
+
+  BatchOptions options;
+  options.decodeThreads = 2;
+  options.transformThreads = 2;
+  options.encodeThreads = 3;
+  options.queueCapacity = 1;
+  BatchReport report = runBatch(inputs, "out-batch/out", spec, options);
+  REQUIRE( report.processed == 7 );
+  REQUIRE( report.failed == 1 );
+  REQUIRE( report.imagesPerSecond() > 0 );
+
+  for (unsigned i = 0; i < 7; i++) {
+    PNG expected = roundTrip(illinify(createSpotlight(images[i], 30, 20)), "out-batch/expected.png");
+    PNG written;
+    REQUIRE( written.readFromFile("out-batch/out/image" + std::to_string(i) + ".png") );
+    REQUIRE( written == expected );
+  }
+}
+
+TEST_CASE("runBatch processes only the first of several inputs with the same name", "[weight=1]") {
+  mkdir("out-batch", 0755);
+  mkdir("out-batch/same", 0755);
+  mkdir("out-batch/same/a", 0755);
+  mkdir("out-batch/same/b", 0755);
+  mkdir("out-batch/same/out", 0755);
+
+  PNG first = roundTrip(createTestPNG(50, 30, 1), "out-batch/same/a/x.png");
+  roundTrip(createTestPNG(70, 20, 2), "out-batch/same/b/x.png");
+  PNG other = roundTrip(createTestPNG(40, 40, 3), "out-batch/same/b/y.png");
+
+  std::vector<std::string> inputs({ "out-batch/same/a/x.png", "out-batch/same/b/x.png", "out-batch/same/b/y.png" });
+  TransformSpec spec;
+  REQUIRE( spec.parse("grayscale") );
+
+  BatchOptions options;
+  options.encodeThreads = 3;
+  BatchReport report = runBatch(inputs, "out-batch/same/out", spec, options);
+  REQUIRE( report.processed == 2 );
+  REQUIRE( report.failed == 1 );
+
+  PNG written;
+  REQUIRE( written.readFromFile("out-batch/same/out/x.png") );
+  REQUIRE( written == roundTrip(grayscale(first), "out-batch/same/expected.png") );
+  REQUIRE( written.readFromFile("out-batch/same/out/y.png") );
+  REQUIRE( written == roundTrip(grayscale(other), "out-batch/same/expected.png") );
+}
@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../TransformCache.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "TestImages.h"
+
+// Creates an empty `out-cache` directory, removing files of earlier runs
+static void createEmptySpillDirectory() {
+  mkdir("out-cache", 0755);
+  DIR * dir = opendir("out-cache");
+  REQUIRE( dir != NULL );
+  for (dirent * entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..") { std::remove(("out-cache/" + name).c_str()); }
+  }
+  closedir(dir);
+}
+
+static std::size_t pixelBytes(unsigned width, unsigned height) {
+  return static_cast<std::size_t>(width) * height * sizeof(HSLAPixel);
+}
+
+TEST_CASE("TransformCache returns cached results without recomputing", "[weight=1]") {
+  PNG png = createTestPNG(60, 40, 0);
+  TransformCache cache(pixelBytes(60, 40) * 10);
+
+  REQUIRE( cache.illinify(png) == illinify(png) );
+  REQUIRE( cache.illinify(png) == illinify(png) );
+  REQUIRE( cache.createSpotlight(png, 10, 20) == createSpotlight(png, 10, 20) );
+  REQUIRE( cache.createSpotlight(png, 20, 10) == createSpotlight(png, 20, 10) );
+  REQUIRE( cache.createSpotlight(png, 10, 20) == createSpotlight(png, 10, 20) );
+
+  // an equal image in a different object hits too
+  PNG copy = png;
+  REQUIRE( cache.illinify(copy) == illinify(png) );
+
+  REQUIRE( cache.hits() == 3 );
+  REQUIRE( cache.misses() == 3 );
+  REQUIRE( cache.evictions() == 0 );
+  REQUIRE( cache.size() == 3 );
+
+  unsigned calls = 0;
+  auto countingGrayscale = [&](PNG const & input) { calls++; return grayscale(input); };
+  cache.getOrCompute(png, "custom", countingGrayscale);
+  cache.getOrCompute(png, "custom", countingGrayscale);
+  REQUIRE( calls == 1 );
+}
+
+TEST_CASE("TransformCache evicts the least recently used results", "[weight=1]") {
+  PNG a = createTestPNG(30, 20, 0);
+  PNG b = createTestPNG(30, 20, 1);
+  PNG c = createTestPNG(30, 20, 2);
+  TransformCache cache(pixelBytes(30, 20) * 2);
+
+  cache.grayscale(a);
+  cache.grayscale(b);
+  cache.grayscale(a);           // a is now the most recently used
+  cache.grayscale(c);           // evicts b
+  REQUIRE( cache.evictions() == 1 );
+  REQUIRE( cache.size() == 2 );
+  REQUIRE( cache.bytes() == pixelBytes(30, 20) * 2 );
+
+  cache.grayscale(a);
+  REQUIRE( cache.hits() == 2 );
+  cache.grayscale(b);
+  REQUIRE( cache.misses() == 4 );
+
+  // results larger than the whole cache are not kept
+  TransformCache tiny(pixelBytes(30, 20) - 1);
+  tiny.grayscale(a);
+  tiny.grayscale(a);
+  REQUIRE( tiny.size() == 0 );
+  REQUIRE( tiny.misses() == 2 );
+}
+
+TEST_CASE("TransformCache reads evicted results back from the spill directory", "[weight=1]") {
+  createEmptySpillDirectory();
+  PNG a = createTestPNG(30, 20, 3);
+  PNG b = createTestPNG(30, 20, 4);
+
+  {
+    TransformCache cache(pixelBytes(30, 20), "out-cache");
+    REQUIRE( cache.createSpotlight(a, 5, 5) == createSpotlight(a, 5, 5) );
+    REQUIRE( cache.createSpotlight(b, 5, 5) == createSpotlight(b, 5, 5) );   // spills a
+    REQUIRE( cache.createSpotlight(a, 5, 5) == createSpotlight(a, 5, 5) );   // read back, spills b
+    REQUIRE( cache.evictions() == 2 );
+    REQUIRE( cache.diskHits() == 1 );
+    REQUIRE( cache.misses() == 2 );
+  }
+
+  // a new cache (e.g. the next run) finds the spilled results too
+  TransformCache cache(pixelBytes(30, 20) * 4, "out-cache");
+  REQUIRE( cache.createSpotlight(b, 5, 5) == createSpotlight(b, 5, 5) );
+  REQUIRE( cache.diskHits() == 1 );
+  REQUIRE( cache.misses() == 0 );
+
+  // a different argument is a different result
+  REQUIRE( cache.createSpotlight(b, 6, 5) == createSpotlight(b, 6, 5) );
+  REQUIRE( cache.misses() == 1 );
+}
+
+TEST_CASE("TransformCache spills from several threads into one directory", "[weight=1]") {
+  createEmptySpillDirectory();
+  PNG a = createTestPNG(30, 20, 5);
+  PNG b = createTestPNG(30, 20, 6);
+
+  // every cache holds one result, so each one spills both keys
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < 4; i++) {
+    threads.push_back(std::thread([&] {
+      TransformCache cache(pixelBytes(30, 20), "out-cache");
+      cache.illinify(a);
+      cache.illinify(b);
+      cache.illinify(a);
+    }));
+  }
+  for (std::thread & thread : threads) { thread.join(); }
+
+  TransformCache cache(pixelBytes(30, 20) * 4, "out-cache");
+  REQUIRE( cache.illinify(a) == illinify(a) );
+  REQUIRE( cache.illinify(b) == illinify(b) );
+  REQUIRE( cache.diskHits() == 2 );
+
+  // no temporary files are left behind
+  unsigned files = 0;
+  DIR * dir = opendir("out-cache");
+  REQUIRE( dir != NULL );
+  for (dirent * entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..") { files++; }
+  }
+  closedir(dir);
+  REQUIRE( files == 2 );
+}
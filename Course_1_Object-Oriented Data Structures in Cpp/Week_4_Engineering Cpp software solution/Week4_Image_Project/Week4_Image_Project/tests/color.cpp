@@ -0,0 +1,62 @@
+#include <cstring>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ColorConversion.h"
+
+using uiuc::HSLAPixel;
+
+TEST_CASE("Batch color conversion matches rgb2hsl/hsl2rgb for every RGB color", "[weight=1]") {
+  // An odd batch size, so the scalar tail of each kernel is exercised too
+  const unsigned batch = 4099;
+  std::vector<unsigned char> rgba(batch * 4), fast(batch * 4), slow(batch * 4);
+  std::vector<HSLAPixel> hslaFast(batch), hslaSlow(batch);
+  unsigned hslMismatches = 0, rgbMismatches = 0;
+
+  for (unsigned color = 0; color < (1u << 24); color += batch) {
+    unsigned count = 0;
+    for (; count < batch && color + count < (1u << 24); count++) {
+      unsigned c = color + count;
+      rgba[(count * 4)]     = c & 0xFF;
+      rgba[(count * 4) + 1] = (c >> 8) & 0xFF;
+      rgba[(count * 4) + 2] = (c >> 16) & 0xFF;
+      rgba[(count * 4) + 3] = (c * 7) & 0xFF;
+    }
+
+    uiuc::rgbaToHsla(rgba.data(), hslaFast.data(), count);
+    uiuc::rgbaToHslaScalar(rgba.data(), hslaSlow.data(), count);
+    if (std::memcmp(hslaFast.data(), hslaSlow.data(), count * sizeof(HSLAPixel)) != 0) { hslMismatches++; }
+
+    uiuc::hslaToRgba(hslaSlow.data(), fast.data(), count);
+    uiuc::hslaToRgbaScalar(hslaSlow.data(), slow.data(), count);
+    if (std::memcmp(fast.data(), slow.data(), count * 4) != 0) { rgbMismatches++; }
+  }
+
+  INFO("kernel: " << uiuc::colorConversionKernel());
+  REQUIRE( hslMismatches == 0 );
+  REQUIRE( rgbMismatches == 0 );
+}
+
+TEST_CASE("Batch hsl-to-rgb conversion matches hsl2rgb for edited pixels", "[weight=1]") {
+  std::vector<HSLAPixel> hsla;
+  for (unsigned h = 0; h <= 360; h += 3) {
+    for (unsigned s = 0; s <= 20; s++) {
+      for (unsigned l = 0; l <= 20; l++) {
+        hsla.push_back(HSLAPixel(h + 0.5 * (s % 2), s * 0.05 + 0.0005 * (l % 3), l * 0.05, (h % 11) / 10.0));
+      }
+    }
+  }
+  // hues outside of [0, 360] and at the edges of each sextant
+  hsla.push_back(HSLAPixel(-30, 0.5, 0.5, 1));
+  hsla.push_back(HSLAPixel(720.5, 0.5, 0.5, 1));
+  hsla.push_back(HSLAPixel(60, 0.5, 0.5, 1));
+  hsla.push_back(HSLAPixel(2e9, 0.5, 0.5, 1));
+
+  std::vector<unsigned char> fast(hsla.size() * 4), slow(hsla.size() * 4);
+  uiuc::hslaToRgba(hsla.data(), fast.data(), hsla.size());
+  uiuc::hslaToRgbaScalar(hsla.data(), slow.data(), hsla.size());
+
+  REQUIRE( fast == slow );
+}
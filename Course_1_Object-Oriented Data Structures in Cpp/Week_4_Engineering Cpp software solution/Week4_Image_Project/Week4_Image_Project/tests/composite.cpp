@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../Composite.h"
+#include "../Pipeline.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "TestImages.h"
+
+// Offset watermark computed pixel by pixel
+static PNG referenceWatermark(PNG const & image, PNG const & stencil, int offsetX, int offsetY, WatermarkMode mode) {
+  PNG result = image;
+  for (unsigned y = 0; y < result.height(); y++) {
+    for (unsigned x = 0; x < result.width(); x++) {
+      int sx = static_cast<int>(x) - offsetX;
+      int sy = static_cast<int>(y) - offsetY;
+      if (sx < 0 || sy < 0 || sx >= static_cast<int>(stencil.width()) || sy >= static_cast<int>(stencil.height())) { continue; }
+
+      HSLAPixel const & s = stencil.row(sy)[sx];
+      HSLAPixel & pixel = result.row(y)[x];
+      if (mode == WatermarkMode::Threshold) {
+        if (s.l >= 1.0) { pixel.l = std::min(pixel.l + 0.2, 1.0); }
+      } else {
+        pixel.l = std::min(pixel.l + 0.2 * (s.l * s.a), 1.0);
+      }
+    }
+  }
+  return result;
+}
+
+TEST_CASE("clipStencil clips against every edge", "[weight=1]") {
+  CompositeRect inside = clipStencil(100, 80, 20, 10, 5, 7);
+  REQUIRE( inside.x == 5 );
+  REQUIRE( inside.y == 7 );
+  REQUIRE( inside.stencilX == 0 );
+  REQUIRE( inside.stencilY == 0 );
+  REQUIRE( inside.width == 20 );
+  REQUIRE( inside.height == 10 );
+
+  CompositeRect topLeft = clipStencil(100, 80, 20, 10, -15, -4);
+  REQUIRE( topLeft.x == 0 );
+  REQUIRE( topLeft.y == 0 );
+  REQUIRE( topLeft.stencilX == 15 );
+  REQUIRE( topLeft.stencilY == 4 );
+  REQUIRE( topLeft.width == 5 );
+  REQUIRE( topLeft.height == 6 );
+
+  CompositeRect bottomRight = clipStencil(100, 80, 20, 10, 90, 75);
+  REQUIRE( bottomRight.x == 90 );
+  REQUIRE( bottomRight.width == 10 );
+  REQUIRE( bottomRight.height == 5 );
+
+  CompositeRect larger = clipStencil(100, 80, 300, 200, -50, -60);
+  REQUIRE( larger.stencilX == 50 );
+  REQUIRE( larger.stencilY == 60 );
+  REQUIRE( larger.width == 100 );
+  REQUIRE( larger.height == 80 );
+
+  REQUIRE( clipStencil(100, 80, 20, 10, 100, 0).width == 0 );
+  REQUIRE( clipStencil(100, 80, 20, 10, -20, 0).width == 0 );
+  REQUIRE( clipStencil(100, 80, 20, 10, 0, -10).height == 0 );
+  REQUIRE( clipStencil(100, 80, 20, 10, 0, 80).height == 0 );
+}
+
+TEST_CASE("watermarkRow matches the scalar version", "[weight=1]") {
+  PNG pixels = createTestPNG(37, 1, 1);
+  PNG stencil = createTestPNG(37, 1, 2);
+
+  WatermarkMode modes[] = { WatermarkMode::Threshold, WatermarkMode::AlphaWeighted };
+  for (WatermarkMode mode : modes) {
+    for (unsigned count = 0; count <= 37; count++) {
+      PNG simd = pixels;
+      PNG scalar = pixels;
+      watermarkRow(simd.row(0), stencil.row(0), count, mode, 0.75);
+      watermarkRowScalar(scalar.row(0), stencil.row(0), count, mode, 0.75);
+      if (!(simd == scalar)) { FAIL("count " << count); }
+    }
+  }
+}
+
+TEST_CASE("Offset watermark only changes the covered pixels", "[weight=1]") {
+  PNG image = createTestPNG(97, 61, 3);
+  PNG stencil = createTestPNG(40, 30, 4);
+
+  int offsets[][2] = { { 0, 0 }, { 13, 9 }, { -7, -11 }, { 80, 50 }, { -39, 60 }, { 97, 0 }, { -40, -30 } };
+  WatermarkMode modes[] = { WatermarkMode::Threshold, WatermarkMode::AlphaWeighted };
+  for (WatermarkMode mode : modes) {
+    for (auto const & offset : offsets) {
+      PNG expected = referenceWatermark(image, stencil, offset[0], offset[1], mode);
+      if (!(watermark(image, stencil, offset[0], offset[1], mode) == expected)) {
+        FAIL("offset (" << offset[0] << ", " << offset[1] << ")");
+      }
+    }
+  }
+}
+
+TEST_CASE("Offset watermark gives the same result on every path", "[weight=1]") {
+  PNG image = createTestPNG(150, 120, 5);
+  PNG stencil = createTestPNG(70, 200, 6);
+  PNG expected = referenceWatermark(image, stencil, 100, -30, WatermarkMode::AlphaWeighted);
+
+  ParallelExecutor executor(3);
+  REQUIRE( watermark(image, stencil, 100, -30, WatermarkMode::AlphaWeighted, executor) == expected );
+
+  PNG inPlace = image;
+  watermarkInPlace(inPlace, stencil, 100, -30, WatermarkMode::AlphaWeighted);
+  REQUIRE( inPlace == expected );
+
+  inPlace = image;
+  watermarkInPlace(inPlace, stencil, 100, -30, WatermarkMode::AlphaWeighted, executor);
+  REQUIRE( inPlace == expected );
+
+  REQUIRE( Pipeline(image).watermark(stencil, 100, -30, WatermarkMode::AlphaWeighted).run() == expected );
+  REQUIRE( Pipeline(image).watermark(stencil, 100, -30, WatermarkMode::AlphaWeighted).run(executor) == expected );
+}
+
+TEST_CASE("Offset watermark works with a lazily read stencil on an executor", "[weight=1]") {
+  PNG image = createTestPNG(150, 200, 9);
+  PNG stencil = createTestPNG(120, 180, 10);
+  REQUIRE( stencil.writeToFile("out-composite-stencil.png") );
+  PNG eager;
+  REQUIRE( eager.readFromFile("out-composite-stencil.png") );
+  PNG expected = referenceWatermark(image, eager, 7, 5, WatermarkMode::AlphaWeighted);
+
+  // an offset of 5 makes every stencil band span two tiles of the image
+  ParallelExecutor executor(4);
+  PNG lazy;
+  REQUIRE( lazy.readFromFileLazy("out-composite-stencil.png") );
+  REQUIRE( watermark(image, lazy, 7, 5, WatermarkMode::AlphaWeighted, executor) == expected );
+
+  REQUIRE( lazy.readFromFileLazy("out-composite-stencil.png") );
+  PNG inPlace = image;
+  watermarkInPlace(inPlace, lazy, 7, 5, WatermarkMode::AlphaWeighted, executor);
+  REQUIRE( inPlace == expected );
+}
+
+TEST_CASE("watermark with a larger stencil matches the original behaviour", "[weight=1]") {
+  PNG image = createTestPNG(64, 48, 7);
+  PNG stencil = createTestPNG(100, 100, 8);
+  PNG expected = referenceWatermark(image, stencil, 0, 0, WatermarkMode::Threshold);
+
+  REQUIRE( watermark(image, stencil) == expected );
+  REQUIRE( Pipeline(image).watermark(stencil).run() == expected );
+}
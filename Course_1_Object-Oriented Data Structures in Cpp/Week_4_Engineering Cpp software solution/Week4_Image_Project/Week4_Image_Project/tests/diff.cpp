@@ -0,0 +1,111 @@
+#include <cmath>
+#include <limits>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ImageDiff.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "TestImages.h"
+
+TEST_CASE("pixelError takes the largest channel error, with hue around the wheel", "[weight=1]") {
+  REQUIRE( pixelError(HSLAPixel(10, 0.5, 0.5, 1), HSLAPixel(10, 0.5, 0.5, 1)) == 0 );
+  REQUIRE( pixelError(HSLAPixel(350, 0.5, 0.5, 1), HSLAPixel(8, 0.5, 0.5, 1)) == Approx(18.0 / 180) );
+  REQUIRE( pixelError(HSLAPixel(0, 0.5, 0.5, 1), HSLAPixel(180, 0.5, 0.5, 1)) == Approx(1.0) );
+  REQUIRE( pixelError(HSLAPixel(0, 0.5, 0.5, 1), HSLAPixel(0, 0.5, 0.75, 0.9)) == Approx(0.25) );
+  REQUIRE( pixelError(HSLAPixel(0, std::numeric_limits<double>::quiet_NaN(), 0.5, 1), HSLAPixel(0, 0.5, 0.5, 1)) == 1.0 );
+}
+
+TEST_CASE("diffImages of identical images finds no mismatches", "[weight=1]") {
+  PNG png = createTestPNG(200, 150);
+  PNG copy = png;
+
+  ImageDiff diff = diffImages(png, copy);
+  REQUIRE( diff.matches() );
+  REQUIRE( diff.mismatches == 0 );
+  REQUIRE( diff.maxError == 0 );
+  REQUIRE( diff.boundsWidth == 0 );
+  REQUIRE( diff.boundsHeight == 0 );
+  REQUIRE( png == copy );
+}
+
+TEST_CASE("diffImages counts mismatches above the tolerance and bounds them", "[weight=1]") {
+  PNG expected = createTestPNG(300, 200);
+  PNG actual = expected;
+  actual.getPixel(40, 30).l += 0.01;
+  actual.getPixel(250, 170).s += 0.2;
+  actual.getPixel(100, 100).h += 0.5;
+
+  ImageDiff diff = diffImages(actual, expected);
+  REQUIRE( !diff.matches() );
+  REQUIRE( diff.sameSize );
+  REQUIRE( diff.mismatches == 3 );
+  REQUIRE( diff.maxError == Approx(0.2) );
+  REQUIRE( diff.maxErrorX == 250 );
+  REQUIRE( diff.maxErrorY == 170 );
+  REQUIRE( diff.boundsX == 40 );
+  REQUIRE( diff.boundsY == 30 );
+  REQUIRE( diff.boundsWidth == 211 );
+  REQUIRE( diff.boundsHeight == 141 );
+  REQUIRE( actual != expected );
+
+  // small errors pass with a tolerance
+  diff = diffImages(actual, expected, 0.05);
+  REQUIRE( diff.mismatches == 1 );
+  REQUIRE( diff.boundsX == 250 );
+  REQUIRE( diff.boundsWidth == 1 );
+  REQUIRE( diff.maxError == Approx(0.2) );
+}
+
+TEST_CASE("diffImages counts pixels outside of either image as mismatches", "[weight=1]") {
+  PNG wide = createTestPNG(30, 10);
+  PNG tall = createTestPNG(20, 15);
+
+  ImageDiff diff = diffImages(wide, tall);
+  REQUIRE( !diff.sameSize );
+  REQUIRE( diff.mismatches == (30 * 15) - (20 * 10) );
+  REQUIRE( diff.boundsX == 0 );
+  REQUIRE( diff.boundsY == 0 );
+  REQUIRE( diff.boundsWidth == 30 );
+  REQUIRE( diff.boundsHeight == 15 );
+  REQUIRE( diff.maxError == 1.0 );
+}
+
+TEST_CASE("diffImages gives the same result and heatmap on an executor", "[weight=1]") {
+  PNG expected = createTestPNG(123, 700);
+  expected.getPixel(5, 650) = HSLAPixel(10, 0.5, 0.5, 1);
+  PNG actual = grayscale(expected);
+  actual.getPixel(5, 650).a = 0.5;
+
+  PNG heatmap, parallelHeatmap;
+  ImageDiff diff = diffImages(actual, expected, 0.1, &heatmap);
+  ParallelExecutor executor(4);
+  ImageDiff parallelDiff = diffImages(actual, expected, 0.1, &parallelHeatmap, executor);
+
+  REQUIRE( parallelDiff.mismatches == diff.mismatches );
+  REQUIRE( parallelDiff.maxError == diff.maxError );
+  REQUIRE( parallelDiff.maxErrorX == diff.maxErrorX );
+  REQUIRE( parallelDiff.maxErrorY == diff.maxErrorY );
+  REQUIRE( parallelDiff.boundsX == diff.boundsX );
+  REQUIRE( parallelDiff.boundsY == diff.boundsY );
+  REQUIRE( parallelDiff.boundsWidth == diff.boundsWidth );
+  REQUIRE( parallelDiff.boundsHeight == diff.boundsHeight );
+  REQUIRE( parallelHeatmap == heatmap );
+
+  REQUIRE( heatmap.width() == 123 );
+  REQUIRE( heatmap.height() == 700 );
+  REQUIRE( heatmap.getPixel(5, 650).s == 1 );
+  REQUIRE( heatmap.getPixel(5, 650).h == Approx(30) );
+}
+
+TEST_CASE("diffImages works on lazily read images", "[weight=1]") {
+  PNG eager, lazy;
+  REQUIRE( eager.readFromFile("alma.png") );
+  REQUIRE( lazy.readFromFileLazy("alma.png") );
+
+  ParallelExecutor executor(3);
+  REQUIRE( diffImages(lazy, eager, 0, NULL, executor).matches() );
+  REQUIRE( lazy == eager );
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../Filters.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "TestImages.h"
+
+// The direct 2D computation: the weighted sum of the luminances around
+// (x, y), with the edges repeated
+static double referenceFilter(PNG const & png, unsigned x, unsigned y,
+                              std::vector<double> const & rowWeights, std::vector<double> const & columnWeights) {
+  long rowRadius = rowWeights.size() / 2;
+  long columnRadius = columnWeights.size() / 2;
+  double sum = 0;
+  for (long j = -columnRadius; j <= columnRadius; j++) {
+    long sy = std::min(std::max(static_cast<long>(y) + j, 0L), static_cast<long>(png.height()) - 1);
+    for (long i = -rowRadius; i <= rowRadius; i++) {
+      long sx = std::min(std::max(static_cast<long>(x) + i, 0L), static_cast<long>(png.width()) - 1);
+      sum += rowWeights[i + rowRadius] * columnWeights[j + columnRadius] * png.getPixel(sx, sy).l;
+    }
+  }
+  return sum;
+}
+
+TEST_CASE("boxBlur matches the direct mean for every radius", "[weight=1]") {
+  PNG png = createTestPNG(37, 90);
+
+  unsigned radii[] = { 1, 2, 5, 40 };
+  for (unsigned radius : radii) {
+    PNG blurred = boxBlur(png, radius);
+    std::vector<double> weights((2 * radius) + 1, 1.0 / ((2 * radius) + 1));
+
+    for (unsigned y = 0; y < png.height(); y += 7) {
+      for (unsigned x = 0; x < png.width(); x += 3) {
+        REQUIRE( blurred.getPixel(x, y).l == Approx(referenceFilter(png, x, y, weights, weights)).margin(1e-5) );
+        REQUIRE( blurred.getPixel(x, y).h == png.getPixel(x, y).h );
+        REQUIRE( blurred.getPixel(x, y).s == png.getPixel(x, y).s );
+        REQUIRE( blurred.getPixel(x, y).a == png.getPixel(x, y).a );
+      }
+    }
+  }
+
+  REQUIRE( boxBlur(png, 0) == png );
+}
+
+TEST_CASE("gaussianBlur matches the direct 2D convolution", "[weight=1]") {
+  PNG png = createTestPNG(50, 41);
+  PNG blurred = gaussianBlur(png, 1.5);
+
+  std::vector<float> kernel = gaussianKernel(1.5);
+  REQUIRE( kernel.size() == 11 );
+  double total = 0;
+  for (float weight : kernel) { total += weight; }
+  REQUIRE( total == Approx(1.0) );
+
+  std::vector<double> weights(kernel.begin(), kernel.end());
+  for (unsigned y = 0; y < png.height(); y += 5) {
+    for (unsigned x = 0; x < png.width(); x += 3) {
+      REQUIRE( blurred.getPixel(x, y).l == Approx(referenceFilter(png, x, y, weights, weights)).margin(1e-5) );
+    }
+  }
+  REQUIRE( gaussianKernel(0) == std::vector<float>(1, 1.0f) );
+  REQUIRE( gaussianKernel(std::nan("")) == std::vector<float>(1, 1.0f) );
+  REQUIRE( gaussianBlur(png, -1) == png );
+  REQUIRE( gaussianBlur(png, std::nan("")) == png );
+  REQUIRE( sharpen(png, 1.0, std::nan("")) == png );
+}
+
+TEST_CASE("sharpen leaves flat areas alone and increases local contrast", "[weight=1]") {
+  PNG flat(30, 30);
+  flat.forEachPixel([](HSLAPixel & pixel, unsigned, unsigned) { pixel = HSLAPixel(0, 0, 0.4, 1); });
+  PNG sharpened = sharpen(flat, 1.0);
+  REQUIRE( sharpened.getPixel(15, 15).l == Approx(0.4).margin(1e-5) );
+
+  PNG step(30, 30);
+  step.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned) { pixel = HSLAPixel(0, 0, (x < 15) ? 0.4 : 0.6, 1); });
+  sharpened = sharpen(step, 1.0);
+  REQUIRE( sharpened.getPixel(14, 10).l < 0.4 );
+  REQUIRE( sharpened.getPixel(15, 10).l > 0.6 );
+  REQUIRE( sharpened.getPixel(0, 10).l == Approx(0.4).margin(1e-5) );
+
+  REQUIRE( sharpen(step, 0) == step );
+}
+
+TEST_CASE("sobelEdges finds edges and scales a full step to 1", "[weight=1]") {
+  PNG step(20, 20);
+  step.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned) { pixel = HSLAPixel(0, 0, (x < 10) ? 0 : 1, 1); });
+
+  PNG edges = sobelEdges(step);
+  REQUIRE( edges.getPixel(3, 5).l == 0 );
+  REQUIRE( edges.getPixel(16, 5).l == 0 );
+  REQUIRE( edges.getPixel(9, 5).l == Approx(1.0) );
+  REQUIRE( edges.getPixel(10, 5).l == Approx(1.0) );
+
+  PNG diagonal = createTestPNG(25, 25);
+  PNG diagonalEdges = sobelEdges(diagonal);
+  std::vector<double> smooth = { 1, 2, 1 };
+  std::vector<double> derivative = { -1, 0, 1 };
+  for (unsigned y = 0; y < 25; y += 4) {
+    for (unsigned x = 0; x < 25; x += 4) {
+      double gx = referenceFilter(diagonal, x, y, derivative, smooth);
+      double gy = referenceFilter(diagonal, x, y, smooth, derivative);
+      double expected = std::min(1.0, std::sqrt(gx * gx + gy * gy) / 4);
+      REQUIRE( diagonalEdges.getPixel(x, y).l == Approx(expected).margin(1e-5) );
+    }
+  }
+}
+
+TEST_CASE("Filters give the same result on an executor and in place", "[weight=1]") {
+  PNG png = createTestPNG(173, 301);
+  ParallelExecutor executor(4);
+
+  REQUIRE( boxBlur(png, 9, executor) == boxBlur(png, 9) );
+  REQUIRE( gaussianBlur(png, 2.0, executor) == gaussianBlur(png, 2.0) );
+  REQUIRE( sharpen(png, 0.7, 1.2, executor) == sharpen(png, 0.7, 1.2) );
+  REQUIRE( sobelEdges(png, executor) == sobelEdges(png) );
+
+  PNG inPlace = png;
+  gaussianBlurInPlace(inPlace, 2.0, executor);
+  REQUIRE( inPlace == gaussianBlur(png, 2.0) );
+  inPlace = png;
+  sobelEdgesInPlace(inPlace);
+  REQUIRE( inPlace == sobelEdges(png) );
+}
+
+TEST_CASE("Filters work on lazily read images", "[weight=1]") {
+  PNG eager, lazy;
+  REQUIRE( eager.readFromFile("alma.png") );
+  REQUIRE( lazy.readFromFileLazy("alma.png") );
+
+  ParallelExecutor executor(3);
+  boxBlurInPlace(lazy, 3, executor);
+  REQUIRE( lazy == boxBlur(eager, 3) );
+}
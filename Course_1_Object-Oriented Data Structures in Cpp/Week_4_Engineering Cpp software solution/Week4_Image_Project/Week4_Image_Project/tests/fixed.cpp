@@ -0,0 +1,124 @@
+#include <cstdlib>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/FixedPixel.h"
+#include "../uiuc/FixedPNG.h"
+#include "../uiuc/PixelPool.h"
+
+// Largest difference of any channel between two 8-bit images
+static int maxChannelDifference(std::string const & firstFile, std::string const & secondFile) {
+  FixedPNG first, second;
+  REQUIRE( first.readFromFile(firstFile) );
+  REQUIRE( second.readFromFile(secondFile) );
+  REQUIRE( first.width() == second.width() );
+  REQUIRE( first.height() == second.height() );
+
+  std::vector<unsigned char> firstBytes(first.width() * 4), secondBytes(second.width() * 4);
+  int largest = 0;
+  for (unsigned y = 0; y < first.height(); y++) {
+    fixedToRgba(first.row(y), firstBytes.data(), first.width());
+    fixedToRgba(second.row(y), secondBytes.data(), second.width());
+    for (unsigned i = 0; i < firstBytes.size(); i++) {
+      largest = std::max(largest, std::abs(firstBytes[i] - secondBytes[i]));
+    }
+  }
+  return largest;
+}
+
+TEST_CASE("Every RGBA8 color round-trips exactly through FixedPixel", "[weight=1]") {
+  std::vector<unsigned char> rgba(4 * 65536), back(4 * 65536);
+  std::vector<FixedPixel> fixed(65536);
+  unsigned mismatches = 0;
+
+  for (unsigned red = 0; red < 256; red++) {
+    for (unsigned i = 0; i < 65536; i++) {
+      rgba[(4 * i)] = red;
+      rgba[(4 * i) + 1] = i >> 8;
+      rgba[(4 * i) + 2] = i & 255;
+      rgba[(4 * i) + 3] = (i + red) & 255;
+    }
+    rgbaToFixed(rgba.data(), fixed.data(), 65536);
+    fixedToRgba(fixed.data(), back.data(), 65536);
+    if (rgba != back) { mismatches++; }
+  }
+
+  REQUIRE( mismatches == 0 );
+}
+
+TEST_CASE("FixedPixel is 8 bytes and converts to and from HSLAPixel", "[weight=1]") {
+  REQUIRE( sizeof(FixedPixel) == 8 );
+
+  FixedPixel pixel = toFixed(HSLAPixel(216, 0.5, 0.25, 1));
+  REQUIRE( pixel.s == 32768 );
+  REQUIRE( pixel.l == 16384 );
+  REQUIRE( pixel.a == 65535 );
+  REQUIRE( toHSLA(pixel).h == Approx(216).margin(0.003) );
+  REQUIRE( toHSLA(pixel).l == Approx(0.25).margin(1e-5) );
+
+  REQUIRE( toFixed(HSLAPixel(-90, 2, -1, 0.5)).h == toFixed(HSLAPixel(270, 0, 0, 0)).h );
+  REQUIRE( toFixed(HSLAPixel(-90, 2, -1, 0.5)).s == 65535 );
+  REQUIRE( toFixed(HSLAPixel(-90, 2, -1, 0.5)).l == 0 );
+  REQUIRE( toFixed(HSLAPixel(359.999, 0, 0, 0)).h == 0 );
+}
+
+TEST_CASE("FixedPNG reads and writes PNG files without changing a pixel", "[weight=1]") {
+  FixedPNG image;
+  REQUIRE( image.readFromFile("alma.png") );
+  REQUIRE( image.writeToFile("out-fixed-alma.png") );
+
+  PNG original, written;
+  REQUIRE( original.readFromFile("alma.png") );
+  REQUIRE( written.readFromFile("out-fixed-alma.png") );
+  REQUIRE( written == original );
+
+  FixedPNG copy(original);
+  REQUIRE( copy.width() == original.width() );
+  REQUIRE( copy.getPixel(10, 20).l == Approx(original.getPixel(10, 20).l).margin(1e-5) );
+  REQUIRE( FixedPNG(copy.toPNG()) == copy );
+}
+
+TEST_CASE("Fixed-point transforms match the PNG transforms to one step", "[weight=1]") {
+  PNG png;
+  REQUIRE( png.readFromFile("alma.png") );
+  FixedPNG fixed;
+  REQUIRE( fixed.readFromFile("alma.png") );
+
+  grayscale(png).writeToFile("out-fixed-expected.png");
+  grayscale(fixed).writeToFile("out-fixed-actual.png");
+  REQUIRE( maxChannelDifference("out-fixed-expected.png", "out-fixed-actual.png") <= 1 );
+
+  createSpotlight(png, 450, 150).writeToFile("out-fixed-expected.png");
+  createSpotlight(fixed, 450, 150).writeToFile("out-fixed-actual.png");
+  REQUIRE( maxChannelDifference("out-fixed-expected.png", "out-fixed-actual.png") <= 1 );
+
+  illinify(png).writeToFile("out-fixed-expected.png");
+  illinify(fixed).writeToFile("out-fixed-actual.png");
+  REQUIRE( maxChannelDifference("out-fixed-expected.png", "out-fixed-actual.png") <= 1 );
+
+  PNG stencil(png.width() / 2, png.height() / 2);
+  stencil.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel(0, 0, ((x + y) % 8 < 3) ? 1.0 : 0.5, 1);
+  });
+  watermark(png, stencil).writeToFile("out-fixed-expected.png");
+  watermark(fixed, FixedPNG(stencil)).writeToFile("out-fixed-actual.png");
+  REQUIRE( maxChannelDifference("out-fixed-expected.png", "out-fixed-actual.png") <= 1 );
+}
+
+TEST_CASE("FixedPNG buffers come from the PixelPool", "[weight=1]") {
+  PixelPool::trim();
+  FixedPNG image(1000, 1000);
+
+  // warm up: one copy for the argument of grayscale, one for its result
+  for (unsigned i = 0; i < 2; i++) { grayscale(image); }
+
+  PixelPool::resetStatistics();
+  FixedPNG gray = grayscale(image);
+  REQUIRE( PixelPool::statistics().allocations == 0 );
+  REQUIRE( PixelPool::statistics().reuses >= 1 );
+  REQUIRE( gray.getPixel(999, 999).l == 0 );
+}
@@ -0,0 +1,116 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "../uiuc/Instrumentation.h"
+
+// The records of the stage named `name`
+static std::vector<StageRecord> recordsNamed(char const * name) {
+  std::vector<StageRecord> result;
+  for (StageRecord const & record : Instrumentation::records()) {
+    if (std::strcmp(record.name, name) == 0) { result.push_back(record); }
+  }
+  return result;
+}
+
+static std::string readText(std::string const & fileName) {
+  std::ifstream file(fileName.c_str());
+  std::stringstream text;
+  text << file.rdbuf();
+  return text.str();
+}
+
+TEST_CASE("Nothing is recorded while instrumentation is disabled", "[weight=1]") {
+  Instrumentation::disable();
+  Instrumentation::clear();
+
+  PNG png;
+  png.readFromFile("alma.png");
+  grayscaleInPlace(png);
+
+  REQUIRE( Instrumentation::records().empty() );
+}
+
+TEST_CASE("Reading a PNG records its decode and conversion stages", "[weight=1]") {
+  Instrumentation::clear();
+  Instrumentation::enable();
+  PNG png;
+  png.readFromFile("alma.png");
+  Instrumentation::disable();
+
+  std::uint64_t pixels = static_cast<std::uint64_t>(png.width()) * png.height();
+  std::vector<StageRecord> read = recordsNamed("png.read");
+  std::vector<StageRecord> decode = recordsNamed("png.decode");
+  std::vector<StageRecord> convert = recordsNamed("png.rgbaToHsla");
+  REQUIRE( read.size() == 1 );
+  REQUIRE( decode.size() == 1 );
+  REQUIRE( convert.size() == 1 );
+
+  REQUIRE( read[0].depth == 0 );
+  REQUIRE( decode[0].depth == 1 );
+  REQUIRE( convert[0].depth == 1 );
+  REQUIRE( read[0].pixels == pixels );
+  REQUIRE( convert[0].pixels == pixels );
+
+  // the decoded bytes and the pixels both count towards the read
+  REQUIRE( decode[0].bytesAllocated == pixels * 4 );
+  REQUIRE( read[0].bytesAllocated == pixels * (4 + sizeof(HSLAPixel)) );
+
+  REQUIRE( decode[0].startNanoseconds >= read[0].startNanoseconds );
+  REQUIRE( decode[0].startNanoseconds + decode[0].durationNanoseconds <=
+           read[0].startNanoseconds + read[0].durationNanoseconds );
+}
+
+TEST_CASE("Transforms record the pixels they process on every thread", "[weight=1]") {
+  PNG png(64, 300);
+  ParallelExecutor executor(3);
+
+  Instrumentation::clear();
+  Instrumentation::enable();
+  PNG result = illinify(png);
+  grayscaleInPlace(result, executor);
+  Instrumentation::disable();
+
+  std::vector<StageRecord> illinifyRecords = recordsNamed("illinify");
+  std::vector<StageRecord> grayscaleRecords = recordsNamed("grayscaleInPlace");
+  REQUIRE( illinifyRecords.size() == 1 );
+  REQUIRE( illinifyRecords[0].pixels == 64 * 300 );
+  REQUIRE( grayscaleRecords.size() == 1 );
+  REQUIRE( grayscaleRecords[0].pixels == 64 * 300 );
+  REQUIRE( grayscaleRecords[0].thread == illinifyRecords[0].thread );
+}
+
+TEST_CASE("Recorded stages are saved as JSON and as a Chrome trace", "[weight=1]") {
+  PNG png(40, 40);
+
+  Instrumentation::clear();
+  Instrumentation::enable();
+  grayscaleInPlace(png);
+  png.writeToFile("out-instrumentation.png");
+  Instrumentation::disable();
+
+  REQUIRE( Instrumentation::writeJson("out-instrumentation.json") );
+  std::string json = readText("out-instrumentation.json");
+  REQUIRE( json.find("\"stages\"") != std::string::npos );
+  REQUIRE( json.find("\"name\": \"png.encode\", \"count\": 1") != std::string::npos );
+  REQUIRE( json.find("\"name\": \"grayscaleInPlace\", \"count\": 1, ") != std::string::npos );
+
+  REQUIRE( Instrumentation::writeChromeTrace("out-instrumentation.trace.json") );
+  std::string trace = readText("out-instrumentation.trace.json");
+  REQUIRE( trace.find("\"traceEvents\"") != std::string::npos );
+  REQUIRE( trace.find("\"name\": \"png.write\", \"cat\": \"uiuc\", \"ph\": \"X\"") != std::string::npos );
+
+  std::remove("out-instrumentation.json");
+  std::remove("out-instrumentation.trace.json");
+  Instrumentation::clear();
+}
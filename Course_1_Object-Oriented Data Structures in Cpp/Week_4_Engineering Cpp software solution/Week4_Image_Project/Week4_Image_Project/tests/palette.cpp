@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../ImageKernels.h"
+#include "../HuePalette.h"
+#include "../Pipeline.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/PlanarPNG.h"
+#include "../uiuc/ParallelExecutor.h"
+
+// The original per-pixel illinify computation
+static double referenceIllinify(double current_hue) {
+  double illini_orange = 11.0;
+  double illini_blue = 216.0;
+
+  double dist_to_orange = std::min( std::abs( current_hue - illini_orange ), std::abs( 360.0+illini_orange-current_hue ) );
+  double dist_to_blue = std::min( std::abs( current_hue - illini_blue ), std::abs( 360.0+illini_blue-current_hue ) );
+
+  return ( dist_to_orange < dist_to_blue ) ? illini_orange : illini_blue;
+}
+
+// Deterministic hues in [0, 360) for the tests below
+static std::vector<double> createTestHues() {
+  std::vector<double> hues;
+  for (unsigned i = 0; i < 360 * 64; i++) { hues.push_back(i / 64.0); }
+
+  unsigned state = 12345;
+  for (unsigned i = 0; i < 100000; i++) {
+    state = state * 1103515245 + 12345;
+    hues.push_back((state >> 8) * (360.0 / (1 << 24)));
+  }
+  return hues;
+}
+
+TEST_CASE("illiniPalette matches the original illinify exactly", "[weight=1]") {
+  std::vector<double> hues = createTestHues();
+
+  // the two decision points and their neighbours
+  double ties[] = { 113.5, 293.5 };
+  for (double tie : ties) {
+    hues.push_back(tie);
+    hues.push_back(std::nextafter(tie, 0.0));
+    hues.push_back(std::nextafter(tie, 360.0));
+  }
+
+  for (double hue : hues) {
+    if (illiniPalette().nearest(hue) != referenceIllinify(hue)) { FAIL("hue " << hue); }
+  }
+}
+
+TEST_CASE("HuePalette lookups match the direct search", "[weight=1]") {
+  std::vector<double> hues = createTestHues();
+
+  unsigned state = 777;
+  for (unsigned size = 1; size <= 12; size++) {
+    std::vector<double> paletteHues;
+    for (unsigned i = 0; i < size; i++) {
+      state = state * 1103515245 + 12345;
+      paletteHues.push_back((state >> 16) % 3600 / 10.0);
+    }
+    HuePalette palette(paletteHues);
+
+    for (double hue : hues) {
+      if (palette.nearest(hue) != palette.nearestExact(hue)) { FAIL("hue " << hue << " with " << size << " palette hues"); }
+    }
+  }
+}
+
+TEST_CASE("HuePalette breaks ties in palette order and wraps hues", "[weight=1]") {
+  REQUIRE( HuePalette({ 0, 180 }).nearest(90) == 0 );
+  REQUIRE( HuePalette({ 180, 0 }).nearest(90) == 180 );
+  REQUIRE( HuePalette({ 350, 100 }).nearest(10) == 350 );
+  REQUIRE( HuePalette({ -10, 100 }).hues()[0] == 350 );
+  REQUIRE( HuePalette({ 350, 100 }).nearest(725) == 350 );
+  REQUIRE( HuePalette(std::vector<double>()).nearest(42) == 42 );
+}
+
+TEST_CASE("remapHue gives the same result on every path", "[weight=1]") {
+  PNG png(200, 120);
+  png.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel((x * 7 + y * 3) % 360 + 0.25, 0.5, 0.5, 1);
+  });
+  HuePalette palette({ 0, 30, 60, 120, 180, 240, 270, 300 });
+
+  PNG expected = remapHue(png, palette);
+  expected.forEachPixel([&](HSLAPixel & pixel, unsigned x, unsigned y) {
+    if (pixel.h != palette.nearestExact(png.row(y)[x].h)) { FAIL("pixel (" << x << ", " << y << ")"); }
+  });
+
+  ParallelExecutor executor(3);
+  REQUIRE( remapHue(png, palette, executor) == expected );
+  REQUIRE( Pipeline(png).remapHue(palette).run() == expected );
+
+  PlanarPNG planar = remapHue(PlanarPNG(png), palette);
+  REQUIRE( planar.getPixel(17, 23).h == Approx(expected.getPixel(17, 23).h) );
+}
@@ -0,0 +1,58 @@
+#include <atomic>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "TestImages.h"
+
+TEST_CASE("ParallelExecutor::parallelFor runs every task exactly once", "[weight=1]") {
+  ParallelExecutor executor(4);
+  REQUIRE( executor.threads() == 4 );
+
+  for (unsigned round = 0; round < 20; round++) {
+    std::vector<std::atomic<unsigned>> hits(1000 + round);
+    for (unsigned i = 0; i < hits.size(); i++) { hits[i] = 0; }
+
+    executor.parallelFor(hits.size(), [&](unsigned int i) { hits[i]++; });
+
+    for (unsigned i = 0; i < hits.size(); i++) {
+      if (hits[i] != 1) { FAIL("task " << i << " ran " << hits[i] << " times"); }
+    }
+  }
+}
+
+TEST_CASE("ParallelExecutor tiles are whole bands", "[weight=1]") {
+  REQUIRE( ParallelExecutor::tileRows(PNG(300, 700)) % PNG::BAND_HEIGHT == 0 );
+  REQUIRE( ParallelExecutor::tileRows(PNG(100000, 2)) == PNG::BAND_HEIGHT );
+}
+
+TEST_CASE("Parallel transforms match the serial transforms", "[weight=1]") {
+  PNG png = createTestPNG(300, 700);
+  PNG stencil(200, 300);
+  stencil.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l = ((x + y) % 3 == 0) ? 1 : 0.5; });
+
+  unsigned threadCounts[] = { 1, 3, 8 };
+  for (unsigned threads : threadCounts) {
+    ParallelExecutor executor(threads);
+    REQUIRE( grayscale(png, executor).computeHash() == grayscale(png).computeHash() );
+    REQUIRE( createSpotlight(png, 150, 300, executor).computeHash() == createSpotlight(png, 150, 300).computeHash() );
+    REQUIRE( illinify(png, executor).computeHash() == illinify(png).computeHash() );
+    REQUIRE( watermark(png, stencil, executor).computeHash() == watermark(png, stencil).computeHash() );
+  }
+}
+
+TEST_CASE("Parallel transforms work on lazily read images", "[weight=1]") {
+  PNG png = createTestPNG(300, 700);
+  REQUIRE( png.writeToFile("out-parallel-source.png") );
+
+  PNG eager, lazy;
+  REQUIRE( eager.readFromFile("out-parallel-source.png") );
+  REQUIRE( lazy.readFromFileLazy("out-parallel-source.png") );
+
+  ParallelExecutor executor(4);
+  REQUIRE( illinify(lazy, executor) == illinify(eager) );
+}
@@ -0,0 +1,71 @@
+#include <memory>
+#include <thread>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../Pipeline.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "TestImages.h"
+
+TEST_CASE("Pipeline matches chained transforms", "[weight=1]") {
+  PNG png = createTestPNG(320, 240);
+  PNG stencil(100, 50);
+  stencil.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l = (x % 2) ? 1 : 0; });
+
+  PNG expected = watermark(illinify(createSpotlight(grayscale(png), 200, 100)), stencil);
+
+  SECTION("Serial run") {
+    PNG result = Pipeline(png).grayscale().spotlight(200, 100).illinify().watermark(stencil).run();
+    REQUIRE( result == expected );
+  }
+
+  SECTION("Parallel run") {
+    ParallelExecutor executor(4);
+    PNG result = Pipeline(png).grayscale().spotlight(200, 100).illinify().watermark(stencil).run(executor);
+    REQUIRE( result == expected );
+  }
+}
+
+TEST_CASE("Pipeline runs custom stages in order", "[weight=1]") {
+  PNG png = createTestPNG(320, 240);
+
+  PNG result = Pipeline(png)
+    .apply([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l = 0.25; })
+    .apply([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l *= 2; })
+    .run();
+
+  REQUIRE( result.getPixel(17, 33).l == 0.5 );
+  REQUIRE( png.getPixel(17, 33).l != 0.5 );
+}
+
+TEST_CASE("Pipelines sharing a lazily read stencil run on different threads", "[weight=1]") {
+  PNG png = createTestPNG(320, 240);
+  PNG stencil(90, 200);
+  stencil.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l = ((x + y) % 3) ? 1 : 0; pixel.a = 1; });
+  REQUIRE( stencil.writeToFile("out-pipeline-stencil.png") );
+  PNG eager;
+  REQUIRE( eager.readFromFile("out-pipeline-stencil.png") );
+
+  std::shared_ptr<PNG> lazy = std::make_shared<PNG>();
+  REQUIRE( lazy->readFromFileLazy("out-pipeline-stencil.png") );
+  std::shared_ptr<PNG const> shared = lazy;
+
+  Pipeline first(png), second(png);
+  first.watermark(shared, 10, 3);
+  second.watermark(shared, 200, 37);
+
+  PNG firstResult, secondResult;
+  std::thread thread([&] {
+    ParallelExecutor executor(2);
+    firstResult = first.run(executor);
+  });
+  ParallelExecutor executor(2);
+  secondResult = second.run(executor);
+  thread.join();
+
+  REQUIRE( firstResult == watermark(png, eager, 10, 3) );
+  REQUIRE( secondResult == watermark(png, eager, 200, 37) );
+}
@@ -0,0 +1,49 @@
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/PlanarPNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "TestImages.h"
+
+TEST_CASE("PlanarPNG round-trips through PNG", "[weight=1]") {
+  PNG png = createRainbowPNG();
+  PlanarPNG planar(png);
+
+  REQUIRE( planar.width() == png.width() );
+  REQUIRE( planar.height() == png.height() );
+  REQUIRE( planar.getPixel(200, 25).h == Approx(200) );
+  REQUIRE( planar.getPixel(200, 25).s == Approx(0.25) );
+  REQUIRE( planar.saturation()[200 + 25 * planar.width()] == Approx(0.25) );
+  REQUIRE( PlanarPNG(planar.toPNG()) == planar );
+}
+
+TEST_CASE("Planar transforms only modify their own plane", "[weight=1]") {
+  PlanarPNG planar(createRainbowPNG());
+
+  PlanarPNG gray = grayscale(planar);
+  REQUIRE( gray.getPixel(100, 50).s == 0 );
+  REQUIRE( gray.getPixel(100, 50).h == planar.getPixel(100, 50).h );
+  REQUIRE( gray.getPixel(100, 50).l == planar.getPixel(100, 50).l );
+
+  PlanarPNG illini = illinify(planar);
+  REQUIRE( illini.getPixel(200, 4).h == 216 );
+  REQUIRE( illini.getPixel(350, 23).h == 11 );
+  REQUIRE( illini.getPixel(350, 23).s == planar.getPixel(350, 23).s );
+}
+
+TEST_CASE("Planar transforms match the PNG transforms", "[weight=1]") {
+  PNG png = createRainbowPNG();
+  PlanarPNG planar(png);
+
+  PNG spotlight = createSpotlight(png, 100, 50);
+  PlanarPNG planarSpotlight = createSpotlight(planar, 100, 50);
+  REQUIRE( planarSpotlight.getPixel(120, 50).l == Approx(spotlight.getPixel(120, 50).l) );
+  REQUIRE( planarSpotlight.getPixel(320, 50).l == Approx(spotlight.getPixel(320, 50).l) );
+
+  PlanarPNG stencil(100, 40);
+  stencil.setPixel(10, 10, HSLAPixel(0, 0, 1, 1));
+  PlanarPNG marked = watermark(planar, stencil);
+  REQUIRE( marked.getPixel(10, 10).l == Approx(0.7) );
+  REQUIRE( marked.getPixel(11, 10).l == Approx(0.5) );
+}
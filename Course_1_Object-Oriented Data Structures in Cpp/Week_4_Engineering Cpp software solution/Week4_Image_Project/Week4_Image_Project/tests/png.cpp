@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include <unistd.h>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/FastHash.h"
+#include "../uiuc/lodepng/lodepng.h"
+#include "TestImages.h"
+
+TEST_CASE("PNG::row points at contiguous row-major pixels", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+
+  REQUIRE( png.row(0) == &png.getPixel(0, 0) );
+  REQUIRE( png.row(7) == &png.getPixel(0, 7) );
+  REQUIRE( png.row(7) + 39 == &png.getPixel(39, 7) );
+  REQUIRE( png.row(8) == png.row(7) + png.width() );
+}
+
+TEST_CASE("PNG::forEachPixel visits every pixel in memory order", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  unsigned count = 0;
+  bool inOrder = true;
+
+  png.forEachPixel([&](HSLAPixel & pixel, unsigned x, unsigned y) {
+    if (&pixel != &png.getPixel(x, y) || x + y * png.width() != count) { inOrder = false; }
+    count++;
+  });
+
+  REQUIRE( count == 40 * 30 );
+  REQUIRE( inOrder );
+}
+
+TEST_CASE("watermark ignores stencil pixels outside of the base image", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  PNG stencil(60, 10);
+  stencil.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l = 1; });
+
+  PNG result = watermark(png, stencil);
+
+  REQUIRE( result.getPixel(39, 5).l == Approx(min(png.getPixel(39, 5).l + 0.2, 1.0)) );
+  REQUIRE( result.getPixel(39, 15).l == png.getPixel(39, 15).l );
+}
+
+TEST_CASE("Lazily read PNGs only convert the bands that are accessed", "[weight=1]") {
+  PNG source = createTestPNG(40, 70);
+  REQUIRE( source.writeToFile("out-lazy-source.png") );
+
+  PNG eager, lazy;
+  REQUIRE( eager.readFromFile("out-lazy-source.png") );
+  REQUIRE( lazy.readFromFileLazy("out-lazy-source.png") );
+  REQUIRE( lazy.width() == 40 );
+  REQUIRE( lazy.height() == 70 );
+
+  SECTION("Lazy and eager reads hold the same pixels") {
+    PNG lazyCopy = lazy;
+    REQUIRE( lazyCopy == lazy );
+    REQUIRE( lazy == eager );
+    REQUIRE( lazy.getPixel(13, 69).h == eager.getPixel(13, 69).h );
+  }
+
+  SECTION("Untouched bands are written back byte-for-byte") {
+    HSLAPixel & pixel = lazy.getPixel(5, 2 * PNG::BAND_HEIGHT + 3);
+    pixel.l = 1;
+    REQUIRE( lazy.writeToFile("out-lazy-result.png") );
+
+    std::vector<unsigned char> before, after;
+    unsigned width, height;
+    REQUIRE( lodepng::decode(before, width, height, "out-lazy-source.png") == 0 );
+    REQUIRE( lodepng::decode(after, width, height, "out-lazy-result.png") == 0 );
+
+    unsigned changed = 0;
+    for (unsigned i = 0; i < before.size(); i += 4) {
+      if (before[i] != after[i] || before[i + 1] != after[i + 1] || before[i + 2] != after[i + 2]) {
+        changed++;
+        REQUIRE( i / 4 == 5 + (2 * PNG::BAND_HEIGHT + 3) * width );
+      }
+    }
+    REQUIRE( changed == 1 );
+  }
+}
+
+TEST_CASE("Moving a PNG hands over its pixels", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  PNG expected = png;
+  HSLAPixel * pixels = png.row(0);
+
+  PNG moved(std::move(png));
+  REQUIRE( moved.row(0) == pixels );
+  REQUIRE( moved == expected );
+  REQUIRE( png.width() == 0 );
+  REQUIRE( png.height() == 0 );
+
+  PNG assigned;
+  assigned = std::move(moved);
+  REQUIRE( assigned.row(0) == pixels );
+  REQUIRE( assigned == expected );
+  REQUIRE( moved.width() == 0 );
+}
+
+TEST_CASE("Copying into a PNG of the same size reuses its pixels", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  PNG result(40, 30);
+  HSLAPixel * pixels = result.row(0);
+
+  result = png;
+  REQUIRE( result.row(0) == pixels );
+  REQUIRE( result == png );
+}
+
+TEST_CASE("In-place transforms match the by-value transforms", "[weight=1]") {
+  PNG png = createTestPNG(200, 120);
+  PNG stencil = createTestPNG(90, 150);
+  PNG result;
+
+  result = png;
+  grayscaleInPlace(result);
+  REQUIRE( result == grayscale(png) );
+
+  result = png;
+  createSpotlightInPlace(result, 100, 60);
+  REQUIRE( result == createSpotlight(png, 100, 60) );
+
+  result = png;
+  illinifyInPlace(result);
+  REQUIRE( result == illinify(png) );
+
+  result = png;
+  watermarkInPlace(result, stencil);
+  REQUIRE( result == watermark(png, stencil) );
+
+  ParallelExecutor executor(3);
+  result = png;
+  illinifyInPlace(result, executor);
+  REQUIRE( result == illinify(png) );
+}
+
+TEST_CASE("fastHash64 matches the reference XXH64", "[weight=1]") {
+  REQUIRE( fastHash64("", 0) == 0xEF46DB3751D8E999ULL );
+  REQUIRE( fastHash64("abc", 3) == 0x44BC2CF5AD770999ULL );
+  REQUIRE( fastHash64("abc", 3, 1) != fastHash64("abc", 3) );
+}
+
+TEST_CASE("PNG::computeFastHash identifies identical pixels", "[weight=1]") {
+  PNG png = createTestPNG(300, 217);
+  PNG copy = png;
+  std::uint64_t hash = png.computeFastHash();
+  REQUIRE( copy.computeFastHash() == hash );
+
+  ParallelExecutor executor(3);
+  REQUIRE( png.computeFastHash(executor) == hash );
+
+  copy.getPixel(299, 216).l = std::nextafter(copy.getPixel(299, 216).l, 2.0);
+  REQUIRE( copy.computeFastHash() != hash );
+  REQUIRE( copy.computeFastHash(executor) != hash );
+
+  // same pixels in a different shape
+  PNG reshaped(217, 300);
+  std::copy(png.row(0), png.row(0) + 300 * 217, reshaped.row(0));
+  REQUIRE( reshaped.computeFastHash() != hash );
+
+  REQUIRE( PNG().computeFastHash() == PNG().computeFastHash(executor) );
+  REQUIRE( PNG(0, 5).computeFastHash() != PNG(5, 0).computeFastHash() );
+}
+
+TEST_CASE("PNG::computeFastHash is the same for lazily read PNGs", "[weight=1]") {
+  PNG source = createTestPNG(40, 70);
+  REQUIRE( source.writeToFile("out-hash-source.png") );
+
+  PNG eager, lazy, lazyParallel;
+  REQUIRE( eager.readFromFile("out-hash-source.png") );
+  REQUIRE( lazy.readFromFileLazy("out-hash-source.png") );
+  REQUIRE( lazyParallel.readFromFileLazy("out-hash-source.png") );
+
+  ParallelExecutor executor(3);
+  REQUIRE( lazy.computeFastHash() == eager.computeFastHash() );
+  REQUIRE( lazyParallel.computeFastHash(executor) == eager.computeFastHash() );
+}
+
+TEST_CASE("Raw image files round-trip exactly and are mapped without copying", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  png.getPixel(3, 4).l = 0.123456789012345;
+  REQUIRE( png.writeToRawFile("out-png.hslaraw") );
+
+  PNG mapped;
+  REQUIRE( mapped.openRawFile("out-png.hslaraw") );
+  REQUIRE( mapped.isMapped() );
+  REQUIRE( mapped == png );
+
+  SECTION("Changes to a private mapping do not reach the file") {
+    grayscaleInPlace(mapped);
+    REQUIRE( mapped == grayscale(png) );
+
+    PNG again;
+    REQUIRE( again.openRawFile("out-png.hslaraw") );
+    REQUIRE( again == png );
+  }
+
+  SECTION("Changes to a write-through mapping are saved in the file") {
+    PNG shared;
+    REQUIRE( shared.openRawFile("out-png.hslaraw", true) );
+    grayscaleInPlace(shared);
+    shared = PNG();             // unmaps
+
+    PNG again;
+    REQUIRE( again.openRawFile("out-png.hslaraw") );
+    REQUIRE( again == grayscale(png) );
+    REQUIRE( png.writeToRawFile("out-png.hslaraw") );
+  }
+
+  SECTION("An image can be written back to the file it is mapped from") {
+    // the pixels are read from the mapping while the file is written
+    REQUIRE( mapped.writeToRawFile("out-png.hslaraw") );
+    REQUIRE( mapped == png );
+
+    PNG again;
+    REQUIRE( again.openRawFile("out-png.hslaraw") );
+    REQUIRE( again == png );
+    grayscaleInPlace(again);
+    REQUIRE( again.writeToRawFile("out-png.hslaraw") );
+
+    PNG changed;
+    REQUIRE( changed.openRawFile("out-png.hslaraw") );
+    REQUIRE( changed == grayscale(png) );
+    REQUIRE( png.writeToRawFile("out-png.hslaraw") );
+  }
+
+  SECTION("Copies, moves and reallocation") {
+    PNG copy = mapped;
+    REQUIRE( !copy.isMapped() );
+    REQUIRE( copy == png );
+
+    HSLAPixel * pixels = mapped.row(0);
+    PNG moved = std::move(mapped);
+    REQUIRE( moved.isMapped() );
+    REQUIRE( moved.row(0) == pixels );
+    REQUIRE( !mapped.isMapped() );
+
+    moved = copy;
+    REQUIRE( !moved.isMapped() );
+    REQUIRE( moved == png );
+  }
+}
+
+TEST_CASE("openRawFile rejects files that are not raw images", "[weight=1]") {
+  PNG png = createTestPNG(10, 10);
+  REQUIRE( png.writeToFile("out-not-raw.png") );
+
+  PNG result = createTestPNG(2, 2);
+  REQUIRE( !result.openRawFile("out-not-raw.png") );
+  REQUIRE( !result.openRawFile("out-missing.hslaraw") );
+  REQUIRE( result == createTestPNG(2, 2) );
+
+  // a header promising more pixels than the file holds
+  REQUIRE( png.writeToRawFile("out-short.hslaraw") );
+  REQUIRE( truncate("out-short.hslaraw", 64 + 99 * sizeof(HSLAPixel)) == 0 );
+  REQUIRE( !result.openRawFile("out-short.hslaraw") );
+}
@@ -0,0 +1,101 @@
+#include <cstdint>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/PixelPool.h"
+
+TEST_CASE("PixelPool size classes waste at most 1/8 of a large buffer", "[weight=1]") {
+  REQUIRE( PixelPool::sizeClass(1) == 4096 );
+  REQUIRE( PixelPool::sizeClass(4097) == 8192 );
+  REQUIRE( PixelPool::sizeClass(PixelPool::HUGE_PAGE_BYTES) == PixelPool::HUGE_PAGE_BYTES );
+  REQUIRE( PixelPool::sizeClass(PixelPool::HUGE_PAGE_BYTES + 1) == 2 * PixelPool::HUGE_PAGE_BYTES );
+
+  for (std::size_t bytes = PixelPool::HUGE_PAGE_BYTES; bytes < 4096u * 1024 * 1024; bytes = bytes * 5 / 3 + 12345) {
+    std::size_t size = PixelPool::sizeClass(bytes);
+    REQUIRE( size >= bytes );
+    REQUIRE( size % PixelPool::HUGE_PAGE_BYTES == 0 );
+    if (bytes >= 16 * PixelPool::HUGE_PAGE_BYTES) { REQUIRE( size - bytes <= bytes / 8 ); }
+  }
+}
+
+TEST_CASE("PixelPool reuses a released buffer of the same size class", "[weight=1]") {
+  PixelPool::trim();
+  PixelPool::resetStatistics();
+
+  HSLAPixel * first = PixelPool::allocate(1000 * 1000);
+  REQUIRE( reinterpret_cast<std::uintptr_t>(first) % PixelPool::HUGE_PAGE_BYTES == 0 );
+  PixelPool::release(first, 1000 * 1000);
+  REQUIRE( PixelPool::statistics().cachedBuffers == 1 );
+
+  // a slightly smaller frame falls in the same class
+  HSLAPixel * second = PixelPool::allocate(999 * 1000);
+  REQUIRE( second == first );
+  PixelPool::release(second, 999 * 1000);
+
+  PixelPool::Statistics statistics = PixelPool::statistics();
+  REQUIRE( statistics.allocations == 1 );
+  REQUIRE( statistics.reuses == 1 );
+  REQUIRE( statistics.releases == 2 );
+
+  PixelPool::trim();
+  REQUIRE( PixelPool::statistics().cachedBuffers == 0 );
+  REQUIRE( PixelPool::statistics().cachedBytes == 0 );
+}
+
+TEST_CASE("PixelPool frees buffers beyond its capacity", "[weight=1]") {
+  PixelPool::trim();
+  PixelPool::setCapacity(0);
+  PixelPool::resetStatistics();
+
+  HSLAPixel * pixels = PixelPool::allocate(300 * 300);
+  PixelPool::release(pixels, 300 * 300);
+  REQUIRE( PixelPool::statistics().cachedBuffers == 0 );
+
+  PixelPool::setCapacity(PixelPool::DEFAULT_CAPACITY);
+  REQUIRE( PixelPool::allocate(0) == NULL );
+}
+
+TEST_CASE("Processing same-sized frames allocates nothing new once warm", "[weight=1]") {
+  PixelPool::trim();
+  PNG source;
+  REQUIRE( source.readFromFile("alma.png") );
+
+  // warm up: the input, a copy and a transformed result
+  for (unsigned i = 0; i < 2; i++) {
+    PNG frame;
+    frame.readFromFile("alma.png");
+    PNG result = illinify(grayscale(frame));
+  }
+
+  PixelPool::resetStatistics();
+  for (unsigned i = 0; i < 5; i++) {
+    PNG frame;
+    frame.readFromFile("alma.png");
+    PNG result = illinify(grayscale(frame));
+    REQUIRE( result.getPixel(10, 10).s == 0 );
+  }
+
+  PixelPool::Statistics statistics = PixelPool::statistics();
+  REQUIRE( statistics.allocations == 0 );
+  REQUIRE( statistics.reuses > 0 );
+}
+
+TEST_CASE("New and resized images from reused buffers start with default pixels", "[weight=1]") {
+  {
+    PNG dirty(128, 128);
+    dirty.forEachPixel([](HSLAPixel & pixel, unsigned, unsigned) { pixel = HSLAPixel(123, 0.5, 0.5, 0.5); });
+  }
+
+  PNG png(128, 128);
+  REQUIRE( png.getPixel(77, 33).h == HSLAPixel().h );
+  REQUIRE( png.getPixel(77, 33).l == HSLAPixel().l );
+  REQUIRE( png.getPixel(77, 33).a == HSLAPixel().a );
+
+  png.getPixel(0, 0).l = 0.25;
+  png.resize(200, 100);
+  REQUIRE( png.getPixel(0, 0).l == 0.25 );
+  REQUIRE( png.getPixel(150, 50).a == HSLAPixel().a );
+}
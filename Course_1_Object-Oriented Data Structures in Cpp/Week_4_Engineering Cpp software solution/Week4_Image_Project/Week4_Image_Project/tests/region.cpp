@@ -0,0 +1,157 @@
+#include <memory>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../Region.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "TestImages.h"
+
+static bool samePixel(HSLAPixel const & first, HSLAPixel const & second) {
+  return first.h == second.h && first.s == second.s && first.l == second.l && first.a == second.a;
+}
+
+static bool inside(Region const & region, unsigned x, unsigned y) {
+  return x >= region.x && x < region.x + region.width && y >= region.y && y < region.y + region.height;
+}
+
+TEST_CASE("clipRegion clips against the image", "[weight=1]") {
+  Region inner = clipRegion({ 2, 3, 4, 5 }, 10, 10);
+  REQUIRE( inner.x == 2 );
+  REQUIRE( inner.width == 4 );
+  REQUIRE( inner.height == 5 );
+
+  Region edge = clipRegion({ 8, 7, 10, 10 }, 10, 10);
+  REQUIRE( edge.x == 8 );
+  REQUIRE( edge.y == 7 );
+  REQUIRE( edge.width == 2 );
+  REQUIRE( edge.height == 3 );
+
+  REQUIRE( clipRegion({ 10, 0, 5, 5 }, 10, 10).width == 0 );
+  REQUIRE( clipRegion({ 0, 0, 5, 0 }, 10, 10).width == 0 );
+}
+
+TEST_CASE("Region transforms only change the pixels inside of the region", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  Region region = { 5, 7, 20, 10 };
+
+  PNG gray = grayscale(png, region), fullGray = grayscale(png);
+  PNG spotlight = createSpotlight(png, 12, 9, region), fullSpotlight = createSpotlight(png, 12, 9);
+  PNG illini = illinify(png, region), fullIllini = illinify(png);
+
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      bool selected = inside(region, x, y);
+      REQUIRE( samePixel(gray.getPixel(x, y), (selected ? fullGray : png).getPixel(x, y)) );
+      REQUIRE( samePixel(spotlight.getPixel(x, y), (selected ? fullSpotlight : png).getPixel(x, y)) );
+      REQUIRE( samePixel(illini.getPixel(x, y), (selected ? fullIllini : png).getPixel(x, y)) );
+    }
+  }
+
+  REQUIRE( samePixel(grayscale(png, Region{ 30, 20, 100, 100 }).getPixel(39, 29), fullGray.getPixel(39, 29)) );
+  REQUIRE( grayscale(png, Region{ 40, 0, 10, 10 }) == png );
+}
+
+TEST_CASE("Mask transforms only change the pixels the mask selects", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  PNG mask(30, 20);
+  mask.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel(0, 0, ((x + y) % 3 == 0) ? 1.0 : 0.25, 1);
+  });
+
+  PNG gray = grayscale(png, mask), fullGray = grayscale(png);
+  PNG illini = illinify(png, mask), fullIllini = illinify(png);
+  PNG spotlight = createSpotlight(png, 3, 4, mask), fullSpotlight = createSpotlight(png, 3, 4);
+
+  for (unsigned y = 0; y < png.height(); y++) {
+    for (unsigned x = 0; x < png.width(); x++) {
+      bool selected = x < mask.width() && y < mask.height() && (x + y) % 3 == 0;
+      REQUIRE( samePixel(gray.getPixel(x, y), (selected ? fullGray : png).getPixel(x, y)) );
+      REQUIRE( samePixel(illini.getPixel(x, y), (selected ? fullIllini : png).getPixel(x, y)) );
+      REQUIRE( samePixel(spotlight.getPixel(x, y), (selected ? fullSpotlight : png).getPixel(x, y)) );
+    }
+  }
+}
+
+TEST_CASE("In-place region and mask transforms match the copying versions", "[weight=1]") {
+  PNG png = createTestPNG(40, 30);
+  Region region = { 10, 0, 15, 30 };
+  PNG mask(20, 40);
+  mask.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel(0, 0, (x < y) ? 1.0 : 0.0, 1);
+  });
+
+  PNG image = png;
+  grayscaleInPlace(image, region);
+  REQUIRE( image == grayscale(png, region) );
+
+  image = png;
+  createSpotlightInPlace(image, 20, 15, region);
+  REQUIRE( image == createSpotlight(png, 20, 15, region) );
+
+  image = png;
+  illinifyInPlace(image, region);
+  REQUIRE( image == illinify(png, region) );
+
+  image = png;
+  grayscaleInPlace(image, mask);
+  REQUIRE( image == grayscale(png, mask) );
+
+  image = png;
+  createSpotlightInPlace(image, 20, 15, mask);
+  REQUIRE( image == createSpotlight(png, 20, 15, mask) );
+
+  image = png;
+  illinifyInPlace(image, mask);
+  REQUIRE( image == illinify(png, mask) );
+}
+
+TEST_CASE("RegionImage shares its source and copies only the region", "[weight=1]") {
+  std::shared_ptr<PNG const> png = std::make_shared<PNG const>(createTestPNG(40, 30));
+  Region region = { 5, 7, 20, 10 };
+
+  RegionImage image(png, region);
+  RegionImage copy = image;
+  REQUIRE( &copy.source() == png.get() );
+  REQUIRE( png.use_count() == 3 );
+  REQUIRE( copy.width() == 40 );
+  REQUIRE( copy.height() == 30 );
+  REQUIRE( copy.patch().width() == 20 );
+  REQUIRE( copy.patch().height() == 10 );
+
+  RegionImage clipped(png, Region{ 30, 25, 20, 20 });
+  REQUIRE( clipped.region().width == 10 );
+  REQUIRE( clipped.patch().height() == 5 );
+  REQUIRE( clipped.toPNG() == *png );
+}
+
+TEST_CASE("RegionImage::getPixel truncates coordinates before choosing the patch", "[weight=1]") {
+  PNG original = createTestPNG(40, 30);
+  std::shared_ptr<PNG const> png = std::make_shared<PNG const>(original);
+  PNG expected = grayscale(original, Region{ 30, 25, 20, 20 });
+
+  RegionImage gray = grayscale(RegionImage(png, Region{ 30, 25, 20, 20 }));
+  REQUIRE( samePixel(gray.getPixel(45, 26), expected.getPixel(39, 26)) );
+  REQUIRE( samePixel(gray.getPixel(35, 100), expected.getPixel(35, 29)) );
+  REQUIRE( samePixel(gray.getPixel(100, 100), expected.getPixel(39, 29)) );
+  REQUIRE( samePixel(gray.getPixel(45, 3), original.getPixel(39, 3)) );
+}
+
+TEST_CASE("RegionImage transforms match the region transforms", "[weight=1]") {
+  PNG original = createTestPNG(40, 30);
+  std::shared_ptr<PNG const> png = std::make_shared<PNG const>(original);
+  Region region = { 5, 7, 20, 10 };
+
+  RegionImage gray = grayscale(RegionImage(png, region));
+  REQUIRE( gray.toPNG() == grayscale(original, region) );
+  REQUIRE( samePixel(gray.getPixel(10, 10), grayscale(original).getPixel(10, 10)) );
+  REQUIRE( samePixel(gray.getPixel(0, 0), original.getPixel(0, 0)) );
+  REQUIRE( *png == original );
+
+  RegionImage spotlight = createSpotlight(RegionImage(png, region), 12, 9);
+  REQUIRE( spotlight.toPNG() == createSpotlight(original, 12, 9, region) );
+
+  RegionImage illini = illinify(RegionImage(png, region));
+  REQUIRE( illini.toPNG() == illinify(original, region) );
+}
@@ -0,0 +1,92 @@
+#include <cmath>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "../uiuc/Resample.h"
+#include "TestImages.h"
+
+using namespace uiuc;
+
+static ResampleFilter const FILTERS[] = {
+  ResampleFilter::Box, ResampleFilter::Bilinear, ResampleFilter::Bicubic, ResampleFilter::Lanczos3
+};
+
+TEST_CASE("resample to the same size is an exact copy", "[weight=1]") {
+  PNG png = createTestPNG(31, 17);
+  for (ResampleFilter filter : FILTERS) {
+    REQUIRE( resample(png, 31, 17, filter) == png );
+  }
+}
+
+TEST_CASE("resample keeps a uniform image uniform", "[weight=1]") {
+  PNG png(40, 30);
+  png.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel = HSLAPixel(200, 0.6, 0.4, 0.8); });
+
+  unsigned sizes[][2] = { { 13, 7 }, { 97, 71 }, { 1, 1 }, { 40, 3 } };
+  for (ResampleFilter filter : FILTERS) {
+    for (auto const & size : sizes) {
+      PNG result = resample(png, size[0], size[1], filter);
+      REQUIRE( result.width() == size[0] );
+      REQUIRE( result.height() == size[1] );
+      result.forEachPixel([&](HSLAPixel & pixel, unsigned x, unsigned y) {
+        if (std::fabs(pixel.h - 200) > 1e-3 || std::fabs(pixel.s - 0.6) > 1e-4 ||
+            std::fabs(pixel.l - 0.4) > 1e-4 || std::fabs(pixel.a - 0.8) > 1e-4) {
+          FAIL("pixel (" << x << ", " << y << ") is " << pixel.h << " " << pixel.s << " " << pixel.l << " " << pixel.a);
+        }
+      });
+    }
+  }
+}
+
+TEST_CASE("resample interpolates between pixels", "[weight=1]") {
+  // a black and white checkerboard averages to gray
+  PNG checkerboard(8, 8);
+  checkerboard.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel = HSLAPixel(0, 0, (x + y) % 2, 1); });
+  PNG gray = resample(checkerboard, 4, 4, ResampleFilter::Box);
+  REQUIRE( gray.getPixel(1, 2).l == Approx(0.5).margin(1e-6) );
+
+  // enlarging a two pixel ramp is linear in between
+  PNG ramp(2, 1);
+  ramp.getPixel(0, 0) = HSLAPixel(0, 0, 0, 1);
+  ramp.getPixel(1, 0) = HSLAPixel(0, 0, 1, 1);
+  PNG enlarged = resample(ramp, 8, 1, ResampleFilter::Bilinear);
+  REQUIRE( enlarged.getPixel(0, 0).l == Approx(0.0).margin(1e-6) );
+  REQUIRE( enlarged.getPixel(3, 0).l == Approx(0.375).margin(1e-6) );
+  REQUIRE( enlarged.getPixel(4, 0).l == Approx(0.625).margin(1e-6) );
+  REQUIRE( enlarged.getPixel(7, 0).l == Approx(1.0).margin(1e-6) );
+}
+
+TEST_CASE("resample does not bleed the color of transparent pixels", "[weight=1]") {
+  PNG png(2, 1);
+  png.getPixel(0, 0) = HSLAPixel(0, 1, 0.5, 0);      // transparent red
+  png.getPixel(1, 0) = HSLAPixel(240, 1, 0.5, 1);    // opaque blue
+
+  PNG result = resample(png, 1, 1, ResampleFilter::Box);
+  REQUIRE( result.getPixel(0, 0).h == Approx(240) );
+  REQUIRE( result.getPixel(0, 0).s == Approx(1) );
+  REQUIRE( result.getPixel(0, 0).a == Approx(0.5) );
+}
+
+TEST_CASE("resample gives the same result in parallel and through PNG::resize", "[weight=1]") {
+  PNG png = createTestPNG(300, 170);
+  ParallelExecutor executor(3);
+
+  for (ResampleFilter filter : FILTERS) {
+    PNG smaller = resample(png, 123, 45, filter);
+    PNG larger = resample(png, 451, 333, filter);
+    REQUIRE( resample(png, 123, 45, filter, executor) == smaller );
+    REQUIRE( resample(png, 451, 333, filter, executor) == larger );
+
+    PNG resized = png;
+    resized.resize(123, 45, filter);
+    REQUIRE( resized == smaller );
+    resized = png;
+    resized.resize(451, 333, filter, executor);
+    REQUIRE( resized == larger );
+  }
+
+  REQUIRE( resample(png, 0, 10, ResampleFilter::Bicubic).width() == 0 );
+}
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../ImageKernels.h"
+#include "../Pipeline.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "TestImages.h"
+
+// The spotlight formula, computed directly for every center
+static double referenceSpotlightFactor(int x, int y, std::vector<std::pair<int, int>> const & centers) {
+  double factor = 0;
+  for (auto const & center : centers) {
+    double radius = sqrt( pow( static_cast<double>(x - center.first), 2 ) + pow( static_cast<double>(y - center.second), 2 ) );
+    if ( radius >= 160.0 ) { radius = 160.0; }
+    factor = std::max(factor, 1.0 - radius * 0.005);
+  }
+  return factor;
+}
+
+TEST_CASE("createSpotlight dims pixels left of and above the center too", "[weight=1]") {
+  PNG png = createTestPNG(400, 300);
+  PNG result = createSpotlight(png, 200, 150);
+
+  REQUIRE( result.getPixel(200 - 3, 150 - 4).l == Approx(png.getPixel(200 - 3, 150 - 4).l * 0.975) );
+  REQUIRE( result.getPixel(200 + 3, 150 + 4).l == Approx(png.getPixel(200 + 3, 150 + 4).l * 0.975) );
+  REQUIRE( result.getPixel(200 - 20, 150).l == Approx(png.getPixel(200 - 20, 150).l * 0.9) );
+  REQUIRE( result.getPixel(200, 150 - 20).l == Approx(png.getPixel(200, 150 - 20).l * 0.9) );
+}
+
+TEST_CASE("createSpotlight matches the spotlight formula exactly", "[weight=1]") {
+  PNG png = createTestPNG(400, 300);
+
+  std::vector<std::pair<int, int>> centers;
+  centers.push_back(std::make_pair(90, 80));
+  centers.push_back(std::make_pair(300, 200));
+  centers.push_back(std::make_pair(-50, 290));
+  centers.push_back(std::make_pair(395, -100));
+
+  for (unsigned count = 1; count <= centers.size(); count++) {
+    std::vector<std::pair<int, int>> used(centers.begin(), centers.begin() + count);
+    PNG result = createSpotlight(png, used);
+
+    for (unsigned y = 0; y < png.height(); y++) {
+      for (unsigned x = 0; x < png.width(); x++) {
+        double expected = png.getPixel(x, y).l * referenceSpotlightFactor(x, y, used);
+        if (result.getPixel(x, y).l != expected) { FAIL("pixel (" << x << ", " << y << ") with " << count << " centers"); }
+      }
+    }
+  }
+}
+
+TEST_CASE("Spotlight row, pixel, parallel and pipeline paths agree", "[weight=1]") {
+  PNG png = createTestPNG(400, 300);
+
+  std::vector<std::pair<int, int>> centers;
+  for (int i = 0; i < 24; i++) { centers.push_back(std::make_pair((i * 97) % 460 - 30, (i * 61) % 340 - 20)); }
+
+  PNG expected = createSpotlight(png, centers);
+
+  PNG perPixel = png;
+  perPixel.forEachPixel(SpotlightKernel(centers));
+  REQUIRE( perPixel == expected );
+
+  ParallelExecutor executor(3);
+  REQUIRE( createSpotlight(png, centers, executor) == expected );
+  REQUIRE( Pipeline(png).spotlight(centers).run() == expected );
+
+  REQUIRE( createSpotlight(png, 120, 40) == createSpotlight(png, std::vector<std::pair<int, int>>(1, std::make_pair(120, 40))) );
+}
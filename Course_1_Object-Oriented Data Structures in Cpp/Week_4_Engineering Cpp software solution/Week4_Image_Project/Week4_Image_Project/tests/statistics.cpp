@@ -0,0 +1,119 @@
+#include <cmath>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/ImageStatistics.h"
+#include "../uiuc/ParallelExecutor.h"
+
+// Luminance x / width (so evenly spread over [0, 1)), hue 90, saturation
+// 0.25 in the top half and 0.75 in the bottom half, alpha 1
+static PNG createTestImage(unsigned width, unsigned height) {
+  PNG png(width, height);
+  png.forEachPixel([&](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel(90, (y < height / 2) ? 0.25 : 0.75, static_cast<double>(x) / width, 1);
+  });
+  return png;
+}
+
+TEST_CASE("computeStatistics counts every channel in one pass", "[weight=1]") {
+  PNG png = createTestImage(256, 50);
+  ImageStatistics stats = computeStatistics(png, 64);
+
+  REQUIRE( stats.pixels == 12800 );
+
+  REQUIRE( stats.hue.upper == 360 );
+  REQUIRE( stats.hue.histogram.size() == 64 );
+  REQUIRE( stats.hue.histogram[16] == 12800 );
+  REQUIRE( stats.hue.mean == Approx(90) );
+  REQUIRE( stats.hue.standardDeviation == Approx(0).margin(1e-9) );
+
+  REQUIRE( stats.saturation.histogram[16] == 6400 );
+  REQUIRE( stats.saturation.histogram[48] == 6400 );
+  REQUIRE( stats.saturation.min == 0.25 );
+  REQUIRE( stats.saturation.max == 0.75 );
+  REQUIRE( stats.saturation.mean == Approx(0.5) );
+  REQUIRE( stats.saturation.standardDeviation == Approx(0.25) );
+
+  for (unsigned b = 0; b < 64; b++) {
+    REQUIRE( stats.luminance.histogram[b] == 200 );
+  }
+  REQUIRE( stats.luminance.min == 0 );
+  REQUIRE( stats.luminance.max == 255.0 / 256 );
+  REQUIRE( stats.luminance.mean == Approx(255.0 / 512) );
+
+  REQUIRE( stats.alpha.histogram[63] == 12800 );
+  REQUIRE( stats.alpha.min == 1 );
+}
+
+TEST_CASE("ChannelStatistics::percentile interpolates within a bin", "[weight=1]") {
+  PNG png = createTestImage(1000, 10);
+  ImageStatistics stats = computeStatistics(png, 64);
+
+  REQUIRE( stats.luminance.percentile(0) == 0 );
+  REQUIRE( stats.luminance.percentile(1) == Approx(0.999) );
+  REQUIRE( stats.luminance.percentile(0.5) == Approx(0.5).margin(0.002) );
+  REQUIRE( stats.luminance.percentile(0.1) == Approx(0.1).margin(0.002) );
+
+  // every saturation is 0.25 or 0.75, which interpolating within a bin
+  // can only miss by a bin width
+  REQUIRE( stats.saturation.percentile(0.25) == Approx(0.25).margin(stats.saturation.binWidth()) );
+  REQUIRE( stats.saturation.percentile(0.75) == Approx(0.75).margin(stats.saturation.binWidth()) );
+
+  ImageStatistics empty = computeStatistics(PNG());
+  REQUIRE( empty.pixels == 0 );
+  REQUIRE( empty.luminance.mean == 0 );
+  REQUIRE( empty.luminance.percentile(0.5) == 0 );
+}
+
+TEST_CASE("computeStatistics gives the same histograms on an executor", "[weight=1]") {
+  PNG png;
+  REQUIRE( png.readFromFile("alma.png") );
+  PNG lazy;
+  REQUIRE( lazy.readFromFileLazy("alma.png") );
+
+  ParallelExecutor executor(4);
+  ImageStatistics serial = computeStatistics(png);
+  ImageStatistics parallel = computeStatistics(lazy, 256, executor);
+
+  REQUIRE( parallel.pixels == serial.pixels );
+  REQUIRE( parallel.hue.histogram == serial.hue.histogram );
+  REQUIRE( parallel.saturation.histogram == serial.saturation.histogram );
+  REQUIRE( parallel.luminance.histogram == serial.luminance.histogram );
+  REQUIRE( parallel.alpha.histogram == serial.alpha.histogram );
+  REQUIRE( parallel.luminance.min == serial.luminance.min );
+  REQUIRE( parallel.luminance.max == serial.luminance.max );
+  REQUIRE( parallel.luminance.mean == Approx(serial.luminance.mean) );
+  REQUIRE( parallel.luminance.standardDeviation == Approx(serial.luminance.standardDeviation) );
+}
+
+TEST_CASE("equalizeLuminance spreads luminances evenly and keeps their order", "[weight=1]") {
+  // luminances crowded into [0.3, 0.4)
+  PNG png(300, 40);
+  png.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel(10, 0.5, 0.3 + (x * x) / (300.0 * 300.0 * 10), 0.8);
+  });
+
+  PNG equalized = equalizeLuminance(png);
+  ImageStatistics stats = computeStatistics(equalized, 10);
+  for (unsigned b = 0; b < 10; b++) {
+    REQUIRE( stats.luminance.histogram[b] == Approx(1200).margin(120) );
+  }
+  REQUIRE( stats.luminance.max == Approx(1.0).margin(0.01) );
+
+  for (unsigned x = 1; x < 300; x++) {
+    REQUIRE( equalized.getPixel(x, 5).l > equalized.getPixel(x - 1, 5).l );
+  }
+  REQUIRE( equalized.getPixel(7, 7).h == 10 );
+  REQUIRE( equalized.getPixel(7, 7).s == 0.5 );
+  REQUIRE( equalized.getPixel(7, 7).a == 0.8 );
+
+  ParallelExecutor executor(3);
+  REQUIRE( equalizeLuminance(png, executor) == equalized );
+  PNG inPlace = png;
+  equalizeLuminanceInPlace(inPlace);
+  REQUIRE( inPlace == equalized );
+}
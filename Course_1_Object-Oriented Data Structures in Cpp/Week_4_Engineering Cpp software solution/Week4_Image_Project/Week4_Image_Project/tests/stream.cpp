@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../uiuc/catch/catch.hpp"
+
+#include "../ImageTransform.h"
+#include "../uiuc/PNG.h"
+#include "../uiuc/HSLAPixel.h"
+#include "../uiuc/PNGStream.h"
+#include "../uiuc/ParallelExecutor.h"
+#include "../uiuc/Inflater.h"
+#include "../uiuc/lodepng/lodepng.h"
+
+static std::vector<unsigned char> createStreamTestBytes(unsigned width, unsigned height, bool gray) {
+  std::vector<unsigned char> rgba(width * height * 4);
+  for (unsigned y = 0; y < height; y++) {
+    for (unsigned x = 0; x < width; x++) {
+      unsigned char * pixel = &rgba[(y * width + x) * 4];
+      pixel[0] = (x * 3 + y) % 256;
+      pixel[1] = gray ? pixel[0] : (x * y) % 256;
+      pixel[2] = gray ? pixel[0] : (y * 5) % 256;
+      pixel[3] = (x + y) % 7 == 0 ? 128 : 255;
+    }
+  }
+  return rgba;
+}
+
+static void encodeStreamTestFile(std::string const & fileName, std::vector<unsigned char> const & rgba,
+                                 unsigned width, unsigned height, LodePNGColorType colorType, unsigned btype) {
+  lodepng::State state;
+  state.encoder.auto_convert = 0;
+  state.encoder.zlibsettings.btype = btype;
+  state.info_png.color.colortype = colorType;
+  state.info_png.color.bitdepth = 8;
+
+  if (colorType == LCT_PALETTE) {
+    for (unsigned i = 0; i < rgba.size(); i += 4) {
+      bool found = false;
+      for (unsigned j = 0; j < state.info_png.color.palettesize && !found; j++) {
+        found = std::equal(&rgba[i], &rgba[i] + 4, &state.info_png.color.palette[j * 4]);
+      }
+      if (!found) { lodepng_palette_add(&state.info_png.color, rgba[i], rgba[i + 1], rgba[i + 2], rgba[i + 3]); }
+    }
+  }
+
+  std::vector<unsigned char> file;
+  REQUIRE( lodepng::encode(file, rgba, width, height, state) == 0 );
+  REQUIRE( lodepng::save_file(file, fileName) == 0 );
+}
+
+static PNG readAllRows(PNGReader & reader) {
+  PNG png(reader.width(), reader.height());
+  unsigned y = 0, rows;
+  while ((rows = reader.readRows(png.row(y), 5)) > 0) { y += rows; }
+  REQUIRE( y == reader.height() );
+  return png;
+}
+
+TEST_CASE("PNGReader reads every supported color type like PNG::readFromFile", "[weight=1]") {
+  struct { LodePNGColorType colorType; unsigned btype; bool gray; } cases[] = {
+    { LCT_RGBA, 2, false }, { LCT_RGB, 1, false }, { LCT_GREY_ALPHA, 0, true },
+    { LCT_GREY, 2, true }, { LCT_PALETTE, 2, true } };
+
+  for (auto const & c : cases) {
+    // gray pixels keep the palette small enough for color type 3
+    std::vector<unsigned char> rgba = createStreamTestBytes(123, 77, c.gray);
+    if (c.colorType == LCT_PALETTE) { for (unsigned i = 0; i < rgba.size(); i += 4) { rgba[i] = rgba[i + 1] = rgba[i + 2] = rgba[i] & 0x7F; } }
+    encodeStreamTestFile("out-stream-source.png", rgba, 123, 77, c.colorType, c.btype);
+
+    PNG expected;
+    REQUIRE( expected.readFromFile("out-stream-source.png") );
+
+    PNGReader reader;
+    REQUIRE( reader.open("out-stream-source.png") );
+    REQUIRE( reader.width() == 123 );
+    REQUIRE( reader.height() == 77 );
+    REQUIRE( readAllRows(reader) == expected );
+    REQUIRE( reader.good() );
+  }
+}
+
+TEST_CASE("PNGWriter output can be read back by lodepng and PNGReader", "[weight=1]") {
+  // large enough to be compressed in several separate IDAT chunks
+  PNG png(300, 700);
+  png.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel((x + 2 * y) % 360, (y % 100) / 100.0, (x % 50) / 49.0, 1);
+  });
+
+  PNGWriter writer;
+  REQUIRE( writer.open("out-stream-written.png", png.width(), png.height()) );
+  for (unsigned y = 0; y < png.height(); y += PNG::BAND_HEIGHT) {
+    REQUIRE( writer.writeRows(png.row(y), std::min(PNG::BAND_HEIGHT, png.height() - y)) );
+  }
+  REQUIRE( writer.close() );
+
+  PNG expected, written;
+  REQUIRE( png.writeToFile("out-stream-expected.png") );
+  REQUIRE( expected.readFromFile("out-stream-expected.png") );
+  REQUIRE( written.readFromFile("out-stream-written.png") );
+  REQUIRE( written == expected );
+
+  PNGReader reader;
+  REQUIRE( reader.open("out-stream-written.png") );
+  REQUIRE( readAllRows(reader) == expected );
+  REQUIRE( reader.good() );
+}
+
+TEST_CASE("Streaming transforms match the in-memory transforms", "[weight=1]") {
+  std::vector<unsigned char> rgba = createStreamTestBytes(200, 150, false);
+  encodeStreamTestFile("out-stream-source.png", rgba, 200, 150, LCT_RGBA, 2);
+
+  PNG png, stencil(120, 200), streamed, expected;
+  REQUIRE( png.readFromFile("out-stream-source.png") );
+  stencil.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) { pixel.l = ((x + y) % 3 == 0) ? 1 : 0.5; });
+
+  REQUIRE( grayscaleFile("out-stream-source.png", "out-stream-result.png") );
+  REQUIRE( grayscale(png).writeToFile("out-stream-expected.png") );
+  REQUIRE( streamed.readFromFile("out-stream-result.png") );
+  REQUIRE( expected.readFromFile("out-stream-expected.png") );
+  REQUIRE( streamed == expected );
+
+  REQUIRE( illinifyFile("out-stream-source.png", "out-stream-result.png") );
+  REQUIRE( illinify(png).writeToFile("out-stream-expected.png") );
+  REQUIRE( streamed.readFromFile("out-stream-result.png") );
+  REQUIRE( expected.readFromFile("out-stream-expected.png") );
+  REQUIRE( streamed == expected );
+
+  REQUIRE( createSpotlightFile("out-stream-source.png", "out-stream-result.png", 60, 70) );
+  REQUIRE( createSpotlight(png, 60, 70).writeToFile("out-stream-expected.png") );
+  REQUIRE( streamed.readFromFile("out-stream-result.png") );
+  REQUIRE( expected.readFromFile("out-stream-expected.png") );
+  REQUIRE( streamed == expected );
+
+  REQUIRE( watermarkFile("out-stream-source.png", "out-stream-result.png", stencil) );
+  REQUIRE( watermark(png, stencil).writeToFile("out-stream-expected.png") );
+  REQUIRE( streamed.readFromFile("out-stream-result.png") );
+  REQUIRE( expected.readFromFile("out-stream-expected.png") );
+  REQUIRE( streamed == expected );
+}
+
+TEST_CASE("PNGReader reports truncated files", "[weight=1]") {
+  std::vector<unsigned char> rgba = createStreamTestBytes(64, 64, false);
+  encodeStreamTestFile("out-stream-source.png", rgba, 64, 64, LCT_RGBA, 2);
+
+  std::vector<unsigned char> file;
+  REQUIRE( lodepng::load_file(file, "out-stream-source.png") == 0 );
+  file.resize(file.size() / 2);
+  REQUIRE( lodepng::save_file(file, "out-stream-truncated.png") == 0 );
+
+  PNGReader reader;
+  REQUIRE( reader.open("out-stream-truncated.png") );
+
+  PNG png(64, 64);
+  unsigned y = 0, rows;
+  while ((rows = reader.readRows(png.row(y), 8)) > 0) { y += rows; }
+  REQUIRE( y < 64 );
+  REQUIRE( !reader.good() );
+}
+
+static std::vector<unsigned char> readFileBytes(std::string const & fileName) {
+  std::vector<unsigned char> bytes;
+  lodepng::load_file(bytes, fileName);
+  return bytes;
+}
+
+TEST_CASE("combineAdler32 matches a checksum over both pieces", "[weight=1]") {
+  std::vector<unsigned char> data = createStreamTestBytes(97, 211, false);
+  std::uint32_t whole = updateAdler32(1, data.data(), data.size());
+
+  std::size_t splits[] = { 0, 1, 5552, 40000, data.size() - 1, data.size() };
+  for (std::size_t split : splits) {
+    std::uint32_t first = updateAdler32(1, data.data(), split);
+    std::uint32_t second = updateAdler32(1, data.data() + split, data.size() - split);
+    REQUIRE( combineAdler32(first, second, data.size() - split) == whole );
+  }
+}
+
+TEST_CASE("writeToFile with encoder options round-trips at every level and filter", "[weight=1]") {
+  // several compression blocks
+  PNG png(300, 700);
+  png.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel((x + 2 * y) % 360, (y % 100) / 100.0, (x % 50) / 49.0, (x % 3) / 2.0);
+  });
+  REQUIRE( png.writeToFile("out-encoder-expected.png") );
+  PNG expected;
+  REQUIRE( expected.readFromFile("out-encoder-expected.png") );
+
+  PNGFilter filters[] = { PNGFilter::None, PNGFilter::Sub, PNGFilter::Up, PNGFilter::Average, PNGFilter::Paeth, PNGFilter::MinSum };
+  std::vector<std::size_t> sizes;
+  for (unsigned level = 0; level <= 9; level++) {
+    PNGEncoderOptions options;
+    options.level = level;
+    REQUIRE( png.writeToFile("out-encoder.png", options) );
+    sizes.push_back(readFileBytes("out-encoder.png").size());
+
+    PNG written;
+    REQUIRE( written.readFromFile("out-encoder.png") );
+    if (!(written == expected)) { FAIL("level " << level); }
+  }
+  for (PNGFilter filter : filters) {
+    PNGEncoderOptions options;
+    options.filter = filter;
+    REQUIRE( png.writeToFile("out-encoder.png", options) );
+
+    PNG written;
+    REQUIRE( written.readFromFile("out-encoder.png") );
+    REQUIRE( written == expected );
+  }
+
+  // storing is the largest; compressing at all helps a lot
+  REQUIRE( sizes[0] > png.width() * png.height() * 4 );
+  REQUIRE( sizes[1] < sizes[0] / 2 );
+  REQUIRE( sizes[9] <= sizes[1] );
+}
+
+TEST_CASE("Parallel PNG encoding gives the same file as serial and streaming encoding", "[weight=1]") {
+  PNG png(333, 901);
+  png.forEachPixel([](HSLAPixel & pixel, unsigned x, unsigned y) {
+    pixel = HSLAPixel((x * 3 + y) % 360, 0.5, ((x ^ y) % 64) / 63.0, 1);
+  });
+
+  PNGEncoderOptions options;
+  options.level = 3;
+  options.filter = PNGFilter::Paeth;
+
+  ParallelExecutor executor(4);
+  REQUIRE( png.writeToFile("out-encoder-serial.png", options) );
+  REQUIRE( png.writeToFile("out-encoder-parallel.png", options, executor) );
+
+  PNGWriter writer;
+  REQUIRE( writer.open("out-encoder-streamed.png", png.width(), png.height(), options) );
+  for (unsigned y = 0; y < png.height(); y += PNG::BAND_HEIGHT) {
+    REQUIRE( writer.writeRows(png.row(y), std::min(PNG::BAND_HEIGHT, png.height() - y)) );
+  }
+  REQUIRE( writer.close() );
+
+  std::vector<unsigned char> serial = readFileBytes("out-encoder-serial.png");
+  REQUIRE( readFileBytes("out-encoder-parallel.png") == serial );
+  REQUIRE( readFileBytes("out-encoder-streamed.png") == serial );
+
+  PNG written;
+  REQUIRE( written.readFromFile("out-encoder-parallel.png") );
+  PNG expected;
+  REQUIRE( png.writeToFile("out-encoder-expected.png") );
+  REQUIRE( expected.readFromFile("out-encoder-expected.png") );
+  REQUIRE( written == expected );
+
+  // an empty image is still a valid file
+  REQUIRE( PNG().writeToFile("out-encoder-empty.png", options, executor) );
+}
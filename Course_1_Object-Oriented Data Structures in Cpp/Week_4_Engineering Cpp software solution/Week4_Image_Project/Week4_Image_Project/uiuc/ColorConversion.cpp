@@ -0,0 +1,388 @@
+/**
+ * @file ColorConversion.cpp
+ * Scalar, SSE2 and AVX implementations of the batch RGBA8 <-> HSLA kernels.
+ *
+ * The SIMD kernels follow rgb2hsl / hsl2rgb operation by operation, so the
+ * results are bit-for-bit identical:
+ *  - the if-chains become compare masks and blends,
+ *  - fmod((g - b) / chroma, 6) is just (g - b) / chroma, since that value is
+ *    always within [-1, 1],
+ *  - fmod(hh, 2) is computed exactly as hh - 2 * trunc(hh / 2),
+ *  - round(v) is computed exactly as trunc(v) +/- 1 when |v - trunc(v)| >= 0.5.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include "HSLAPixel.h"
+#include "ColorConversion.h"
+#include "RGB_HSL.h"
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define UIUC_COLOR_SIMD 1
+#endif
+
+namespace uiuc {
+  void rgbaToHslaScalar(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      rgbaColor rgb;
+      rgb.r = rgba[(i * 4)];
+      rgb.g = rgba[(i * 4) + 1];
+      rgb.b = rgba[(i * 4) + 2];
+      rgb.a = rgba[(i * 4) + 3];
+
+      hslaColor hsl = rgb2hsl(rgb);
+      HSLAPixel & pixel = hsla[i];
+      pixel.h = hsl.h;
+      pixel.s = hsl.s;
+      pixel.l = hsl.l;
+      pixel.a = hsl.a;
+    }
+  }
+
+  void hslaToRgbaScalar(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      hslaColor hsl;
+      hsl.h = hsla[i].h;
+      hsl.s = hsla[i].s;
+      hsl.l = hsla[i].l;
+      hsl.a = hsla[i].a;
+
+      rgbaColor rgb = hsl2rgb(hsl);
+
+      rgba[(i * 4)]     = rgb.r;
+      rgba[(i * 4) + 1] = rgb.g;
+      rgba[(i * 4) + 2] = rgb.b;
+      rgba[(i * 4) + 3] = rgb.a;
+    }
+  }
+
+#ifdef UIUC_COLOR_SIMD
+  namespace {
+    /*
+     * SSE2: two pixels per step, one double lane per pixel.
+     */
+
+    /** mask ? a : b */
+    inline __m128d select2(__m128d mask, __m128d a, __m128d b) {
+      return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+    }
+
+    inline __m128d abs2(__m128d v) {
+      return _mm_andnot_pd(_mm_set1_pd(-0.0), v);
+    }
+
+    /** trunc(v), valid for |v| < 2^31 */
+    inline __m128d trunc2(__m128d v) {
+      return _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+    }
+
+    /** round(v) (half away from zero), valid for |v| < 2^31 */
+    inline __m128d round2(__m128d v) {
+      __m128d t = trunc2(v);
+      __m128d f = _mm_sub_pd(v, t);
+      __m128d one = _mm_set1_pd(1.0);
+      t = _mm_add_pd(t, _mm_and_pd(_mm_cmpge_pd(f, _mm_set1_pd(0.5)), one));
+      t = _mm_sub_pd(t, _mm_and_pd(_mm_cmple_pd(f, _mm_set1_pd(-0.5)), one));
+      return t;
+    }
+
+    /** Low byte of each (integral) lane, like a double -> unsigned char conversion */
+    inline __m128i bytes2(__m128d v) {
+      return _mm_and_si128(_mm_cvttpd_epi32(v), _mm_set1_epi32(0xFF));
+    }
+
+    void rgbaToHslaStep2(unsigned char const * rgba, HSLAPixel * hsla) {
+      __m128i px = _mm_loadl_epi64((__m128i const *) rgba);
+      __m128i lowByte = _mm_set1_epi32(0xFF);
+      __m128d k255 = _mm_set1_pd(255.0);
+
+      __m128d r = _mm_div_pd(_mm_cvtepi32_pd(_mm_and_si128(px, lowByte)), k255);
+      __m128d g = _mm_div_pd(_mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(px, 8), lowByte)), k255);
+      __m128d b = _mm_div_pd(_mm_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(px, 16), lowByte)), k255);
+      __m128d a = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_epi32(px, 24)), k255);
+
+      __m128d min = _mm_min_pd(_mm_min_pd(r, g), b);
+      __m128d max = _mm_max_pd(_mm_max_pd(r, g), b);
+      __m128d chroma = _mm_sub_pd(max, min);
+      __m128d l = _mm_mul_pd(_mm_set1_pd(0.5), _mm_add_pd(max, min));
+
+      __m128d eps = _mm_set1_pd(0.0001);
+      __m128d gray = _mm_or_pd(_mm_cmplt_pd(chroma, eps), _mm_cmplt_pd(max, eps));
+
+      __m128d one = _mm_set1_pd(1.0);
+      __m128d s = _mm_div_pd(chroma, _mm_sub_pd(one, abs2(_mm_sub_pd(_mm_mul_pd(_mm_set1_pd(2.0), l), one))));
+
+      __m128d isR = _mm_cmpeq_pd(max, r);
+      __m128d isG = _mm_andnot_pd(isR, _mm_cmpeq_pd(max, g));
+      __m128d num = select2(isR, _mm_sub_pd(g, b), select2(isG, _mm_sub_pd(b, r), _mm_sub_pd(r, g)));
+      __m128d h = _mm_div_pd(num, chroma);
+      h = select2(isR, h, _mm_add_pd(h, select2(isG, _mm_set1_pd(2.0), _mm_set1_pd(4.0))));
+      h = _mm_mul_pd(h, _mm_set1_pd(60.0));
+      h = select2(_mm_cmplt_pd(h, _mm_setzero_pd()), _mm_add_pd(h, _mm_set1_pd(360.0)), h);
+
+      h = _mm_andnot_pd(gray, h);
+      s = _mm_andnot_pd(gray, s);
+
+      _mm_storeu_pd(&hsla[0].h, _mm_unpacklo_pd(h, s));
+      _mm_storeu_pd(&hsla[0].l, _mm_unpacklo_pd(l, a));
+      _mm_storeu_pd(&hsla[1].h, _mm_unpackhi_pd(h, s));
+      _mm_storeu_pd(&hsla[1].l, _mm_unpackhi_pd(l, a));
+    }
+
+    void hslaToRgbaStep2(HSLAPixel const * hsla, unsigned char * rgba) {
+      __m128d hs0 = _mm_loadu_pd(&hsla[0].h);
+      __m128d la0 = _mm_loadu_pd(&hsla[0].l);
+      __m128d hs1 = _mm_loadu_pd(&hsla[1].h);
+      __m128d la1 = _mm_loadu_pd(&hsla[1].l);
+      __m128d h = _mm_unpacklo_pd(hs0, hs1);
+      __m128d s = _mm_unpackhi_pd(hs0, hs1);
+      __m128d l = _mm_unpacklo_pd(la0, la1);
+      __m128d a = _mm_unpackhi_pd(la0, la1);
+
+      // trunc2 only works for |hh / 2| < 2^31; leave anything else to hsl2rgb
+      if (_mm_movemask_pd(_mm_cmpnlt_pd(abs2(h), _mm_set1_pd(1e9)))) {
+        hslaToRgbaScalar(hsla, rgba, 2);
+        return;
+      }
+
+      __m128d one = _mm_set1_pd(1.0);
+      __m128d zero = _mm_setzero_pd();
+      __m128d k255 = _mm_set1_pd(255.0);
+
+      __m128d c = _mm_mul_pd(_mm_sub_pd(one, abs2(_mm_sub_pd(_mm_mul_pd(_mm_set1_pd(2.0), l), one))), s);
+      __m128d hh = _mm_div_pd(h, _mm_set1_pd(60.0));
+      __m128d hhMod2 = _mm_sub_pd(hh, _mm_mul_pd(trunc2(_mm_mul_pd(hh, _mm_set1_pd(0.5))), _mm_set1_pd(2.0)));
+      __m128d x = _mm_mul_pd(c, _mm_sub_pd(one, abs2(_mm_sub_pd(hhMod2, one))));
+
+      // walk the hsl2rgb if-chain backwards so the first matching case wins
+      __m128d r = c, g = zero, b = x, mask;
+      mask = _mm_cmple_pd(hh, _mm_set1_pd(5.0));
+      r = select2(mask, x, r); g = select2(mask, zero, g); b = select2(mask, c, b);
+      mask = _mm_cmple_pd(hh, _mm_set1_pd(4.0));
+      r = select2(mask, zero, r); g = select2(mask, x, g); b = select2(mask, c, b);
+      mask = _mm_cmple_pd(hh, _mm_set1_pd(3.0));
+      r = select2(mask, zero, r); g = select2(mask, c, g); b = select2(mask, x, b);
+      mask = _mm_cmple_pd(hh, _mm_set1_pd(2.0));
+      r = select2(mask, x, r); g = select2(mask, c, g); b = select2(mask, zero, b);
+      mask = _mm_cmple_pd(hh, one);
+      r = select2(mask, c, r); g = select2(mask, x, g); b = select2(mask, zero, b);
+
+      __m128d m = _mm_sub_pd(l, _mm_mul_pd(_mm_set1_pd(0.5), c));
+      r = round2(_mm_mul_pd(_mm_add_pd(r, m), k255));
+      g = round2(_mm_mul_pd(_mm_add_pd(g, m), k255));
+      b = round2(_mm_mul_pd(_mm_add_pd(b, m), k255));
+
+      __m128d gray = _mm_cmple_pd(s, _mm_set1_pd(0.001));
+      __m128d grayValue = round2(_mm_mul_pd(l, k255));
+      r = select2(gray, grayValue, r);
+      g = select2(gray, grayValue, g);
+      b = select2(gray, grayValue, b);
+      a = round2(_mm_mul_pd(a, k255));
+
+      __m128i px = _mm_or_si128(
+        _mm_or_si128(bytes2(r), _mm_slli_epi32(bytes2(g), 8)),
+        _mm_or_si128(_mm_slli_epi32(bytes2(b), 16), _mm_slli_epi32(bytes2(a), 24)));
+      _mm_storel_epi64((__m128i *) rgba, px);
+    }
+
+    void rgbaToHslaSse2(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+      std::size_t i = 0;
+      for (; i + 2 <= count; i += 2) {
+        rgbaToHslaStep2(rgba + (i * 4), hsla + i);
+      }
+      rgbaToHslaScalar(rgba + (i * 4), hsla + i, count - i);
+    }
+
+    void hslaToRgbaSse2(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+      std::size_t i = 0;
+      for (; i + 2 <= count; i += 2) {
+        hslaToRgbaStep2(hsla + i, rgba + (i * 4));
+      }
+      hslaToRgbaScalar(hsla + i, rgba + (i * 4), count - i);
+    }
+
+    /*
+     * AVX: four pixels per step. Same operations as the SSE2 kernels, but
+     * with a real truncation instruction, so any finite hue is fine.
+     */
+#define UIUC_AVX __attribute__((target("avx")))
+
+    UIUC_AVX inline __m256d select4(__m256d mask, __m256d a, __m256d b) {
+      return _mm256_blendv_pd(b, a, mask);
+    }
+
+    UIUC_AVX inline __m256d abs4(__m256d v) {
+      return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+    }
+
+    UIUC_AVX inline __m256d trunc4(__m256d v) {
+      return _mm256_round_pd(v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    }
+
+    UIUC_AVX inline __m256d round4(__m256d v) {
+      __m256d t = trunc4(v);
+      __m256d f = _mm256_sub_pd(v, t);
+      __m256d one = _mm256_set1_pd(1.0);
+      t = _mm256_add_pd(t, _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(0.5), _CMP_GE_OQ), one));
+      t = _mm256_sub_pd(t, _mm256_and_pd(_mm256_cmp_pd(f, _mm256_set1_pd(-0.5), _CMP_LE_OQ), one));
+      return t;
+    }
+
+    UIUC_AVX inline __m128i bytes4(__m256d v) {
+      return _mm_and_si128(_mm256_cvttpd_epi32(v), _mm_set1_epi32(0xFF));
+    }
+
+    UIUC_AVX void rgbaToHslaStep4(unsigned char const * rgba, HSLAPixel * hsla) {
+      __m128i px = _mm_loadu_si128((__m128i const *) rgba);
+      __m128i lowByte = _mm_set1_epi32(0xFF);
+      __m256d k255 = _mm256_set1_pd(255.0);
+
+      __m256d r = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_and_si128(px, lowByte)), k255);
+      __m256d g = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(px, 8), lowByte)), k255);
+      __m256d b = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_and_si128(_mm_srli_epi32(px, 16), lowByte)), k255);
+      __m256d a = _mm256_div_pd(_mm256_cvtepi32_pd(_mm_srli_epi32(px, 24)), k255);
+
+      __m256d min = _mm256_min_pd(_mm256_min_pd(r, g), b);
+      __m256d max = _mm256_max_pd(_mm256_max_pd(r, g), b);
+      __m256d chroma = _mm256_sub_pd(max, min);
+      __m256d l = _mm256_mul_pd(_mm256_set1_pd(0.5), _mm256_add_pd(max, min));
+
+      __m256d eps = _mm256_set1_pd(0.0001);
+      __m256d gray = _mm256_or_pd(_mm256_cmp_pd(chroma, eps, _CMP_LT_OQ), _mm256_cmp_pd(max, eps, _CMP_LT_OQ));
+
+      __m256d one = _mm256_set1_pd(1.0);
+      __m256d s = _mm256_div_pd(chroma, _mm256_sub_pd(one, abs4(_mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), l), one))));
+
+      __m256d isR = _mm256_cmp_pd(max, r, _CMP_EQ_OQ);
+      __m256d isG = _mm256_andnot_pd(isR, _mm256_cmp_pd(max, g, _CMP_EQ_OQ));
+      __m256d num = select4(isR, _mm256_sub_pd(g, b), select4(isG, _mm256_sub_pd(b, r), _mm256_sub_pd(r, g)));
+      __m256d h = _mm256_div_pd(num, chroma);
+      h = select4(isR, h, _mm256_add_pd(h, select4(isG, _mm256_set1_pd(2.0), _mm256_set1_pd(4.0))));
+      h = _mm256_mul_pd(h, _mm256_set1_pd(60.0));
+      h = select4(_mm256_cmp_pd(h, _mm256_setzero_pd(), _CMP_LT_OQ), _mm256_add_pd(h, _mm256_set1_pd(360.0)), h);
+
+      h = _mm256_andnot_pd(gray, h);
+      s = _mm256_andnot_pd(gray, s);
+
+      // 4x4 transpose from channel vectors back to pixels
+      __m256d t0 = _mm256_unpacklo_pd(h, s);
+      __m256d t1 = _mm256_unpackhi_pd(h, s);
+      __m256d t2 = _mm256_unpacklo_pd(l, a);
+      __m256d t3 = _mm256_unpackhi_pd(l, a);
+      _mm256_storeu_pd(&hsla[0].h, _mm256_permute2f128_pd(t0, t2, 0x20));
+      _mm256_storeu_pd(&hsla[1].h, _mm256_permute2f128_pd(t1, t3, 0x20));
+      _mm256_storeu_pd(&hsla[2].h, _mm256_permute2f128_pd(t0, t2, 0x31));
+      _mm256_storeu_pd(&hsla[3].h, _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+
+    UIUC_AVX void hslaToRgbaStep4(HSLAPixel const * hsla, unsigned char * rgba) {
+      // 4x4 transpose from pixels to channel vectors
+      __m256d p0 = _mm256_loadu_pd(&hsla[0].h);
+      __m256d p1 = _mm256_loadu_pd(&hsla[1].h);
+      __m256d p2 = _mm256_loadu_pd(&hsla[2].h);
+      __m256d p3 = _mm256_loadu_pd(&hsla[3].h);
+      __m256d t0 = _mm256_unpacklo_pd(p0, p1);
+      __m256d t1 = _mm256_unpackhi_pd(p0, p1);
+      __m256d t2 = _mm256_unpacklo_pd(p2, p3);
+      __m256d t3 = _mm256_unpackhi_pd(p2, p3);
+      __m256d h = _mm256_permute2f128_pd(t0, t2, 0x20);
+      __m256d l = _mm256_permute2f128_pd(t0, t2, 0x31);
+      __m256d s = _mm256_permute2f128_pd(t1, t3, 0x20);
+      __m256d a = _mm256_permute2f128_pd(t1, t3, 0x31);
+
+      __m256d one = _mm256_set1_pd(1.0);
+      __m256d zero = _mm256_setzero_pd();
+      __m256d k255 = _mm256_set1_pd(255.0);
+
+      __m256d c = _mm256_mul_pd(_mm256_sub_pd(one, abs4(_mm256_sub_pd(_mm256_mul_pd(_mm256_set1_pd(2.0), l), one))), s);
+      __m256d hh = _mm256_div_pd(h, _mm256_set1_pd(60.0));
+      __m256d hhMod2 = _mm256_sub_pd(hh, _mm256_mul_pd(trunc4(_mm256_mul_pd(hh, _mm256_set1_pd(0.5))), _mm256_set1_pd(2.0)));
+      __m256d x = _mm256_mul_pd(c, _mm256_sub_pd(one, abs4(_mm256_sub_pd(hhMod2, one))));
+
+      __m256d r = c, g = zero, b = x, mask;
+      mask = _mm256_cmp_pd(hh, _mm256_set1_pd(5.0), _CMP_LE_OQ);
+      r = select4(mask, x, r); g = select4(mask, zero, g); b = select4(mask, c, b);
+      mask = _mm256_cmp_pd(hh, _mm256_set1_pd(4.0), _CMP_LE_OQ);
+      r = select4(mask, zero, r); g = select4(mask, x, g); b = select4(mask, c, b);
+      mask = _mm256_cmp_pd(hh, _mm256_set1_pd(3.0), _CMP_LE_OQ);
+      r = select4(mask, zero, r); g = select4(mask, c, g); b = select4(mask, x, b);
+      mask = _mm256_cmp_pd(hh, _mm256_set1_pd(2.0), _CMP_LE_OQ);
+      r = select4(mask, x, r); g = select4(mask, c, g); b = select4(mask, zero, b);
+      mask = _mm256_cmp_pd(hh, one, _CMP_LE_OQ);
+      r = select4(mask, c, r); g = select4(mask, x, g); b = select4(mask, zero, b);
+
+      __m256d m = _mm256_sub_pd(l, _mm256_mul_pd(_mm256_set1_pd(0.5), c));
+      r = round4(_mm256_mul_pd(_mm256_add_pd(r, m), k255));
+      g = round4(_mm256_mul_pd(_mm256_add_pd(g, m), k255));
+      b = round4(_mm256_mul_pd(_mm256_add_pd(b, m), k255));
+
+      __m256d gray = _mm256_cmp_pd(s, _mm256_set1_pd(0.001), _CMP_LE_OQ);
+      __m256d grayValue = round4(_mm256_mul_pd(l, k255));
+      r = select4(gray, grayValue, r);
+      g = select4(gray, grayValue, g);
+      b = select4(gray, grayValue, b);
+      a = round4(_mm256_mul_pd(a, k255));
+
+      __m128i px = _mm_or_si128(
+        _mm_or_si128(bytes4(r), _mm_slli_epi32(bytes4(g), 8)),
+        _mm_or_si128(_mm_slli_epi32(bytes4(b), 16), _mm_slli_epi32(bytes4(a), 24)));
+      _mm_storeu_si128((__m128i *) rgba, px);
+    }
+
+    UIUC_AVX void rgbaToHslaAvx(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+      std::size_t i = 0;
+      for (; i + 4 <= count; i += 4) {
+        rgbaToHslaStep4(rgba + (i * 4), hsla + i);
+      }
+      rgbaToHslaScalar(rgba + (i * 4), hsla + i, count - i);
+    }
+
+    UIUC_AVX void hslaToRgbaAvx(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+      std::size_t i = 0;
+      for (; i + 4 <= count; i += 4) {
+        hslaToRgbaStep4(hsla + i, rgba + (i * 4));
+      }
+      hslaToRgbaScalar(hsla + i, rgba + (i * 4), count - i);
+    }
+
+#undef UIUC_AVX
+
+    bool cpuHasAvx() {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx");
+    }
+  }
+
+  void rgbaToHsla(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    static bool const avx = cpuHasAvx();
+    if (avx) { rgbaToHslaAvx(rgba, hsla, count); }
+    else     { rgbaToHslaSse2(rgba, hsla, count); }
+  }
+
+  void hslaToRgba(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    static bool const avx = cpuHasAvx();
+    if (avx) { hslaToRgbaAvx(hsla, rgba, count); }
+    else     { hslaToRgbaSse2(hsla, rgba, count); }
+  }
+
+  char const * colorConversionKernel() {
+    return cpuHasAvx() ? "avx" : "sse2";
+  }
+
+#else
+
+  void rgbaToHsla(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count) {
+    rgbaToHslaScalar(rgba, hsla, count);
+  }
+
+  void hslaToRgba(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count) {
+    hslaToRgbaScalar(hsla, rgba, count);
+  }
+
+  char const * colorConversionKernel() {
+    return "scalar";
+  }
+
+#endif
+}
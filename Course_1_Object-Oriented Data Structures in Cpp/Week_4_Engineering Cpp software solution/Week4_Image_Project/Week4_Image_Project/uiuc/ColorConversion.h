@@ -0,0 +1,48 @@
+/**
+ * @file ColorConversion.h
+ * Batch RGBA8 <-> HSLAPixel conversion kernels.
+ *
+ * The batch kernels produce bit-for-bit the same results as calling
+ * rgb2hsl / hsl2rgb (RGB_HSL.h) on every pixel, but convert several pixels
+ * per instruction with SSE2 or AVX. The widest kernel the CPU supports is
+ * picked at runtime; the scalar kernels are used on other architectures.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "HSLAPixel.h"
+
+namespace uiuc {
+  /**
+   * Converts `count` RGBA8 pixels (4 bytes each, in r, g, b, a order) to
+   * HSLAPixels.
+   * @param rgba Source bytes, 4 * count of them.
+   * @param hsla Destination pixels, count of them.
+   * @param count Number of pixels to convert.
+   */
+  void rgbaToHsla(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count);
+
+  /**
+   * Converts `count` HSLAPixels to RGBA8 pixels (4 bytes each, in r, g, b, a
+   * order). Hues are expected to be within [-1e9, 1e9] degrees; pixels
+   * outside of that range are still converted, just without SIMD.
+   * @param hsla Source pixels, count of them.
+   * @param rgba Destination bytes, 4 * count of them.
+   * @param count Number of pixels to convert.
+   */
+  void hslaToRgba(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count);
+
+  /**
+   * Scalar reference versions of the kernels above, one rgb2hsl / hsl2rgb
+   * call per pixel.
+   */
+  void rgbaToHslaScalar(unsigned char const * rgba, HSLAPixel * hsla, std::size_t count);
+  void hslaToRgbaScalar(HSLAPixel const * hsla, unsigned char * rgba, std::size_t count);
+
+  /**
+   * Gets the name of the kernel picked for this CPU ("avx", "sse2" or
+   * "scalar").
+   */
+  char const * colorConversionKernel();
+}
@@ -0,0 +1,101 @@
+/**
+ * @file FastHash.cpp
+ * Implementation of XXH64.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "FastHash.h"
+
+namespace uiuc {
+  namespace {
+    const std::uint64_t PRIME1 = 11400714785074694791ULL;
+    const std::uint64_t PRIME2 = 14029467366897019727ULL;
+    const std::uint64_t PRIME3 = 1609587929392839161ULL;
+    const std::uint64_t PRIME4 = 9650029242287828579ULL;
+    const std::uint64_t PRIME5 = 2870177450012600261ULL;
+
+    inline std::uint64_t rotateLeft(std::uint64_t value, unsigned bits) {
+      return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline std::uint64_t read64(unsigned char const * p) {
+      std::uint64_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    inline std::uint32_t read32(unsigned char const * p) {
+      std::uint32_t value;
+      std::memcpy(&value, p, sizeof(value));
+      return value;
+    }
+
+    inline std::uint64_t mixLane(std::uint64_t acc, std::uint64_t input) {
+      acc += input * PRIME2;
+      acc = rotateLeft(acc, 31);
+      return acc * PRIME1;
+    }
+
+    inline std::uint64_t mergeLane(std::uint64_t acc, std::uint64_t value) {
+      acc ^= mixLane(0, value);
+      return acc * PRIME1 + PRIME4;
+    }
+  }
+
+  std::uint64_t fastHash64(void const * data, std::size_t size, std::uint64_t seed) {
+    unsigned char const * p = static_cast<unsigned char const *>(data);
+    unsigned char const * end = p + size;
+    std::uint64_t hash;
+
+    if (size >= 32) {
+      // four independent lanes, so consecutive steps do not wait on each other
+      std::uint64_t v1 = seed + PRIME1 + PRIME2;
+      std::uint64_t v2 = seed + PRIME2;
+      std::uint64_t v3 = seed;
+      std::uint64_t v4 = seed - PRIME1;
+
+      unsigned char const * limit = end - 32;
+      do {
+        v1 = mixLane(v1, read64(p));
+        v2 = mixLane(v2, read64(p + 8));
+        v3 = mixLane(v3, read64(p + 16));
+        v4 = mixLane(v4, read64(p + 24));
+        p += 32;
+      } while (p <= limit);
+
+      hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+      hash = mergeLane(hash, v1);
+      hash = mergeLane(hash, v2);
+      hash = mergeLane(hash, v3);
+      hash = mergeLane(hash, v4);
+    } else {
+      hash = seed + PRIME5;
+    }
+
+    hash += static_cast<std::uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) {
+      hash ^= mixLane(0, read64(p));
+      hash = rotateLeft(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end) {
+      hash ^= static_cast<std::uint64_t>(read32(p)) * PRIME1;
+      hash = rotateLeft(hash, 23) * PRIME2 + PRIME3;
+      p += 4;
+    }
+    for (; p < end; p++) {
+      hash ^= (*p) * PRIME5;
+      hash = rotateLeft(hash, 11) * PRIME1;
+    }
+
+    // final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+}
@@ -0,0 +1,26 @@
+/**
+ * @file FastHash.h
+ * A fast non-cryptographic 64-bit hash of a byte buffer (XXH64).
+ *
+ * XXH64 consumes 32 bytes per step in four independent lanes, so it runs at
+ * several GB/s, and its output matches the reference xxHash implementation.
+ * It is meant for hash tables and cache keys, not for security.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace uiuc {
+  /**
+    * Computes the XXH64 hash of `size` bytes. Words are read in the byte
+    * order of the machine; on little-endian machines the result matches
+    * the reference implementation.
+    * @param data The bytes to hash.
+    * @param size Number of bytes.
+    * @param seed Seed; different seeds give unrelated hashes.
+    * @return The 64-bit hash.
+    */
+  std::uint64_t fastHash64(void const * data, std::size_t size, std::uint64_t seed = 0);
+}
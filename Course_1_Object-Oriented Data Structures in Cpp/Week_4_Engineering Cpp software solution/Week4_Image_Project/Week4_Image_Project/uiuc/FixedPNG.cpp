@@ -0,0 +1,130 @@
+/**
+ * @file FixedPNG.cpp
+ * Implementation of a PNG image stored as 16-bit fixed-point pixels.
+ */
+
+#include <iostream>
+#include <string>
+#include <cassert>
+#include <cstring>
+#include "lodepng/lodepng.h"
+#include "HSLAPixel.h"
+#include "FixedPixel.h"
+#include "PNG.h"
+#include "FixedPNG.h"
+
+namespace uiuc {
+  FixedPNG::FixedPNG() {
+    width_ = 0;
+    height_ = 0;
+  }
+
+  FixedPNG::FixedPNG(unsigned int width, unsigned int height)
+    : width_(width), height_(height), pixels_(static_cast<std::size_t>(width) * height) { }
+
+  FixedPNG::FixedPNG(PNG const & image)
+    : FixedPNG(image.width(), image.height()) {
+    for (unsigned y = 0; y < height_; y++) {
+      HSLAPixel const * source = image.row(y);
+      FixedPixel * destination = row(y);
+      for (unsigned x = 0; x < width_; x++) {
+        destination[x] = toFixed(source[x]);
+      }
+    }
+  }
+
+  PNG FixedPNG::toPNG() const {
+    PNG image(width_, height_);
+    for (unsigned y = 0; y < height_; y++) {
+      FixedPixel const * source = row(y);
+      HSLAPixel * destination = image.row(y);
+      for (unsigned x = 0; x < width_; x++) {
+        destination[x] = toHSLA(source[x]);
+      }
+    }
+    return image;
+  }
+
+  bool FixedPNG::operator==(FixedPNG const & other) const {
+    // FixedPixel has no padding, so comparing bytes compares every channel
+    return width_ == other.width_ && height_ == other.height_ &&
+           std::memcmp(pixels_.data(), other.pixels_.data(), pixels_.size() * sizeof(FixedPixel)) == 0;
+  }
+
+  bool FixedPNG::operator!=(FixedPNG const & other) const {
+    return !(*this == other);
+  }
+
+  bool FixedPNG::readFromFile(string const & fileName) {
+    vector<unsigned char> byteData;
+    unsigned width, height;
+    unsigned error = lodepng::decode(byteData, width, height, fileName);
+
+    if (error) {
+      cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << endl;
+      return false;
+    }
+
+    *this = FixedPNG(width, height);
+    rgbaToFixed(byteData.data(), pixels_.data(), pixels_.size());
+    return true;
+  }
+
+  bool FixedPNG::writeToFile(string const & fileName) const {
+    vector<unsigned char> byteData(pixels_.size() * 4);
+    fixedToRgba(pixels_.data(), byteData.data(), pixels_.size());
+
+    unsigned error = lodepng::encode(fileName, byteData, width_, height_);
+    if (error) {
+      cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << endl;
+    }
+
+    return (error == 0);
+  }
+
+  unsigned FixedPNG::_index(unsigned int x, unsigned int y) const {
+    if (width_ == 0 || height_ == 0) {
+      cerr << "ERROR: Call to uiuc::FixedPNG::getPixel() made on an image with no pixels." << endl;
+      assert(width_ > 0);
+      assert(height_ > 0);
+    }
+
+    if (x >= width_) {
+      cerr << "WARNING: Call to uiuc::FixedPNG tries to access x=" << x
+          << ", which is outside of the image (image width: " << width_ << ")." << endl;
+      x = width_ - 1;
+    }
+
+    if (y >= height_) {
+      cerr << "WARNING: Call to uiuc::FixedPNG tries to access y=" << y
+          << ", which is outside of the image (image height: " << height_ << ")." << endl;
+      y = height_ - 1;
+    }
+
+    return x + (y * width_);
+  }
+
+  HSLAPixel FixedPNG::getPixel(unsigned int x, unsigned int y) const {
+    return toHSLA(pixels_[_index(x, y)]);
+  }
+
+  void FixedPNG::setPixel(unsigned int x, unsigned int y, HSLAPixel const & pixel) {
+    pixels_[_index(x, y)] = toFixed(pixel);
+  }
+
+  unsigned int FixedPNG::width() const {
+    return width_;
+  }
+
+  unsigned int FixedPNG::height() const {
+    return height_;
+  }
+
+  FixedPixel * FixedPNG::row(unsigned int y) {
+    return pixels_.data() + (static_cast<std::size_t>(y) * width_);
+  }
+
+  FixedPixel const * FixedPNG::row(unsigned int y) const {
+    return pixels_.data() + (static_cast<std::size_t>(y) * width_);
+  }
+}
@@ -0,0 +1,128 @@
+/**
+ * @file FixedPNG.h
+ * A PNG image stored as an array of 16-bit fixed-point FixedPixels instead
+ * of an array of HSLAPixels, for jobs that read and write 8-bit PNG files.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+#include "FixedPixel.h"
+#include "PNG.h"
+#include "PixelPool.h"
+
+using namespace std;
+
+namespace uiuc {
+  class FixedPNG {
+  public:
+    /**
+      * Creates an empty fixed-point image.
+      */
+    FixedPNG();
+
+    /**
+      * Creates a fixed-point image of the specified dimensions. Every
+      * channel of every pixel starts at 0.
+      * @param width Width of the new image.
+      * @param height Height of the new image.
+      */
+    FixedPNG(unsigned int width, unsigned int height);
+
+    /**
+      * Creates a fixed-point copy of a PNG image. Each pixel is rounded to
+      * the nearest FixedPixel (see toFixed).
+      * @param image PNG to be copied.
+      */
+    explicit FixedPNG(PNG const & image);
+
+    /**
+      * Converts this image back to an array-of-HSLAPixel PNG.
+      * @return A PNG with the same dimensions and pixel values.
+      */
+    PNG toPNG() const;
+
+    /**
+      * Equality operator: checks if two images are the same.
+      * @param other Image to be checked.
+      * @return Whether the current image is equal to the other image.
+      */
+    bool operator== (FixedPNG const & other) const;
+
+    /**
+      * Inequality operator: checks if two images are different.
+      * @param other Image to be checked.
+      * @return Whether the current image differs from the other image.
+      */
+    bool operator!= (FixedPNG const & other) const;
+
+    /**
+      * Reads in a PNG image from a file.
+      * Overwrites any current image content.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromFile(string const & fileName);
+
+    /**
+      * Writes the image to a PNG file. An image read with readFromFile
+      * and written back unchanged gives exactly the pixels of the file.
+      * @param fileName Name of the file to be written.
+      * @return true, if the image was successfully written.
+      */
+    bool writeToFile(string const & fileName) const;
+
+    /**
+      * Gets the pixel at the given coordinates, as an HSLAPixel.
+      * Coordinates outside of the image are truncated to the nearest edge,
+      * as in PNG::getPixel.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @return The pixel at the given coordinates.
+      */
+    HSLAPixel getPixel(unsigned int x, unsigned int y) const;
+
+    /**
+      * Sets the pixel at the given coordinates to the nearest FixedPixel
+      * of `pixel`.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @param pixel The new pixel value.
+      */
+    void setPixel(unsigned int x, unsigned int y, HSLAPixel const & pixel);
+
+    /**
+      * Gets the width of this image.
+      * @return Width of the image.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of this image.
+      * @return Height of the image.
+      */
+    unsigned int height() const;
+
+    /**
+      * Gets the pixels of row `y`: width() of them, with no bounds
+      * checking.
+      * @param y Row index, less than height().
+      * @return A pointer to the first pixel of the row.
+      */
+    FixedPixel * row(unsigned int y);
+    FixedPixel const * row(unsigned int y) const;
+
+  private:
+    unsigned int width_;            /*< Width of the image */
+    unsigned int height_;           /*< Height of the image */
+    vector<FixedPixel, PixelPoolAllocator<FixedPixel>> pixels_;   /*< Pixels in row-major order, in pooled memory */
+
+    /**
+     * Clamps (x, y) to the image, warning on cerr like PNG::getPixel.
+     * @return The index of the clamped coordinates in pixels_.
+     */
+    unsigned _index(unsigned int x, unsigned int y) const;
+  };
+}
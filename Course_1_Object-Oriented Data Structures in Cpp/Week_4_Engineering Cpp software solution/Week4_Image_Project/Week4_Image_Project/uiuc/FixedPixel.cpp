@@ -0,0 +1,145 @@
+/**
+ * @file FixedPixel.cpp
+ * Implementation of the fixed-point HSLA conversions.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include "HSLAPixel.h"
+#include "FixedPixel.h"
+
+namespace uiuc {
+  const std::uint32_t FixedPixel::HUE_STEPS;
+  const std::uint32_t FixedPixel::ONE;
+
+  namespace {
+    // Saturations up to this are grays, as in hsl2rgb: 0.001 * ONE, rounded down
+    const std::uint32_t GRAY_SATURATION = 65;
+
+    // Every term of fixedToRgba is an integer over this denominator:
+    // s and l bring ONE each, the hue fraction HUE_STEPS, and halving c a 2
+    const std::uint64_t DENOMINATOR = static_cast<std::uint64_t>(FixedPixel::ONE) * FixedPixel::ONE * FixedPixel::HUE_STEPS * 2;
+
+    std::uint16_t toFixedUnit(double value) {
+      if (!(value > 0)) { return 0; }
+      if (value >= 1) { return FixedPixel::ONE; }
+      return static_cast<std::uint16_t>(value * FixedPixel::ONE + 0.5);
+    }
+
+    // round(numerator / denominator), for positive integers
+    inline std::uint32_t roundedDivide(std::uint32_t numerator, std::uint32_t denominator) {
+      return ((2 * numerator) + denominator) / (2 * denominator);
+    }
+
+    inline void rgbToFixed(unsigned char const * rgba, FixedPixel & pixel) {
+      std::int32_t r = rgba[0], g = rgba[1], b = rgba[2];
+      std::int32_t max = (r > g) ? r : g;
+      max = (max > b) ? max : b;
+      std::int32_t min = (r < g) ? r : g;
+      min = (min < b) ? min : b;
+      std::int32_t chroma = max - min;
+
+      // l = (max + min) / 510
+      pixel.l = static_cast<std::uint16_t>(roundedDivide((max + min) * FixedPixel::ONE, 510));
+      pixel.a = static_cast<std::uint16_t>(rgba[3] * 257);
+
+      if (chroma == 0) {
+        pixel.h = pixel.s = 0;
+        return;
+      }
+
+      // s = chroma / (1 - |2l - 1|), both sides in units of 1/255
+      std::int32_t spread = 255 - ((max + min > 255) ? (max + min - 255) : (255 - max - min));
+      pixel.s = static_cast<std::uint16_t>(roundedDivide(chroma * FixedPixel::ONE, spread));
+
+      // h / 60 = sixths / chroma, in [0, 6]
+      std::int32_t sixths;
+      if      (max == r) { sixths = g - b; if (sixths < 0) { sixths += 6 * chroma; } }
+      else if (max == g) { sixths = (b - r) + (2 * chroma); }
+      else               { sixths = (r - g) + (4 * chroma); }
+
+      // a full turn wraps around to 0 in 16 bits
+      pixel.h = static_cast<std::uint16_t>(roundedDivide(sixths * (FixedPixel::HUE_STEPS / 2), 3 * chroma));
+    }
+
+    inline unsigned char toByte(std::uint64_t value) {
+      // value / DENOMINATOR in [0, 1], scaled to [0, 255] and rounded
+      return static_cast<unsigned char>(((value * 510) + DENOMINATOR) / (2 * DENOMINATOR));
+    }
+
+    inline void fixedToRgb(FixedPixel const & pixel, unsigned char * rgba) {
+      rgba[3] = static_cast<unsigned char>(roundedDivide(pixel.a * 255, FixedPixel::ONE));
+
+      if (pixel.s <= GRAY_SATURATION) {
+        rgba[0] = rgba[1] = rgba[2] = static_cast<unsigned char>(roundedDivide(pixel.l * 255, FixedPixel::ONE));
+        return;
+      }
+
+      // c = (1 - |2l - 1|) s, as (width * s) / ONE^2
+      std::int64_t l = pixel.l;
+      std::int64_t width = FixedPixel::ONE - ((2 * l > FixedPixel::ONE) ? (2 * l - FixedPixel::ONE) : (FixedPixel::ONE - 2 * l));
+      std::uint64_t c = static_cast<std::uint64_t>(width * pixel.s);
+
+      // the sector of the color wheel and how far into it the hue is
+      std::uint32_t scaled = pixel.h * 6u;
+      std::uint32_t sector = scaled / FixedPixel::HUE_STEPS;
+      std::uint64_t fraction = scaled % FixedPixel::HUE_STEPS;
+      if (sector % 2 == 1) { fraction = FixedPixel::HUE_STEPS - fraction; }
+
+      // c, x and m = l - c / 2, all over DENOMINATOR
+      std::uint64_t cTerm = c * (2 * FixedPixel::HUE_STEPS);
+      std::uint64_t xTerm = c * 2 * fraction;
+      std::uint64_t m = static_cast<std::uint64_t>(l) * FixedPixel::ONE * (2 * FixedPixel::HUE_STEPS) - c * FixedPixel::HUE_STEPS;
+
+      std::uint64_t red, green, blue;
+      switch (sector) {
+        case 0:  red = cTerm; green = xTerm; blue = 0;     break;
+        case 1:  red = xTerm; green = cTerm; blue = 0;     break;
+        case 2:  red = 0;     green = cTerm; blue = xTerm; break;
+        case 3:  red = 0;     green = xTerm; blue = cTerm; break;
+        case 4:  red = xTerm; green = 0;     blue = cTerm; break;
+        default: red = cTerm; green = 0;     blue = xTerm; break;
+      }
+
+      rgba[0] = toByte(red + m);
+      rgba[1] = toByte(green + m);
+      rgba[2] = toByte(blue + m);
+    }
+  }
+
+  FixedPixel toFixed(HSLAPixel const & pixel) {
+    double hue = pixel.h;
+    if (!(hue >= 0 && hue < 360)) {
+      hue = std::fmod(hue, 360.0);
+      if (hue < 0) { hue += 360; }
+      if (!(hue >= 0 && hue < 360)) { hue = 0; }
+    }
+
+    FixedPixel result;
+    // a hue rounding up to a full turn wraps around to 0
+    result.h = static_cast<std::uint16_t>(static_cast<std::uint32_t>(hue * (FixedPixel::HUE_STEPS / 360.0) + 0.5));
+    result.s = toFixedUnit(pixel.s);
+    result.l = toFixedUnit(pixel.l);
+    result.a = toFixedUnit(pixel.a);
+    return result;
+  }
+
+  HSLAPixel toHSLA(FixedPixel const & pixel) {
+    return HSLAPixel(pixel.h * (360.0 / FixedPixel::HUE_STEPS),
+                     pixel.s / static_cast<double>(FixedPixel::ONE),
+                     pixel.l / static_cast<double>(FixedPixel::ONE),
+                     pixel.a / static_cast<double>(FixedPixel::ONE));
+  }
+
+  void rgbaToFixed(unsigned char const * rgba, FixedPixel * fixed, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      rgbToFixed(rgba + (4 * i), fixed[i]);
+    }
+  }
+
+  void fixedToRgba(FixedPixel const * fixed, unsigned char * rgba, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+      fixedToRgb(fixed[i], rgba + (4 * i));
+    }
+  }
+}
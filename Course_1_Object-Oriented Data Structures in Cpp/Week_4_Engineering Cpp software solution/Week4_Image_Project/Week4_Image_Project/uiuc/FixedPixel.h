@@ -0,0 +1,60 @@
+/**
+ * @file FixedPixel.h
+ * An HSLA pixel stored as four 16-bit fixed-point channels, and its
+ * conversions to and from RGBA8 and HSLAPixel.
+ *
+ * A FixedPixel is 8 bytes instead of the 32 of an HSLAPixel. 16 bits per
+ * channel are far finer than the 8 bits of a PNG file: converting any
+ * RGBA8 color to a FixedPixel and back gives exactly the same color again,
+ * for all 2^24 colors and every alpha. Both conversions only use integer
+ * arithmetic.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "HSLAPixel.h"
+
+namespace uiuc {
+  struct FixedPixel {
+    static const std::uint32_t HUE_STEPS = 65536;  /*< Hue steps per full turn, so h wraps around naturally */
+    static const std::uint32_t ONE = 65535;        /*< Value of s, l and a that stands for 1 */
+
+    std::uint16_t h;    /*< Hue, in units of 360 / HUE_STEPS degrees */
+    std::uint16_t s;    /*< Saturation, in units of 1 / ONE */
+    std::uint16_t l;    /*< Luminance, in units of 1 / ONE */
+    std::uint16_t a;    /*< Alpha, in units of 1 / ONE */
+  };
+
+  /**
+   * Converts an HSLAPixel to the nearest FixedPixel. Hues are wrapped into
+   * [0, 360); saturation, luminance and alpha are capped to [0, 1].
+   */
+  FixedPixel toFixed(HSLAPixel const & pixel);
+
+  /**
+   * Converts a FixedPixel to an HSLAPixel.
+   */
+  HSLAPixel toHSLA(FixedPixel const & pixel);
+
+  /**
+   * Converts `count` RGBA8 pixels (4 bytes each, in r, g, b, a order) to
+   * FixedPixels, with the formulas of rgb2hsl (RGB_HSL.h) carried out in
+   * integers and rounded once at the end.
+   * @param rgba Source bytes, 4 * count of them.
+   * @param fixed Destination pixels, count of them.
+   * @param count Number of pixels to convert.
+   */
+  void rgbaToFixed(unsigned char const * rgba, FixedPixel * fixed, std::size_t count);
+
+  /**
+   * Converts `count` FixedPixels to RGBA8 pixels, with the formulas of
+   * hsl2rgb (RGB_HSL.h) carried out in integers and rounded once at the
+   * end. Like hsl2rgb, saturations of 0.001 or less give a gray.
+   * @param fixed Source pixels, count of them.
+   * @param rgba Destination bytes, 4 * count of them.
+   * @param count Number of pixels to convert.
+   */
+  void fixedToRgba(FixedPixel const * fixed, unsigned char * rgba, std::size_t count);
+}
@@ -0,0 +1,144 @@
+/**
+ * @file ImageDiff.cpp
+ * Implementation of image comparison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ParallelExecutor.h"
+#include "ImageDiff.h"
+
+namespace uiuc {
+  namespace {
+    /** The part of an ImageDiff found in one tile of rows */
+    struct TileDiff {
+      std::uint64_t mismatches = 0;
+      double maxError = 0;
+      unsigned maxErrorX = 0, maxErrorY = 0;
+      unsigned xBegin = 0, yBegin = 0, xEnd = 0, yEnd = 0;    // bounds, empty while xEnd == 0
+
+      void add(unsigned x, unsigned y, double error, double tolerance) {
+        if (error > maxError) {
+          maxError = error;
+          maxErrorX = x;
+          maxErrorY = y;
+        }
+        if (error <= tolerance) { return; }
+
+        mismatches++;
+        if (xEnd == 0) {
+          xBegin = x; yBegin = y; xEnd = x + 1; yEnd = y + 1;
+        } else {
+          xBegin = std::min(xBegin, x); yBegin = std::min(yBegin, y);
+          xEnd = std::max(xEnd, x + 1); yEnd = std::max(yEnd, y + 1);
+        }
+      }
+
+      // tiles are merged in row order, so ties keep the first pixel
+      void merge(TileDiff const & other) {
+        if (other.maxError > maxError) {
+          maxError = other.maxError;
+          maxErrorX = other.maxErrorX;
+          maxErrorY = other.maxErrorY;
+        }
+        if (other.xEnd == 0) { return; }
+
+        mismatches += other.mismatches;
+        if (xEnd == 0) {
+          xBegin = other.xBegin; yBegin = other.yBegin; xEnd = other.xEnd; yEnd = other.yEnd;
+        } else {
+          xBegin = std::min(xBegin, other.xBegin); yBegin = std::min(yBegin, other.yBegin);
+          xEnd = std::max(xEnd, other.xEnd); yEnd = std::max(yEnd, other.yEnd);
+        }
+      }
+    };
+
+    // NaNs (and out of range values) count as the largest error
+    double channelError(double difference) {
+      return (difference <= 1.0) ? difference : 1.0;
+    }
+
+    HSLAPixel heatmapPixel(HSLAPixel const * pixel, double error, double tolerance) {
+      if (error <= tolerance) { return HSLAPixel(0, 0, (pixel != NULL) ? 0.3 * pixel->l : 0, 1); }
+      return HSLAPixel(60 * (1 - error), 1, 0.5, 1);
+    }
+
+    void diffRows(PNG const & first, PNG const & second, unsigned width, unsigned yBegin, unsigned yEnd,
+                  double tolerance, PNG * heatmap, TileDiff & result) {
+      for (unsigned y = yBegin; y < yEnd; y++) {
+        HSLAPixel const * row1 = (y < first.height()) ? first.row(y) : NULL;
+        HSLAPixel const * row2 = (y < second.height()) ? second.row(y) : NULL;
+        HSLAPixel * heat = (heatmap != NULL) ? heatmap->row(y) : NULL;
+
+        unsigned common = (row1 != NULL && row2 != NULL) ? std::min(first.width(), second.width()) : 0;
+        bool identical = common > 0 && std::memcmp(row1, row2, common * sizeof(HSLAPixel)) == 0;
+
+        for (unsigned x = 0; x < common; x++) {
+          double error = identical ? 0 : pixelError(row1[x], row2[x]);
+          if (!identical) { result.add(x, y, error, tolerance); }
+          if (heat != NULL) { heat[x] = heatmapPixel(&row1[x], error, tolerance); }
+        }
+
+        for (unsigned x = common; x < width; x++) {
+          result.add(x, y, 1.0, tolerance);
+          if (heat != NULL) { heat[x] = heatmapPixel(NULL, 1.0, tolerance); }
+        }
+      }
+    }
+
+    ImageDiff diffWith(PNG const & first, PNG const & second, double tolerance, PNG * heatmap, TaskRunner const & run) {
+      unsigned width = std::max(first.width(), second.width());
+      unsigned height = std::max(first.height(), second.height());
+      if (heatmap != NULL) { *heatmap = PNG(width, height); }
+
+      // tiles sized for the wider image, which has the longer rows
+      unsigned rows = ParallelExecutor::tileRows(first.width() >= second.width() ? first : second);
+      unsigned tiles = (height + rows - 1) / rows;
+      std::vector<TileDiff> tileDiffs(tiles);
+      run(tiles, [&](unsigned int tile) {
+        diffRows(first, second, width, tile * rows, std::min(height, (tile + 1) * rows), tolerance, heatmap, tileDiffs[tile]);
+      });
+
+      TileDiff total;
+      for (TileDiff const & tileDiff : tileDiffs) { total.merge(tileDiff); }
+
+      ImageDiff result;
+      result.sameSize = first.width() == second.width() && first.height() == second.height();
+      result.mismatches = total.mismatches;
+      result.maxError = total.maxError;
+      result.maxErrorX = total.maxErrorX;
+      result.maxErrorY = total.maxErrorY;
+      result.boundsX = total.xBegin;
+      result.boundsY = total.yBegin;
+      result.boundsWidth = total.xEnd - total.xBegin;
+      result.boundsHeight = total.yEnd - total.yBegin;
+      return result;
+    }
+  }
+
+  bool ImageDiff::matches() const {
+    return sameSize && mismatches == 0;
+  }
+
+  double pixelError(HSLAPixel const & first, HSLAPixel const & second) {
+    double hue = std::fmod(std::fabs(first.h - second.h), 360.0);
+    double error = channelError(std::min(hue, 360.0 - hue) / 180.0);
+    error = std::max(error, channelError(std::fabs(first.s - second.s)));
+    error = std::max(error, channelError(std::fabs(first.l - second.l)));
+    error = std::max(error, channelError(std::fabs(first.a - second.a)));
+    return error;
+  }
+
+  ImageDiff diffImages(PNG const & first, PNG const & second, double tolerance, PNG * heatmap) {
+    return diffWith(first, second, tolerance, heatmap, taskRunner(NULL));
+  }
+
+  ImageDiff diffImages(PNG const & first, PNG const & second, double tolerance, PNG * heatmap,
+                       ParallelExecutor & executor) {
+    return diffWith(first, second, tolerance, heatmap, taskRunner(&executor));
+  }
+}
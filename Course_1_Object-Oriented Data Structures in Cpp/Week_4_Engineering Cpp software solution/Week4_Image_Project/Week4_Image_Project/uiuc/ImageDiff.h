@@ -0,0 +1,69 @@
+/**
+ * @file ImageDiff.h
+ * Comparing two images pixel by pixel, with a tolerance, to find out how
+ * much and where they differ.
+ *
+ * Rows that are bitwise identical are recognized with one memcmp and
+ * skipped, so comparing an image with an unchanged copy runs at memory
+ * speed. Only rows that differ are compared channel by channel.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "HSLAPixel.h"
+#include "PNG.h"
+
+namespace uiuc {
+  class ParallelExecutor;
+
+  /**
+    * The result of diffImages.
+    */
+  struct ImageDiff {
+    bool sameSize;              /*< Whether the two images have the same dimensions */
+    std::uint64_t mismatches;   /*< Pixels whose error is above the tolerance */
+    double maxError;            /*< Largest channel error of any pixel, from 0 to 1 */
+    unsigned int maxErrorX;     /*< Column of a pixel with the largest error */
+    unsigned int maxErrorY;     /*< Row of a pixel with the largest error */
+    unsigned int boundsX;       /*< First column of the bounding box of the mismatches */
+    unsigned int boundsY;       /*< First row of the bounding box of the mismatches */
+    unsigned int boundsWidth;   /*< Width of the bounding box, 0 if there are no mismatches */
+    unsigned int boundsHeight;  /*< Height of the bounding box, 0 if there are no mismatches */
+
+    /**
+      * Checks whether the images match: same size and no mismatches.
+      */
+    bool matches() const;
+  };
+
+  /**
+    * Gets the error between two pixels: the largest difference of any
+    * channel. Saturation, luminance and alpha differences are taken as
+    * they are; hue differences go the short way around the color wheel and
+    * are divided by 180, so every channel's error is between 0 and 1.
+    */
+  double pixelError(HSLAPixel const & first, HSLAPixel const & second);
+
+  /**
+    * Compares two images. Images of different sizes are compared over the
+    * larger width and height, with pixels outside of either image
+    * counting as mismatches with error 1.
+    * @param first The first image, e.g. the output under test.
+    * @param second The second image, e.g. the expected output.
+    * @param tolerance Largest error (see pixelError) that still counts as
+    *        a match.
+    * @param heatmap If not NULL, receives an image of the compared size in
+    *        which matching pixels are a dim gray copy of `first` and
+    *        mismatches are colored from yellow (small error) to red (error 1).
+    * @return Mismatch count, largest error and bounding box.
+    */
+  ImageDiff diffImages(PNG const & first, PNG const & second, double tolerance = 0, PNG * heatmap = NULL);
+
+  /**
+    * Compares two images like diffImages above, with the rows split into
+    * tiles on `executor`. The result is identical.
+    */
+  ImageDiff diffImages(PNG const & first, PNG const & second, double tolerance, PNG * heatmap,
+                       ParallelExecutor & executor);
+}
@@ -0,0 +1,163 @@
+/**
+ * @file ImageStatistics.cpp
+ * Implementation of one-pass image statistics.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ParallelExecutor.h"
+#include "ImageStatistics.h"
+#include "Instrumentation.h"
+
+namespace uiuc {
+  namespace {
+    // hue, saturation, luminance and alpha, in that order everywhere below
+    const unsigned int CHANNELS = 4;
+    const double CHANNEL_UPPER[CHANNELS] = { 360.0, 1.0, 1.0, 1.0 };
+
+    /** What one share of the rows adds to the statistics */
+    struct ShareStatistics {
+      std::vector<std::uint64_t> histograms;    // CHANNELS histograms of `bins` bins, back to back
+      double sum[CHANNELS];
+      double sumSquares[CHANNELS];
+      double min[CHANNELS];
+      double max[CHANNELS];
+
+      explicit ShareStatistics(unsigned bins) : histograms(CHANNELS * bins, 0) {
+        for (unsigned c = 0; c < CHANNELS; c++) {
+          sum[c] = 0;
+          sumSquares[c] = 0;
+          min[c] = std::numeric_limits<double>::infinity();
+          max[c] = -std::numeric_limits<double>::infinity();
+        }
+      }
+    };
+
+    // NaNs and values below the range land in the first bin
+    inline unsigned binOf(double value, double scale, unsigned bins) {
+      double scaled = value * scale;
+      if (!(scaled > 0)) { return 0; }
+      return (scaled < bins) ? static_cast<unsigned>(scaled) : bins - 1;
+    }
+
+    // Accumulates one channel of a pixel; kept inline so the compiler keeps
+    // the running sums and extremes in registers across the row
+    inline void addValue(double value, double scale, unsigned bins, std::uint64_t * histogram,
+                         double & sum, double & sumSquares, double & min, double & max) {
+      histogram[binOf(value, scale, bins)]++;
+      sum += value;
+      sumSquares += value * value;
+      if (value < min) { min = value; }
+      if (value > max) { max = value; }
+    }
+
+    void sweepRows(PNG const & image, unsigned yBegin, unsigned yEnd, unsigned bins, ShareStatistics & share) {
+      double scale[CHANNELS];
+      std::uint64_t * histogram[CHANNELS];
+      for (unsigned c = 0; c < CHANNELS; c++) {
+        scale[c] = bins / CHANNEL_UPPER[c];
+        histogram[c] = &share.histograms[c * bins];
+      }
+
+      for (unsigned y = yBegin; y < yEnd; y++) {
+        HSLAPixel const * pixels = image.row(y);
+        for (unsigned x = 0; x < image.width(); x++) {
+          HSLAPixel const & pixel = pixels[x];
+          addValue(pixel.h, scale[0], bins, histogram[0], share.sum[0], share.sumSquares[0], share.min[0], share.max[0]);
+          addValue(pixel.s, scale[1], bins, histogram[1], share.sum[1], share.sumSquares[1], share.min[1], share.max[1]);
+          addValue(pixel.l, scale[2], bins, histogram[2], share.sum[2], share.sumSquares[2], share.min[2], share.max[2]);
+          addValue(pixel.a, scale[3], bins, histogram[3], share.sum[3], share.sumSquares[3], share.min[3], share.max[3]);
+        }
+      }
+    }
+
+    ChannelStatistics channelStatistics(std::vector<ShareStatistics> const & shares, unsigned channel,
+                                        unsigned bins, std::uint64_t pixels) {
+      ChannelStatistics result;
+      result.lower = 0;
+      result.upper = CHANNEL_UPPER[channel];
+      result.histogram.assign(bins, 0);
+
+      double sum = 0, sumSquares = 0;
+      double min = std::numeric_limits<double>::infinity();
+      double max = -std::numeric_limits<double>::infinity();
+      for (ShareStatistics const & share : shares) {
+        std::uint64_t const * histogram = &share.histograms[channel * bins];
+        for (unsigned b = 0; b < bins; b++) { result.histogram[b] += histogram[b]; }
+        sum += share.sum[channel];
+        sumSquares += share.sumSquares[channel];
+        min = std::min(min, share.min[channel]);
+        max = std::max(max, share.max[channel]);
+      }
+
+      if (pixels == 0) {
+        result.min = result.max = result.mean = result.standardDeviation = 0;
+        return result;
+      }
+      result.min = min;
+      result.max = max;
+      result.mean = sum / pixels;
+      result.standardDeviation = std::sqrt(std::max(0.0, sumSquares / pixels - result.mean * result.mean));
+      return result;
+    }
+
+    ImageStatistics statisticsWith(PNG const & image, unsigned bins, unsigned shares, TaskRunner const & run) {
+      StageTimer timer("statistics", static_cast<std::uint64_t>(image.width()) * image.height());
+      bins = std::max(bins, 1u);
+
+      // each share is a run of whole tiles
+      unsigned rows = ParallelExecutor::tileRows(image);
+      unsigned tiles = (image.height() + rows - 1) / rows;
+      shares = std::max(1u, std::min(shares, tiles));
+
+      std::vector<ShareStatistics> shareStatistics(shares, ShareStatistics(bins));
+      run(shares, [&](unsigned int share) {
+        unsigned tileBegin = share * tiles / shares;
+        unsigned tileEnd = (share + 1) * tiles / shares;
+        sweepRows(image, tileBegin * rows, std::min(image.height(), tileEnd * rows), bins, shareStatistics[share]);
+      });
+
+      ImageStatistics result;
+      result.pixels = static_cast<std::uint64_t>(image.width()) * image.height();
+      result.hue = channelStatistics(shareStatistics, 0, bins, result.pixels);
+      result.saturation = channelStatistics(shareStatistics, 1, bins, result.pixels);
+      result.luminance = channelStatistics(shareStatistics, 2, bins, result.pixels);
+      result.alpha = channelStatistics(shareStatistics, 3, bins, result.pixels);
+      return result;
+    }
+  }
+
+  double ChannelStatistics::binWidth() const {
+    return histogram.empty() ? 0 : (upper - lower) / histogram.size();
+  }
+
+  double ChannelStatistics::percentile(double fraction) const {
+    std::uint64_t total = 0;
+    for (std::uint64_t count : histogram) { total += count; }
+    if (total == 0) { return 0; }
+
+    double target = std::min(std::max(fraction, 0.0), 1.0) * total;
+    double below = 0;
+    for (unsigned b = 0; b < histogram.size(); b++) {
+      double count = static_cast<double>(histogram[b]);
+      if (count > 0 && below + count >= target) {
+        double value = lower + (b + (target - below) / count) * binWidth();
+        return std::min(std::max(value, min), max);
+      }
+      below += count;
+    }
+    return max;
+  }
+
+  ImageStatistics computeStatistics(PNG const & image, unsigned int bins) {
+    return statisticsWith(image, bins, 1, taskRunner(NULL));
+  }
+
+  ImageStatistics computeStatistics(PNG const & image, unsigned int bins, ParallelExecutor & executor) {
+    return statisticsWith(image, bins, executor.threads(), taskRunner(&executor));
+  }
+}
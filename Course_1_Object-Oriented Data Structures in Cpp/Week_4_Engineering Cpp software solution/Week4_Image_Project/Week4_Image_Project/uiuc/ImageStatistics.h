@@ -0,0 +1,76 @@
+/**
+ * @file ImageStatistics.h
+ * Histograms, extremes, means and percentiles of the HSLA channels of an
+ * image, gathered in one pass over its pixels.
+ *
+ * With an executor, each thread sweeps its own share of the rows into its
+ * own histograms and sums, and the shares are merged once at the end, so
+ * the threads never write to shared counters.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PNG.h"
+
+namespace uiuc {
+  class ParallelExecutor;
+
+  /**
+    * Statistics of one channel of an image.
+    */
+  struct ChannelStatistics {
+    double lower;               /*< Lowest value of the histogram range: 0 */
+    double upper;               /*< End of the histogram range: 360 for hue, 1 otherwise */
+    double min;                 /*< Smallest value in the image */
+    double max;                 /*< Largest value in the image */
+    double mean;                /*< Arithmetic mean (for hue, of the angles in [0, 360)) */
+    double standardDeviation;   /*< Population standard deviation */
+    std::vector<std::uint64_t> histogram;   /*< Pixel counts of equal-width bins over [lower, upper) */
+
+    /**
+      * Gets the width of one histogram bin.
+      */
+    double binWidth() const;
+
+    /**
+      * Estimates the value below which `fraction` of the pixels lie, e.g.
+      * 0.5 for the median, interpolating within the histogram bin where
+      * the fraction is reached. The result is within [min, max] and is
+      * accurate to about one bin width.
+      * @param fraction Fraction of the pixels, from 0 to 1.
+      * @return The estimated value, or 0 for an empty image.
+      */
+    double percentile(double fraction) const;
+  };
+
+  /**
+    * The result of computeStatistics.
+    */
+  struct ImageStatistics {
+    std::uint64_t pixels;         /*< Number of pixels counted in every histogram */
+    ChannelStatistics hue;
+    ChannelStatistics saturation;
+    ChannelStatistics luminance;
+    ChannelStatistics alpha;
+  };
+
+  /**
+    * Computes the statistics of every channel of `image` in one pass.
+    * Values outside of a channel's range are counted in its first or last
+    * bin; the extremes and the mean use the values as they are.
+    * @param image The image to be measured.
+    * @param bins Number of histogram bins per channel (at least 1).
+    * @return Histograms, extremes, means and standard deviations.
+    */
+  ImageStatistics computeStatistics(PNG const & image, unsigned int bins = 256);
+
+  /**
+    * Computes the statistics of `image` like computeStatistics above, with
+    * one share of the rows per thread of `executor`. The histograms,
+    * extremes and pixel count are identical; means and deviations may
+    * differ in the last bits, since the sums are added in another order.
+    */
+  ImageStatistics computeStatistics(PNG const & image, unsigned int bins, ParallelExecutor & executor);
+}
@@ -0,0 +1,338 @@
+/**
+ * @file Inflater.cpp
+ * Implementation of the pull-based zlib decompressor (RFC 1950 / RFC 1951).
+ */
+
+#include <cstring>
+#include "Inflater.h"
+
+namespace uiuc {
+  const unsigned int Inflater::Huffman::FAST_BITS;
+
+  namespace {
+    const std::size_t INPUT_BYTES = 64 * 1024;
+    const std::size_t WINDOW_BYTES = 32 * 1024;   // largest distance deflate can refer back
+
+    const std::uint16_t LENGTH_BASE[29] = {
+      3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const unsigned char LENGTH_EXTRA[29] = {
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const std::uint16_t DISTANCE_BASE[30] = {
+      1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+      257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const unsigned char DISTANCE_EXTRA[30] = {
+      0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+      7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    const unsigned char CODE_LENGTH_ORDER[19] = {
+      16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+  }
+
+  bool Inflater::Huffman::build(unsigned char const * lengths, unsigned int symbols) {
+    std::memset(count, 0, sizeof(count));
+    std::memset(fast, 0, sizeof(fast));
+    for (unsigned s = 0; s < symbols; s++) { count[lengths[s]]++; }
+    count[0] = 0;
+
+    // incomplete codes are allowed (e.g. a single distance code), over-subscribed ones are not
+    int left = 1;
+    for (unsigned len = 1; len < 16; len++) {
+      left = (left << 1) - count[len];
+      if (left < 0) { return false; }
+    }
+
+    std::uint16_t offset[16];
+    offset[1] = 0;
+    for (unsigned len = 1; len < 15; len++) { offset[len + 1] = offset[len] + count[len]; }
+    for (unsigned s = 0; s < symbols; s++) {
+      if (lengths[s] != 0) { symbol[offset[lengths[s]]++] = s; }
+    }
+
+    // deflate sends codes most significant bit first, so the table is indexed by reversed codes
+    unsigned code = 0, index = 0;
+    for (unsigned len = 1; len <= FAST_BITS; len++) {
+      for (unsigned i = 0; i < count[len]; i++, index++, code++) {
+        unsigned reversed = 0;
+        for (unsigned bit = 0; bit < len; bit++) { reversed |= ((code >> bit) & 1) << (len - 1 - bit); }
+        for (unsigned entry = reversed; entry < (1u << FAST_BITS); entry += (1u << len)) {
+          fast[entry] = (symbol[index] << 4) | len;
+        }
+      }
+      code <<= 1;
+    }
+
+    return true;
+  }
+
+  Inflater::Inflater(Source source)
+    : source_(source), input_(INPUT_BYTES), inputPos_(0), inputEnd_(0), bits_(0), bitCount_(0),
+      window_(WINDOW_BYTES), written_(0), state_(HEADER), lastBlock_(false), storedLeft_(0),
+      matchLeft_(0), matchDistance_(0), adler_(1), error_(NULL) { }
+
+  char const * Inflater::error() const {
+    return error_;
+  }
+
+  bool Inflater::finished() const {
+    return state_ == DONE && error_ == NULL;
+  }
+
+  void Inflater::_fail(char const * error) {
+    if (error_ == NULL) { error_ = error; }
+    state_ = DONE;
+    matchLeft_ = 0;
+  }
+
+  bool Inflater::_need(unsigned int count) {
+    while (bitCount_ < count && bitCount_ <= 56) {
+      if (inputPos_ == inputEnd_) {
+        inputEnd_ = source_(input_.data(), input_.size());
+        inputPos_ = 0;
+        if (inputEnd_ == 0) { break; }
+      }
+      bits_ |= static_cast<std::uint64_t>(input_[inputPos_++]) << bitCount_;
+      bitCount_ += 8;
+    }
+    return bitCount_ >= count;
+  }
+
+  unsigned int Inflater::_bits(unsigned int count) {
+    if (!_need(count)) {
+      _fail("unexpected end of compressed data");
+      return 0;
+    }
+    unsigned value = static_cast<unsigned>(bits_ & ((static_cast<std::uint64_t>(1) << count) - 1));
+    bits_ >>= count;
+    bitCount_ -= count;
+    return value;
+  }
+
+  unsigned int Inflater::_decode(Huffman const & code) {
+    _need(Huffman::FAST_BITS);
+    unsigned entry = code.fast[bits_ & ((1u << Huffman::FAST_BITS) - 1)];
+    if (entry != 0 && (entry & 15) <= bitCount_) {
+      bits_ >>= (entry & 15);
+      bitCount_ -= (entry & 15);
+      return entry >> 4;
+    }
+
+    // longer code (or the end of the input): walk the canonical code one bit at a time
+    int value = 0, first = 0, index = 0;
+    for (unsigned len = 1; len < 16; len++) {
+      value |= _bits(1);
+      if (error_ != NULL) { return 0; }
+      int count = code.count[len];
+      if (value - count < first) { return code.symbol[index + (value - first)]; }
+      index += count;
+      first = (first + count) << 1;
+      value <<= 1;
+    }
+
+    _fail("invalid Huffman code");
+    return 0;
+  }
+
+  void Inflater::_startBlock() {
+    lastBlock_ = _bits(1);
+    unsigned type = _bits(2);
+    if (error_ != NULL) { return; }
+
+    if (type == 0) {
+      _bits(bitCount_ & 7);
+      unsigned length = _bits(16);
+      unsigned inverse = _bits(16);
+      if (error_ != NULL) { return; }
+      if (length != (~inverse & 0xFFFF)) { _fail("invalid stored block length"); return; }
+      storedLeft_ = length;
+      state_ = STORED;
+    } else if (type == 1) {
+      unsigned char lengths[288 + 30];
+      std::memset(lengths, 8, 144);
+      std::memset(lengths + 144, 9, 112);
+      std::memset(lengths + 256, 7, 24);
+      std::memset(lengths + 280, 8, 8);
+      std::memset(lengths + 288, 5, 30);
+      lengthCode_.build(lengths, 288);
+      distanceCode_.build(lengths + 288, 30);
+      state_ = CODES;
+    } else if (type == 2) {
+      _readDynamicCodes();
+      if (error_ == NULL) { state_ = CODES; }
+    } else {
+      _fail("invalid block type");
+    }
+  }
+
+  void Inflater::_readDynamicCodes() {
+    unsigned lengthCount = _bits(5) + 257;
+    unsigned distanceCount = _bits(5) + 1;
+    unsigned codeLengthCount = _bits(4) + 4;
+    if (error_ != NULL) { return; }
+    if (lengthCount > 286 || distanceCount > 30) { _fail("too many codes"); return; }
+
+    unsigned char lengths[286 + 30];
+    std::memset(lengths, 0, sizeof(lengths));
+    for (unsigned i = 0; i < codeLengthCount; i++) {
+      lengths[CODE_LENGTH_ORDER[i]] = _bits(3);
+    }
+
+    Huffman codeLengthCode;
+    if (error_ != NULL) { return; }
+    if (!codeLengthCode.build(lengths, 19)) { _fail("invalid code length code"); return; }
+
+    std::memset(lengths, 0, sizeof(lengths));
+    unsigned index = 0;
+    while (index < lengthCount + distanceCount) {
+      unsigned symbol = _decode(codeLengthCode);
+      if (error_ != NULL) { return; }
+
+      if (symbol < 16) {
+        lengths[index++] = symbol;
+        continue;
+      }
+
+      unsigned char value = 0;
+      unsigned repeat;
+      if (symbol == 16) {
+        if (index == 0) { _fail("repeated code length without a previous one"); return; }
+        value = lengths[index - 1];
+        repeat = 3 + _bits(2);
+      } else if (symbol == 17) {
+        repeat = 3 + _bits(3);
+      } else {
+        repeat = 11 + _bits(7);
+      }
+
+      if (error_ != NULL) { return; }
+      if (index + repeat > lengthCount + distanceCount) { _fail("too many code lengths"); return; }
+      while (repeat-- > 0) { lengths[index++] = value; }
+    }
+
+    if (lengths[256] == 0) { _fail("missing end-of-block code"); return; }
+    if (!lengthCode_.build(lengths, lengthCount)) { _fail("invalid literal/length code"); return; }
+    if (!distanceCode_.build(lengths + lengthCount, distanceCount)) { _fail("invalid distance code"); return; }
+  }
+
+  std::uint32_t updateAdler32(std::uint32_t adler, unsigned char const * data, std::size_t size) {
+    std::uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    while (size > 0) {
+      // 5552 is the most bytes that can be summed before b may overflow
+      std::size_t chunk = size < 5552 ? size : 5552;
+      for (std::size_t i = 0; i < chunk; i++) {
+        a += data[i];
+        b += a;
+      }
+      a %= 65521;
+      b %= 65521;
+      data += chunk;
+      size -= chunk;
+    }
+    return (b << 16) | a;
+  }
+
+  std::uint32_t combineAdler32(std::uint32_t first, std::uint32_t second, std::size_t secondSize) {
+    // a = 1 + sum of bytes and b = sum of the a's after every byte; the
+    // second piece's a's all grow by a1 - 1 when it follows the first piece
+    const std::uint32_t BASE = 65521;
+    std::uint32_t n = secondSize % BASE;
+    std::uint32_t a1 = first & 0xFFFF, b1 = first >> 16;
+    std::uint32_t a2 = second & 0xFFFF, b2 = second >> 16;
+
+    std::uint32_t a = (a1 + a2 + BASE - 1) % BASE;
+    std::uint32_t b = (b1 + b2 + ((n * ((a1 + BASE - 1) % BASE)) % BASE)) % BASE;
+    return (b << 16) | a;
+  }
+
+  std::size_t Inflater::read(unsigned char * out, std::size_t size) {
+    std::size_t produced = 0, checked = 0;
+
+    while (produced < size && state_ != DONE) {
+      if (matchLeft_ > 0) {
+        while (matchLeft_ > 0 && produced < size) {
+          unsigned char byte = window_[(written_ - matchDistance_) & (WINDOW_BYTES - 1)];
+          out[produced++] = byte;
+          window_[written_++ & (WINDOW_BYTES - 1)] = byte;
+          matchLeft_--;
+        }
+        continue;
+      }
+
+      switch (state_) {
+        case HEADER: {
+          unsigned method = _bits(8);
+          unsigned flags = _bits(8);
+          if (error_ != NULL) { break; }
+          if ((method & 15) != 8 || (method >> 4) > 7 || ((method << 8) | flags) % 31 != 0) {
+            _fail("invalid zlib header");
+          } else if (flags & 32) {
+            _fail("zlib preset dictionaries are not supported");
+          } else {
+            state_ = BLOCK;
+          }
+          break;
+        }
+
+        case BLOCK:
+          if (lastBlock_) { state_ = TRAILER; } else { _startBlock(); }
+          break;
+
+        case STORED: {
+          if (storedLeft_ == 0) { state_ = BLOCK; break; }
+          unsigned char byte = _bits(8);
+          if (error_ != NULL) { break; }
+          out[produced++] = byte;
+          window_[written_++ & (WINDOW_BYTES - 1)] = byte;
+          storedLeft_--;
+          break;
+        }
+
+        case CODES: {
+          unsigned symbol = _decode(lengthCode_);
+          if (error_ != NULL) { break; }
+
+          if (symbol < 256) {
+            out[produced++] = symbol;
+            window_[written_++ & (WINDOW_BYTES - 1)] = symbol;
+          } else if (symbol == 256) {
+            state_ = BLOCK;
+          } else {
+            symbol -= 257;
+            if (symbol >= 29) { _fail("invalid length symbol"); break; }
+            unsigned length = LENGTH_BASE[symbol] + _bits(LENGTH_EXTRA[symbol]);
+
+            unsigned distanceSymbol = _decode(distanceCode_);
+            if (error_ != NULL) { break; }
+            if (distanceSymbol >= 30) { _fail("invalid distance symbol"); break; }
+            unsigned distance = DISTANCE_BASE[distanceSymbol] + _bits(DISTANCE_EXTRA[distanceSymbol]);
+
+            if (error_ != NULL) { break; }
+            if (distance > written_) { _fail("distance too far back"); break; }
+            matchLeft_ = length;
+            matchDistance_ = distance;
+          }
+          break;
+        }
+
+        case TRAILER: {
+          _bits(bitCount_ & 7);
+          std::uint32_t expected = 0;
+          for (unsigned i = 0; i < 4; i++) { expected = (expected << 8) | _bits(8); }
+          if (error_ != NULL) { break; }
+
+          adler_ = updateAdler32(adler_, out + checked, produced - checked);
+          checked = produced;
+          if (expected != adler_) { _fail("Adler-32 checksum mismatch"); break; }
+          state_ = DONE;
+          break;
+        }
+
+        case DONE:
+          break;
+      }
+    }
+
+    adler_ = updateAdler32(adler_, out + checked, produced - checked);
+    return produced;
+  }
+}
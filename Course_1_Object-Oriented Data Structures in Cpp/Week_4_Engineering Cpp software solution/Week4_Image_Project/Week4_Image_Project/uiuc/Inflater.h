@@ -0,0 +1,143 @@
+/**
+ * @file Inflater.h
+ * A pull-based zlib decompressor that only keeps a 32 KB window in memory.
+ *
+ * lodepng can only inflate a whole buffer at once, which means holding both
+ * the complete compressed and decompressed image. The Inflater instead
+ * reads compressed bytes from a source callback as it needs them and
+ * produces as many decompressed bytes as the caller asks for.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace uiuc {
+  /**
+    * Updates an Adler-32 checksum (RFC 1950) with `size` more bytes.
+    * @param adler Checksum of the bytes so far; 1 for none.
+    * @param data The bytes to add.
+    * @param size Number of bytes to add.
+    * @return The updated checksum.
+    */
+  std::uint32_t updateAdler32(std::uint32_t adler, unsigned char const * data, std::size_t size);
+
+  /**
+    * Combines the Adler-32 checksums of two consecutive pieces of data.
+    * @param first Checksum of the first piece.
+    * @param second Checksum of the second piece, computed starting from 1.
+    * @param secondSize Number of bytes in the second piece.
+    * @return The checksum of both pieces together.
+    */
+  std::uint32_t combineAdler32(std::uint32_t first, std::uint32_t second, std::size_t secondSize);
+
+  class Inflater {
+  public:
+    /**
+      * Fills `buffer` with up to `size` compressed bytes and returns how many
+      * it wrote; 0 means there is no more input.
+      */
+    typedef std::function<std::size_t(unsigned char *, std::size_t)> Source;
+
+    /**
+      * Creates an Inflater for a zlib stream (RFC 1950) read from `source`.
+      * @param source Callable providing the compressed bytes.
+      */
+    explicit Inflater(Source source);
+
+    /**
+      * Decompresses up to `size` bytes into `out`.
+      * @param out Destination buffer, at least `size` bytes.
+      * @param size Number of bytes wanted.
+      * @return Number of bytes written; less than `size` only at the end of
+      *         the stream or on an error.
+      */
+    std::size_t read(unsigned char * out, std::size_t size);
+
+    /**
+      * Gets a description of the first error found in the stream.
+      * @return The error, or NULL if there was none so far.
+      */
+    char const * error() const;
+
+    /**
+      * Checks whether the whole stream, including its checksum, was read.
+      * @return Whether the end of the stream was reached without an error.
+      */
+    bool finished() const;
+
+  private:
+    /**
+     * Canonical Huffman code, decoded through a table of the first
+     * FAST_BITS bits with a bit-by-bit fallback for longer codes.
+     */
+    struct Huffman {
+      static const unsigned int FAST_BITS = 10;
+
+      std::uint16_t count[16];                 /*< Number of codes of each length */
+      std::uint16_t symbol[288];               /*< Symbols ordered by code */
+      std::uint16_t fast[1 << FAST_BITS];      /*< (symbol << 4) | length, 0 if longer than FAST_BITS */
+
+      /**
+       * Builds the code from the code length of every symbol.
+       * @return Whether the lengths describe a valid code.
+       */
+      bool build(unsigned char const * lengths, unsigned int symbols);
+    };
+
+    enum State { HEADER, BLOCK, STORED, CODES, TRAILER, DONE };
+
+    Source source_;                         /*< Where compressed bytes come from */
+    std::vector<unsigned char> input_;      /*< Compressed bytes read from the source */
+    std::size_t inputPos_;                  /*< Next unread byte of input_ */
+    std::size_t inputEnd_;                  /*< Number of valid bytes in input_ */
+    std::uint64_t bits_;                    /*< Bit buffer, next bit lowest */
+    unsigned int bitCount_;                 /*< Number of valid bits in bits_ */
+    std::vector<unsigned char> window_;     /*< The last 32 KB of output */
+    std::size_t written_;                   /*< Total bytes produced so far */
+    State state_;                           /*< What to decode next */
+    bool lastBlock_;                        /*< Whether the current block is the final one */
+    unsigned int storedLeft_;               /*< Bytes left in the current stored block */
+    unsigned int matchLeft_;                /*< Bytes left in the current back reference */
+    unsigned int matchDistance_;            /*< Distance of the current back reference */
+    Huffman lengthCode_;                    /*< Literal/length code of the current block */
+    Huffman distanceCode_;                  /*< Distance code of the current block */
+    std::uint32_t adler_;                   /*< Adler-32 of the output so far */
+    char const * error_;                    /*< First error, or NULL */
+
+    /**
+     * Tops up the bit buffer from the input.
+     * @return Whether at least `count` bits are available.
+     */
+    bool _need(unsigned int count);
+
+    /**
+     * Takes `count` bits (at most 32) from the stream, least significant
+     * bit first. Sets an error if the input ended.
+     */
+    unsigned int _bits(unsigned int count);
+
+    /**
+     * Decodes one symbol using `code`.
+     */
+    unsigned int _decode(Huffman const & code);
+
+    /**
+     * Reads the header of the next block and prepares to decode it.
+     */
+    void _startBlock();
+
+    /**
+     * Reads the code lengths of a dynamic block and builds its codes.
+     */
+    void _readDynamicCodes();
+
+    /**
+     * Records the first error and stops decoding.
+     */
+    void _fail(char const * error);
+  };
+}
@@ -0,0 +1,177 @@
+/**
+ * @file Instrumentation.cpp
+ * Implementation of the stage collector and StageTimer.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include "Instrumentation.h"
+
+namespace uiuc {
+  std::atomic<bool> Instrumentation::enabled_(false);
+
+  namespace {
+    std::mutex recordsMutex;                  // guards stageRecords and epoch
+    std::vector<StageRecord> stageRecords;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::atomic<unsigned> threadCount(0);
+    thread_local unsigned threadId = 0;
+    thread_local StageTimer * currentStage = nullptr;
+
+    std::uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+      std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+      if (elapsed.count() < 0) { return 0; }
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    }
+
+    std::uint64_t collectorTime() {
+      std::chrono::steady_clock::time_point start;
+      {
+        std::lock_guard<std::mutex> lock(recordsMutex);
+        start = epoch;
+      }
+      return nanosecondsSince(start);
+    }
+
+    std::string jsonString(char const * text) {
+      std::string result = "\"";
+      for (char const * c = text; *c != 0; c++) {
+        if (*c == '"' || *c == '\\') { result += '\\'; }
+        result += *c;
+      }
+      return result + "\"";
+    }
+
+    bool writeFile(std::string const & fileName, std::string const & contents) {
+      std::ofstream file(fileName.c_str());
+      file << contents;
+      file.close();
+      if (!file) {
+        std::cerr << "Could not write " << fileName << std::endl;
+        return false;
+      }
+      return true;
+    }
+  }
+
+  void Instrumentation::enable() {
+    enabled_.store(true, std::memory_order_relaxed);
+  }
+
+  void Instrumentation::disable() {
+    enabled_.store(false, std::memory_order_relaxed);
+  }
+
+  void Instrumentation::_countAllocation(std::uint64_t bytes) {
+    for (StageTimer * stage = currentStage; stage != nullptr; stage = stage->parent_) {
+      stage->bytes_ += bytes;
+    }
+  }
+
+  std::vector<StageRecord> Instrumentation::records() {
+    std::lock_guard<std::mutex> lock(recordsMutex);
+    return stageRecords;
+  }
+
+  void Instrumentation::clear() {
+    std::lock_guard<std::mutex> lock(recordsMutex);
+    stageRecords.clear();
+    epoch = std::chrono::steady_clock::now();
+  }
+
+  bool Instrumentation::writeJson(std::string const & fileName) {
+    std::vector<StageRecord> all = records();
+
+    // totals per stage name, in order of first appearance
+    std::vector<StageRecord> totals;
+    std::vector<unsigned> counts;
+    for (StageRecord const & record : all) {
+      unsigned i = 0;
+      while (i < totals.size() && std::strcmp(totals[i].name, record.name) != 0) { i++; }
+      if (i == totals.size()) {
+        totals.push_back(record);
+        counts.push_back(1);
+        continue;
+      }
+      totals[i].durationNanoseconds += record.durationNanoseconds;
+      totals[i].bytesAllocated += record.bytesAllocated;
+      totals[i].pixels += record.pixels;
+      counts[i]++;
+    }
+
+    std::ostringstream out;
+    out << "{\n  \"stages\": [";
+    for (unsigned i = 0; i < totals.size(); i++) {
+      StageRecord const & total = totals[i];
+      double seconds = total.durationNanoseconds / 1e9;
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    { \"name\": " << jsonString(total.name) << ", \"count\": " << counts[i]
+          << ", \"total_ns\": " << total.durationNanoseconds << ", \"bytes_allocated\": " << total.bytesAllocated
+          << ", \"pixels\": " << total.pixels << ", \"mpix_per_second\": "
+          << std::setprecision(6) << ((seconds > 0) ? total.pixels / 1e6 / seconds : 0) << " }";
+    }
+    out << "\n  ],\n  \"records\": [";
+    for (unsigned i = 0; i < all.size(); i++) {
+      StageRecord const & record = all[i];
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    { \"name\": " << jsonString(record.name) << ", \"thread\": " << record.thread
+          << ", \"depth\": " << record.depth << ", \"start_ns\": " << record.startNanoseconds
+          << ", \"duration_ns\": " << record.durationNanoseconds << ", \"bytes_allocated\": " << record.bytesAllocated
+          << ", \"pixels\": " << record.pixels << " }";
+    }
+    out << "\n  ]\n}\n";
+
+    return writeFile(fileName, out.str());
+  }
+
+  bool Instrumentation::writeChromeTrace(std::string const & fileName) {
+    std::vector<StageRecord> all = records();
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [";
+    for (unsigned i = 0; i < all.size(); i++) {
+      StageRecord const & record = all[i];
+      out << (i == 0 ? "\n" : ",\n");
+      out << "    { \"name\": " << jsonString(record.name) << ", \"cat\": \"uiuc\", \"ph\": \"X\", \"pid\": 1"
+          << ", \"tid\": " << record.thread << ", \"ts\": " << record.startNanoseconds / 1e3
+          << ", \"dur\": " << record.durationNanoseconds / 1e3
+          << ", \"args\": { \"bytes_allocated\": " << record.bytesAllocated << ", \"pixels\": " << record.pixels << " } }";
+    }
+    out << "\n  ]\n}\n";
+
+    return writeFile(fileName, out.str());
+  }
+
+  void StageTimer::_start() {
+    if (threadId == 0) { threadId = ++threadCount; }
+    bytes_ = 0;
+    parent_ = currentStage;
+    depth_ = (parent_ != nullptr) ? parent_->depth_ + 1 : 0;
+    currentStage = this;
+    start_ = collectorTime();
+  }
+
+  void StageTimer::_finish() {
+    std::uint64_t end = collectorTime();
+    currentStage = parent_;
+
+    StageRecord record;
+    record.name = name_;
+    record.thread = threadId;
+    record.depth = depth_;
+    record.startNanoseconds = start_;
+    record.durationNanoseconds = (end > start_) ? end - start_ : 0;
+    record.bytesAllocated = bytes_;
+    record.pixels = pixels_;
+
+    std::lock_guard<std::mutex> lock(recordsMutex);
+    stageRecords.push_back(record);
+  }
+}
@@ -0,0 +1,144 @@
+/**
+ * @file Instrumentation.h
+ * Opt-in timing of the stages of image processing (decoding, color
+ * conversion, transforms, encoding), with the bytes each stage allocates
+ * and the pixels it touches.
+ *
+ * Stages are timed by StageTimer objects placed in PNG and in the
+ * transforms. Until Instrumentation::enable() is called a StageTimer does
+ * nothing but read one flag, so the hooks can stay in release builds. Once
+ * enabled, every finished stage is added to a process-wide collector that
+ * any thread may write to, and that can be saved as a JSON summary or as a
+ * Chrome trace (chrome://tracing, Perfetto) showing the stages of every
+ * thread on a timeline.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace uiuc {
+  /**
+    * One finished stage.
+    */
+  struct StageRecord {
+    char const * name;                  /*< Stage name, e.g. "png.decode" */
+    unsigned int thread;                /*< Small id of the thread that ran it, from 1 */
+    unsigned int depth;                 /*< Number of stages it ran inside of on its thread */
+    std::uint64_t startNanoseconds;     /*< Start, since the collector was last cleared */
+    std::uint64_t durationNanoseconds;  /*< Wall-clock duration */
+    std::uint64_t bytesAllocated;       /*< Bytes allocated by it and the stages inside it */
+    std::uint64_t pixels;               /*< Pixels it processed */
+  };
+
+  class Instrumentation {
+  public:
+    /**
+      * Starts recording stages.
+      */
+    static void enable();
+
+    /**
+      * Stops recording stages. Stages already recorded are kept.
+      */
+    static void disable();
+
+    /**
+      * Checks whether stages are being recorded.
+      */
+    static bool enabled() {
+      return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+      * Adds `bytes` to the allocations of the stage running on this thread,
+      * if any, and the stages it runs inside of.
+      */
+    static void countAllocation(std::uint64_t bytes) {
+      if (enabled()) { _countAllocation(bytes); }
+    }
+
+    /**
+      * Gets a copy of every stage recorded so far, in the order they finished.
+      */
+    static std::vector<StageRecord> records();
+
+    /**
+      * Forgets every recorded stage and restarts the clock.
+      */
+    static void clear();
+
+    /**
+      * Saves the recorded stages as JSON: a "stages" summary with the count,
+      * total time, bytes and pixels of each stage name, in order of first
+      * appearance, followed by every record.
+      * @param fileName Name of the file to be written.
+      * @return true, if the file was written.
+      */
+    static bool writeJson(std::string const & fileName);
+
+    /**
+      * Saves the recorded stages in the Chrome trace event format, as one
+      * complete ("X") event per stage.
+      * @param fileName Name of the file to be written.
+      * @return true, if the file was written.
+      */
+    static bool writeChromeTrace(std::string const & fileName);
+
+  private:
+    friend class StageTimer;
+
+    static std::atomic<bool> enabled_;    /*< Whether stages are being recorded */
+
+    static void _countAllocation(std::uint64_t bytes);
+  };
+
+  /**
+    * Times the enclosing scope as one stage, e.g.
+    *
+    *   StageTimer timer("grayscale", image.width() * image.height());
+    *
+    * Stages on one thread nest: bytes allocated inside an inner stage count
+    * towards the outer stages as well. `name` must outlive the collector,
+    * which a string literal does.
+    */
+  class StageTimer {
+  public:
+    explicit StageTimer(char const * name, std::uint64_t pixels = 0)
+      : active_(Instrumentation::enabled()), name_(name), pixels_(pixels) {
+      if (active_) { _start(); }
+    }
+
+    ~StageTimer() {
+      if (active_) { _finish(); }
+    }
+
+    StageTimer(StageTimer const & other) = delete;
+    StageTimer & operator= (StageTimer const & other) = delete;
+
+    /**
+      * Adds to the pixels processed by this stage, for stages that only know
+      * how many once they are done.
+      */
+    void addPixels(std::uint64_t pixels) {
+      pixels_ += pixels;
+    }
+
+  private:
+    friend class Instrumentation;
+
+    bool active_;                         /*< Whether the stage is recorded */
+    char const * name_;                   /*< Stage name */
+    std::uint64_t pixels_;                /*< Pixels processed */
+    std::uint64_t bytes_;                 /*< Bytes allocated so far */
+    std::uint64_t start_;                 /*< Start, in collector time */
+    unsigned int depth_;                  /*< Number of enclosing stages */
+    StageTimer * parent_;                 /*< Enclosing stage on this thread */
+
+    void _start();
+    void _finish();
+  };
+}
@@ -11,22 +11,91 @@
 #include <algorithm>
 #include <functional>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <memory>
 #include "lodepng/lodepng.h"
 #include "HSLAPixel.h"
 #include "PNG.h"
-#include "RGB_HSL.h"
+#include "ColorConversion.h"
+#include "FastHash.h"
+#include "ParallelExecutor.h"
+#include "Resample.h"
+#include "RawImage.h"
+#include "PNGStream.h"
+#include "Instrumentation.h"
+#include "PixelPool.h"
 
 namespace uiuc {
+  const unsigned int PNG::BAND_HEIGHT;
+
+  void PNG::_freePixels() {
+    if (mapping_ != NULL) {
+      delete mapping_;
+      mapping_ = NULL;
+    } else {
+      PixelPool::release(imageData_, static_cast<std::size_t>(width_) * height_);
+    }
+    imageData_ = NULL;
+  }
+
+  void PNG::_allocate(unsigned int width, unsigned int height) {
+    if (imageData_ == NULL || mapping_ != NULL || width * height != width_ * height_) {
+      _freePixels();
+      imageData_ = PixelPool::allocate(static_cast<std::size_t>(width) * height);
+      Instrumentation::countAllocation(static_cast<std::uint64_t>(width) * height * sizeof(HSLAPixel));
+    }
+
+    width_ = width;
+    height_ = height;
+    rawData_.clear();
+    bandConverted_.clear();
+  }
+
   void PNG::_copy(PNG const & other) {
-    // Clear self
-    delete[] imageData_;
+    // Copy `other` to self, reusing our buffer if it is already the right size
+    _allocate(other.width_, other.height_);
+    rawData_ = other.rawData_;
+    bandConverted_ = other.bandConverted_;
+    for (unsigned y = 0; y < height_; y++) {
+      // bands that were never converted have no HSL data to copy yet
+      if (rawData_.empty() || bandConverted_[y / BAND_HEIGHT]) {
+        std::copy(other.imageData_ + (y * width_), other.imageData_ + ((y + 1) * width_), imageData_ + (y * width_));
+      }
+    }
+  }
+
+  void PNG::_move(PNG & other) {
+    _freePixels();
 
-    // Copy `other` to self
     width_ = other.width_;
     height_ = other.height_;
-    imageData_ = new HSLAPixel[width_ * height_];
-    for (unsigned i = 0; i < width_ * height_; i++) {
-      imageData_[i] = other.imageData_[i];
+    imageData_ = other.imageData_;
+    mapping_ = other.mapping_;
+    rawData_.swap(other.rawData_);
+    bandConverted_.swap(other.bandConverted_);
+
+    other.width_ = 0;
+    other.height_ = 0;
+    other.imageData_ = NULL;
+    other.mapping_ = NULL;
+    other.rawData_.clear();
+    other.bandConverted_.clear();
+  }
+
+  void PNG::_convertBand(unsigned band) const {
+    if (rawData_.empty() || bandConverted_[band]) { return; }
+
+    unsigned offset = band * BAND_HEIGHT * width_;
+    unsigned rows = std::min(BAND_HEIGHT, height_ - (band * BAND_HEIGHT));
+    StageTimer timer("png.convertBand", rows * width_);
+    rgbaToHsla(&rawData_[offset * 4], imageData_ + offset, rows * width_);
+    bandConverted_[band] = 1;
+  }
+
+  void PNG::_convertAll() const {
+    for (unsigned band = 0; band < bandConverted_.size(); band++) {
+      _convertBand(band);
     }
   }
 
@@ -34,21 +103,36 @@ namespace uiuc {
     width_ = 0;
     height_ = 0;
     imageData_ = NULL;
+    mapping_ = NULL;
   }
 
   PNG::PNG(unsigned int width, unsigned int height) {
     width_ = width;
     height_ = height;
-    imageData_ = new HSLAPixel[width * height];
+    imageData_ = PixelPool::allocate(static_cast<std::size_t>(width) * height);
+    mapping_ = NULL;
+    std::uninitialized_fill_n(imageData_, static_cast<std::size_t>(width) * height, HSLAPixel());
+    Instrumentation::countAllocation(static_cast<std::uint64_t>(width) * height * sizeof(HSLAPixel));
   }
 
   PNG::PNG(PNG const & other) {
+    width_ = 0;
+    height_ = 0;
     imageData_ = NULL;
+    mapping_ = NULL;
     _copy(other);
   }
 
+  PNG::PNG(PNG && other) {
+    width_ = 0;
+    height_ = 0;
+    imageData_ = NULL;
+    mapping_ = NULL;
+    _move(other);
+  }
+
   PNG::~PNG() {
-    delete[] imageData_;
+    _freePixels();
   }
 
   PNG const & PNG::operator=(PNG const & other) {
@@ -56,14 +140,35 @@ namespace uiuc {
     return *this;
   }
 
+  PNG const & PNG::operator=(PNG && other) {
+    if (this != &other) { _move(other); }
+    return *this;
+  }
+
   bool PNG::operator==(PNG const & other) const {
     if (width_ != other.width_) { return false; }
     if (height_ != other.height_) { return false; }
 
-    for (unsigned i = 0; i < width_ * height_; i++) {
-      HSLAPixel & p1 = imageData_[i];
-      HSLAPixel & p2 = other.imageData_[i];
-      if (p1.h != p2.h || p1.s != p2.s || p1.l != p2.l || p1.a != p2.a) { return false; }
+    bool bothLazy = !rawData_.empty() && !other.rawData_.empty();
+
+    for (unsigned y = 0; y < height_; y++) {
+      unsigned band = y / BAND_HEIGHT;
+      if (bothLazy && !bandConverted_[band] && !other.bandConverted_[band]) {
+        // RGBA -> HSL is one-to-one, so the decoded bytes can be compared instead
+        vector<unsigned char>::const_iterator first = rawData_.begin() + (y * width_ * 4);
+        if (!std::equal(first, first + (width_ * 4), other.rawData_.begin() + (y * width_ * 4))) { return false; }
+        continue;
+      }
+
+      HSLAPixel * row1 = row(y);
+      HSLAPixel * row2 = other.row(y);
+      // bitwise identical rows are equal; memcmp compares them at memory speed
+      if (row1 == row2 || std::memcmp(row1, row2, width_ * sizeof(HSLAPixel)) == 0) { continue; }
+      for (unsigned x = 0; x < width_; x++) {
+        HSLAPixel & p1 = row1[x];
+        HSLAPixel & p2 = row2[x];
+        if (p1.h != p2.h || p1.s != p2.s || p1.l != p2.l || p1.a != p2.a) { return false; }
+      }
     }
 
     return true;
@@ -94,67 +199,192 @@ namespace uiuc {
       y = height_ - 1;
     }
 
+    if (!rawData_.empty()) { _convertBand(y / BAND_HEIGHT); }
+
     unsigned index = x + (y * width_);
     return imageData_[index];
   }
 
+  HSLAPixel * PNG::row(unsigned int y) const {
+    if (!rawData_.empty()) { _convertBand(y / BAND_HEIGHT); }
+    return imageData_ + (y * width_);
+  }
+
+  /**
+    * Decodes a PNG file to RGBA bytes, as the "png.decode" stage.
+    */
+  static unsigned decodeFile(vector<unsigned char> & byteData, unsigned & width, unsigned & height,
+                             string const & fileName) {
+    StageTimer timer("png.decode");
+    unsigned error = lodepng::decode(byteData, width, height, fileName);
+    if (!error) {
+      timer.addPixels(static_cast<std::uint64_t>(width) * height);
+      Instrumentation::countAllocation(byteData.size());
+    }
+    return error;
+  }
+
   bool PNG::readFromFile(string const & fileName) {
+    StageTimer timer("png.read");
     vector<unsigned char> byteData;
-    unsigned error = lodepng::decode(byteData, width_, height_, fileName);
+    unsigned width, height;
+    unsigned error = decodeFile(byteData, width, height, fileName);
 
     if (error) {
       cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << endl;
       return false;
     }
 
-    delete[] imageData_;
-    imageData_ = new HSLAPixel[width_ * height_];
-
-    for (unsigned i = 0; i < byteData.size(); i += 4) {
-      rgbaColor rgb;
-      rgb.r = byteData[i];
-      rgb.g = byteData[i + 1];
-      rgb.b = byteData[i + 2];
-      rgb.a = byteData[i + 3];
-
-      hslaColor hsl = rgb2hsl(rgb);
-      HSLAPixel & pixel = imageData_[i/4];
-      pixel.h = hsl.h;
-      pixel.s = hsl.s;
-      pixel.l = hsl.l;
-      pixel.a = hsl.a;
+    _allocate(width, height);
+    timer.addPixels(static_cast<std::uint64_t>(width_) * height_);
+    {
+      StageTimer convertTimer("png.rgbaToHsla", static_cast<std::uint64_t>(width_) * height_);
+      rgbaToHsla(byteData.data(), imageData_, width_ * height_);
     }
 
     return true;
   }
 
-  bool PNG::writeToFile(string const & fileName) {
-    unsigned char *byteData = new unsigned char[width_ * height_ * 4];
+  bool PNG::readFromFileLazy(string const & fileName) {
+    StageTimer timer("png.read");
+    vector<unsigned char> byteData;
+    unsigned width, height;
+    unsigned error = decodeFile(byteData, width, height, fileName);
 
-    for (unsigned i = 0; i < width_ * height_; i++) {
-      hslaColor hsl;
-      hsl.h = imageData_[i].h;
-      hsl.s = imageData_[i].s;
-      hsl.l = imageData_[i].l;
-      hsl.a = imageData_[i].a;
+    if (error) {
+      cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << endl;
+      return false;
+    }
 
-      rgbaColor rgb = hsl2rgb(hsl);
+    _allocate(width, height);
+    timer.addPixels(static_cast<std::uint64_t>(width_) * height_);
+    rawData_.swap(byteData);
+    bandConverted_.assign((height_ + BAND_HEIGHT - 1) / BAND_HEIGHT, 0);
 
-      byteData[(i * 4)]     = rgb.r;
-      byteData[(i * 4) + 1] = rgb.g;
-      byteData[(i * 4) + 2] = rgb.b;
-      byteData[(i * 4) + 3] = rgb.a;
+    return true;
+  }
+
+  void PNG::_toRgba(vector<unsigned char> & byteData) const {
+    StageTimer timer("png.hslaToRgba", static_cast<std::uint64_t>(width_) * height_);
+    byteData.resize(static_cast<std::size_t>(width_) * height_ * 4);
+    Instrumentation::countAllocation(byteData.size());
+
+    if (rawData_.empty()) {
+      hslaToRgba(imageData_, byteData.data(), width_ * height_);
+    } else {
+      // bands that were never converted still hold exactly the decoded bytes
+      for (unsigned band = 0; band < bandConverted_.size(); band++) {
+        unsigned offset = band * BAND_HEIGHT * width_;
+        unsigned count = std::min(BAND_HEIGHT, height_ - (band * BAND_HEIGHT)) * width_;
+        if (bandConverted_[band]) {
+          hslaToRgba(imageData_ + offset, byteData.data() + (offset * 4), count);
+        } else {
+          std::copy(rawData_.begin() + (offset * 4), rawData_.begin() + ((offset + count) * 4), byteData.data() + (offset * 4));
+        }
+      }
     }
+  }
+
+  bool PNG::writeToFile(string const & fileName) {
+    StageTimer timer("png.write", static_cast<std::uint64_t>(width_) * height_);
+    vector<unsigned char> byteData;
+    _toRgba(byteData);
 
-    unsigned error = lodepng::encode(fileName, byteData, width_, height_);
+    unsigned error;
+    {
+      StageTimer encodeTimer("png.encode", static_cast<std::uint64_t>(width_) * height_);
+      error = lodepng::encode(fileName, byteData, width_, height_);
+    }
     if (error) {
       cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << endl;
     }
 
-    delete[] byteData;
     return (error == 0);
   }
 
+  bool PNG::writeToFile(string const & fileName, PNGEncoderOptions const & options) {
+    StageTimer timer("png.write", static_cast<std::uint64_t>(width_) * height_);
+    vector<unsigned char> byteData;
+    _toRgba(byteData);
+    StageTimer encodeTimer("png.encode", static_cast<std::uint64_t>(width_) * height_);
+    return writeRgbaPNG(fileName, byteData.data(), width_, height_, options, NULL);
+  }
+
+  bool PNG::writeToFile(string const & fileName, PNGEncoderOptions const & options, ParallelExecutor & executor) {
+    StageTimer timer("png.write", static_cast<std::uint64_t>(width_) * height_);
+    vector<unsigned char> byteData;
+    _toRgba(byteData);
+    StageTimer encodeTimer("png.encode", static_cast<std::uint64_t>(width_) * height_);
+    return writeRgbaPNG(fileName, byteData.data(), width_, height_, options, &executor);
+  }
+
+  bool PNG::openRawFile(string const & fileName, bool writeThrough) {
+    MappedFile * mapping = MappedFile::open(fileName, writeThrough);
+    if (mapping == NULL) { return false; }
+
+    RawImageHeader header;
+    bool valid = mapping->size() >= sizeof(header);
+    if (valid) {
+      std::memcpy(&header, mapping->data(), sizeof(header));
+      valid = std::equal(header.magic, header.magic + sizeof(header.magic), RAW_IMAGE_MAGIC) &&
+              header.byteOrder == RAW_IMAGE_BYTE_ORDER && header.pixelBytes == sizeof(HSLAPixel) &&
+              header.pixelOffset % sizeof(double) == 0 && header.pixelOffset <= mapping->size() &&
+              (mapping->size() - header.pixelOffset) / sizeof(HSLAPixel) >= static_cast<std::uint64_t>(header.width) * header.height;
+    }
+    if (!valid) {
+      cerr << "Not a raw image file (or written on a different kind of machine): " << fileName << endl;
+      delete mapping;
+      return false;
+    }
+
+    _freePixels();
+    width_ = header.width;
+    height_ = header.height;
+    imageData_ = reinterpret_cast<HSLAPixel *>(mapping->data() + header.pixelOffset);
+    mapping_ = mapping;
+    rawData_.clear();
+    bandConverted_.clear();
+    return true;
+  }
+
+  bool PNG::writeToRawFile(string const & fileName) const {
+    RawImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, RAW_IMAGE_MAGIC, sizeof(header.magic));
+    header.byteOrder = RAW_IMAGE_BYTE_ORDER;
+    header.pixelBytes = sizeof(HSLAPixel);
+    header.width = width_;
+    header.height = height_;
+    header.pixelOffset = sizeof(header);
+
+    // write to a temporary name first and rename it over the file: this
+    // image may be mapped from `fileName` itself, and truncating the file
+    // would pull the pages out from under it
+    std::string partialName = temporaryPath(fileName);
+    FILE * file = std::fopen(partialName.c_str(), "wb");
+    if (file == NULL) {
+      cerr << "Could not open " << partialName << " for writing" << endl;
+      return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    for (unsigned y = 0; ok && y < height_; y++) {
+      ok = std::fwrite(row(y), sizeof(HSLAPixel), width_, file) == width_;
+    }
+    ok = (std::fclose(file) == 0) && ok;
+    ok = ok && std::rename(partialName.c_str(), fileName.c_str()) == 0;
+
+    if (!ok) {
+      cerr << "Could not write " << fileName << endl;
+      std::remove(partialName.c_str());
+    }
+    return ok;
+  }
+
+  bool PNG::isMapped() const {
+    return mapping_ != NULL;
+  }
+
   unsigned int PNG::width() const {
     return width_;
   }
@@ -164,28 +394,38 @@ namespace uiuc {
   }
 
   void PNG::resize(unsigned int newWidth, unsigned int newHeight) {
+    _convertAll();
+
     // Create a new vector to store the image data for the new (resized) image
-    HSLAPixel * newImageData = new HSLAPixel[newWidth * newHeight];
+    HSLAPixel * newImageData = PixelPool::allocate(static_cast<std::size_t>(newWidth) * newHeight);
+    std::uninitialized_fill_n(newImageData, static_cast<std::size_t>(newWidth) * newHeight, HSLAPixel());
+    Instrumentation::countAllocation(static_cast<std::uint64_t>(newWidth) * newHeight * sizeof(HSLAPixel));
 
     // Copy the current data to the new image data, using the existing pixel
     // for coordinates within the bounds of the old image size
-    for (unsigned x = 0; x < newWidth; x++) {
-      for (unsigned y = 0; y < newHeight; y++) {
-        if (x < width_ && y < height_) {
-          HSLAPixel & oldPixel = this->getPixel(x, y);
-          HSLAPixel & newPixel = newImageData[ (x + (y * newWidth)) ];
-          newPixel = oldPixel;
-        }
-      }
+    unsigned copyWidth = std::min(width_, newWidth);
+    unsigned copyHeight = std::min(height_, newHeight);
+    for (unsigned y = 0; y < copyHeight; y++) {
+      std::copy(imageData_ + (y * width_), imageData_ + (y * width_) + copyWidth, newImageData + (y * newWidth));
     }
 
     // Clear the existing image
-    delete[] imageData_;
+    _freePixels();
 
     // Update the image to reflect the new image size and data
     width_ = newWidth;
     height_ = newHeight;
     imageData_ = newImageData;
+    rawData_.clear();
+    bandConverted_.clear();
+  }
+
+  void PNG::resize(unsigned int newWidth, unsigned int newHeight, ResampleFilter filter) {
+    *this = resample(*this, newWidth, newHeight, filter);
+  }
+
+  void PNG::resize(unsigned int newWidth, unsigned int newHeight, ResampleFilter filter, ParallelExecutor & executor) {
+    *this = resample(*this, newWidth, newHeight, filter, executor);
   }
 
   std::size_t PNG::computeHash() const {
@@ -206,6 +446,45 @@ namespace uiuc {
     return hash;
   }
 
+  std::uint64_t PNG::_hashBand(unsigned band) const {
+    unsigned y = band * BAND_HEIGHT;
+    unsigned rows = std::min(BAND_HEIGHT, height_ - y);
+    return fastHash64(row(y), static_cast<std::size_t>(rows) * width_ * sizeof(HSLAPixel), band);
+  }
+
+  std::uint64_t PNG::_combineBandHashes(vector<std::uint64_t> const & bandHashes) const {
+    vector<std::uint64_t> words;
+    words.reserve(bandHashes.size() + 1);
+    words.push_back((static_cast<std::uint64_t>(width_) << 32) | height_);
+    words.insert(words.end(), bandHashes.begin(), bandHashes.end());
+    return fastHash64(&words[0], words.size() * sizeof(std::uint64_t));
+  }
+
+  std::uint64_t PNG::computeFastHash() const {
+    unsigned bands = (height_ + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    vector<std::uint64_t> bandHashes(bands);
+    for (unsigned band = 0; band < bands; band++) {
+      bandHashes[band] = _hashBand(band);
+    }
+    return _combineBandHashes(bandHashes);
+  }
+
+  std::uint64_t PNG::computeFastHash(ParallelExecutor & executor) const {
+    unsigned bands = (height_ + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    vector<std::uint64_t> bandHashes(bands);
+
+    // tiles are whole bands, so each band (and its lazy conversion) belongs to one task
+    unsigned bandsPerTile = ParallelExecutor::tileRows(*this) / BAND_HEIGHT;
+    unsigned tiles = (bands + bandsPerTile - 1) / bandsPerTile;
+    executor.parallelFor(tiles, [&](unsigned int tile) {
+      unsigned bandEnd = std::min(bands, (tile + 1) * bandsPerTile);
+      for (unsigned band = tile * bandsPerTile; band < bandEnd; band++) {
+        bandHashes[band] = _hashBand(band);
+      }
+    });
+    return _combineBandHashes(bandHashes);
+  }
+
   std::ostream & operator << ( std::ostream& os, PNG const& png ) {
     os << "PNG(w=" << png.width() << ", h=" << png.height() << ", hash=" << std::hex << png.computeHash() << std::dec << ")";
     return os;
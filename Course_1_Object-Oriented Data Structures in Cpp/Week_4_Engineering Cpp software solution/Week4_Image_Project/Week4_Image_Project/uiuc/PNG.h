@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "HSLAPixel.h"
@@ -14,8 +15,51 @@
 using namespace std;
 
 namespace uiuc {
+  class ParallelExecutor;
+  class MappedFile;
+
+  /**
+    * Interpolation filters for scaling an image; see Resample.h.
+    */
+  enum class ResampleFilter {
+    Box,        /*< Average of the covered source pixels (nearest neighbour when enlarging) */
+    Bilinear,   /*< Linear interpolation (a tent filter when shrinking) */
+    Bicubic,    /*< Catmull-Rom cubic interpolation */
+    Lanczos3    /*< Windowed sinc with 3 lobes; sharpest, may ring slightly */
+  };
+
+  /**
+    * The PNG filter applied to each row before compression.
+    */
+  enum class PNGFilter {
+    None, Sub, Up, Average, Paeth,
+    MinSum      /*< Per row, whichever of the five gives the smallest sum of absolute values */
+  };
+
+  /**
+    * Encoder settings for writing PNG files.
+    */
+  struct PNGEncoderOptions {
+    /**
+      * Compression effort from 0 to 9. 0 only stores the data (fastest,
+      * largest), 1 only finds runs of repeated pixels, and higher levels
+      * search further back for matches. 6 is lodepng's default.
+      */
+    unsigned int level;
+
+    PNGFilter filter;   /*< Row filter */
+
+    PNGEncoderOptions() : level(6), filter(PNGFilter::MinSum) { }
+  };
+
   class PNG {
   public:
+    /**
+      * Number of rows in a band. Images read with readFromFileLazy are
+      * converted to HSL one band at a time.
+      */
+    static const unsigned int BAND_HEIGHT = 16;
+
     /**
       * Creates an empty PNG image.
       */
@@ -35,6 +79,13 @@ namespace uiuc {
       */
     PNG(PNG const & other);
 
+    /**
+      * Move constructor: creates a new PNG image that takes over the pixels
+      * of another, leaving the other image empty.
+      * @param other PNG to be moved from.
+      */
+    PNG(PNG && other);
+
     /**
       * Destructor: frees all memory associated with a given PNG object.
       * Invoked by the system.
@@ -49,7 +100,18 @@ namespace uiuc {
     PNG const & operator= (PNG const & other);
 
     /**
-      * Equality operator: checks if two images are the same.
+      * Move assignment operator: takes over the pixels of another image,
+      * leaving the other image empty.
+      * @param other Image to move into the current image.
+      * @return The current image for assignment chaining.
+      */
+    PNG const & operator= (PNG && other);
+
+    /**
+      * Equality operator: checks if two images are the same. Rows whose
+      * pixels are bitwise identical are compared with a single memcmp, so
+      * that comparing equal images runs at memory speed; see ImageDiff.h to
+      * find out where two images differ.
       * @param other Image to be checked.
       * @return Whether the current image is equal to the other image.
       */
@@ -71,6 +133,17 @@ namespace uiuc {
       */
     bool readFromFile(string const & fileName);
 
+    /**
+      * Reads in a PNG image from a file without converting it to HSL.
+      * The decoded RGBA bytes are kept, and each band of BAND_HEIGHT rows is
+      * converted the first time one of its pixels is accessed. Bands that
+      * are never accessed are written back by writeToFile byte-for-byte.
+      * Overwrites any current image content in the PNG.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromFileLazy(string const & fileName);
+
     /**
       * Writes a PNG image to a file.
       * @param fileName Name of the file to be written.
@@ -78,6 +151,55 @@ namespace uiuc {
       */
     bool writeToFile(string const & fileName);
 
+    /**
+      * Writes a PNG image to a file as 8-bit RGBA with the given encoder
+      * settings. The image data is compressed in blocks of about
+      * PNGWriter::FLUSH_BYTES; blocks are joined with zlib sync flushes, so
+      * the result is the same bytes PNGWriter produces.
+      * @param fileName Name of the file to be written.
+      * @param options Encoder settings.
+      * @return true, if the image was successfully written.
+      */
+    bool writeToFile(string const & fileName, PNGEncoderOptions const & options);
+
+    /**
+      * Writes a PNG image like writeToFile(fileName, options), filtering and
+      * compressing the blocks in parallel on `executor`. The file is
+      * identical to the serial one.
+      */
+    bool writeToFile(string const & fileName, PNGEncoderOptions const & options, ParallelExecutor & executor);
+
+    /**
+      * Opens an uncompressed raw image file (see RawImage.h) by mapping it
+      * into memory. The mapped pages become the pixels of the image, so
+      * nothing is decoded or copied up front.
+      * Overwrites any current image content in the PNG. Anything that
+      * reallocates the pixels later (assigning another image, reading
+      * another file, resize) detaches the image from the file.
+      * @param fileName Name of the file to be opened.
+      * @param writeThrough If true, changes to the pixels are written to the
+      *        file; otherwise the file is never modified.
+      * @return true, if the file was a valid raw image and was mapped.
+      */
+    bool openRawFile(string const & fileName, bool writeThrough = false);
+
+    /**
+      * Writes the image to an uncompressed raw image file (see RawImage.h)
+      * that openRawFile can map. The pixels are stored exactly. The file is
+      * replaced as a whole, so this image may be mapped from `fileName`
+      * itself; it then keeps mapping the old contents.
+      * @param fileName Name of the file to be written.
+      * @return true, if the file was successfully written.
+      */
+    bool writeToRawFile(string const & fileName) const;
+
+    /**
+      * Checks whether the pixels of this image are a mapped raw image file.
+      * @return true, if the image was opened with openRawFile and has not
+      *         been detached since.
+      */
+    bool isMapped() const;
+
     /**
       * Pixel access operator. Gets a reference to the pixel at the given
       * coordinates in the image. (0,0) is the upper left corner.
@@ -88,6 +210,34 @@ namespace uiuc {
       */
     HSLAPixel & getPixel(unsigned int x, unsigned int y) const;
 
+    /**
+      * Row access. Gets a pointer to the first pixel of row `y`. The pixels
+      * of a row are contiguous, so the whole row is the range
+      * [row(y), row(y) + width()). Unlike getPixel, no bounds checking is
+      * done: `y` must be less than height().
+      * @param y Y-coordinate of the row.
+      * @return A pointer to the pixel at (0, y).
+      */
+    HSLAPixel * row(unsigned int y) const;
+
+    /**
+      * Calls `func(pixel, x, y)` for every pixel of the image, walking the
+      * pixel buffer in memory order (row by row, left to right). `pixel` is
+      * a reference into the image, so `func` may modify it.
+      * @param func Callable taking (HSLAPixel &, unsigned, unsigned).
+      */
+    template <typename Func>
+    void forEachPixel(Func func) const;
+
+    /**
+      * Calls `func(pixels, y, width)` for every row of the image, top to
+      * bottom, where `pixels` points to the first pixel of row `y` (see
+      * row). Useful for kernels that work better on a whole row at a time.
+      * @param func Callable taking (HSLAPixel *, unsigned, unsigned).
+      */
+    template <typename Func>
+    void forEachRow(Func func) const;
+
     /**
       * Gets the width of this image.
       * @return Width of the image.
@@ -109,24 +259,123 @@ namespace uiuc {
       */
     void resize(unsigned int newWidth, unsigned int newHeight);
 
+    /**
+      * Scales the image to the given size, interpolating with `filter`.
+      * Unlike resize(newWidth, newHeight), the whole image is kept.
+      * @param newWidth New width of the image.
+      * @param newHeight New height of the image.
+      * @param filter Interpolation filter.
+      */
+    void resize(unsigned int newWidth, unsigned int newHeight, ResampleFilter filter);
+
+    /**
+      * Scales the image like resize(newWidth, newHeight, filter), using
+      * `executor`.
+      */
+    void resize(unsigned int newWidth, unsigned int newHeight, ResampleFilter filter, ParallelExecutor & executor);
+
     /**
      * Computes a hash of the contents of the image.
      */
     std::size_t computeHash() const;
 
+    /**
+     * Computes a 64-bit hash of the contents of the image, suitable as a
+     * cache key. The pixel buffer is hashed one band of BAND_HEIGHT rows at
+     * a time with fastHash64, and the band hashes are hashed together with
+     * the dimensions. Images whose pixels are bit-for-bit identical always
+     * hash the same. This is much faster than computeHash and does not
+     * narrow channels to float, but gives different values.
+     * @return The hash.
+     */
+    std::uint64_t computeFastHash() const;
+
+    /**
+     * Computes the same hash as computeFastHash(), hashing the bands in
+     * parallel on `executor`.
+     * @param executor Executor to hash the bands on.
+     * @return The hash.
+     */
+    std::uint64_t computeFastHash(ParallelExecutor & executor) const;
+
   private:
     unsigned int width_;            /*< Width of the image */
     unsigned int height_;           /*< Height of the image */
-    HSLAPixel *imageData_;          /*< Array of pixels */
+    HSLAPixel *imageData_;          /*< Array of pixels, from PixelPool unless mapping_ is set */
+    MappedFile *mapping_;           /*< Raw image file imageData_ points into, NULL if imageData_ is owned */
     HSLAPixel defaultPixel_;        /*< Default pixel, returned in cases of errors */
+    vector<unsigned char> rawData_; /*< Decoded RGBA bytes of a lazily read image, empty otherwise */
+    mutable vector<unsigned char> bandConverted_; /*< Whether each band of a lazily read image is in imageData_ */
+
+    /**
+     * Converts band `band` of a lazily read image to HSL, if it has not
+     * been converted yet.
+     */
+    void _convertBand(unsigned band) const;
+
+    /**
+     * Converts every band of a lazily read image to HSL.
+     */
+    void _convertAll() const;
+
+    /**
+     * Hashes the pixels of band `band`, converting it first if needed.
+     */
+    std::uint64_t _hashBand(unsigned band) const;
+
+    /**
+     * Hashes the dimensions together with the hash of every band.
+     */
+    std::uint64_t _combineBandHashes(vector<std::uint64_t> const & bandHashes) const;
 
     /**
      * Copeies the contents of `other` to self
      */
      void _copy(PNG const & other);
+
+    /**
+     * Takes over the contents of `other`, leaving it empty
+     */
+     void _move(PNG & other);
+
+    /**
+     * Converts the image to 8-bit RGBA bytes, reusing the decoded bytes of
+     * bands of a lazily read image that were never converted.
+     */
+     void _toRgba(vector<unsigned char> & byteData) const;
+
+    /**
+     * Frees the pixel buffer, unmapping it if it belongs to a raw image
+     * file, and leaves imageData_ NULL.
+     */
+     void _freePixels();
+
+    /**
+     * Sets the dimensions of the image, keeping the current pixel buffer if
+     * it already holds exactly width * height pixels. Pixel values are left
+     * unspecified. Any lazily read data is dropped.
+     */
+     void _allocate(unsigned int width, unsigned int height);
   };
 
   std::ostream & operator<<(std::ostream & out, PNG const & pixel);
   std::stringstream & operator<<(std::stringstream & out, PNG const & pixel);
+
+  template <typename Func>
+  void PNG::forEachPixel(Func func) const {
+    for (unsigned y = 0; y < height_; y++) {
+      HSLAPixel * pixels = row(y);
+      for (unsigned x = 0; x < width_; x++) {
+        func(pixels[x], x, y);
+      }
+    }
+  }
+
+  template <typename Func>
+  void PNG::forEachRow(Func func) const {
+    for (unsigned y = 0; y < height_; y++) {
+      func(row(y), y, width_);
+    }
+  }
 }
 
@@ -0,0 +1,588 @@
+/**
+ * @file PNGStream.cpp
+ * Implementation of the row-by-row PNG reader and writer.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "lodepng/lodepng.h"
+#include "HSLAPixel.h"
+#include "ColorConversion.h"
+#include "Inflater.h"
+#include "PNGStream.h"
+#include "ParallelExecutor.h"
+
+namespace uiuc {
+  const unsigned int PNGWriter::FLUSH_BYTES;
+
+  namespace {
+    const unsigned char SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+    std::uint32_t read32(unsigned char const * bytes) {
+      return (static_cast<std::uint32_t>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+    }
+
+    void write32(unsigned char * bytes, std::uint32_t value) {
+      bytes[0] = value >> 24;
+      bytes[1] = value >> 16;
+      bytes[2] = value >> 8;
+      bytes[3] = value;
+    }
+
+    unsigned char paeth(int a, int b, int c) {
+      int p = a + b - c;
+      int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+      if (pa <= pb && pa <= pc) { return a; }
+      return (pb <= pc) ? b : c;
+    }
+
+    /**
+     * Deflate settings for a compression level (see PNGEncoderOptions);
+     * level 6 is lodepng's default.
+     */
+    LodePNGCompressSettings compressSettings(unsigned level) {
+      static const unsigned WINDOW[10] =     { 0, 8, 256, 512, 1024, 1024, 2048, 4096, 8192, 32768 };
+      static const unsigned NICE_MATCH[10] = { 0, 32, 32, 64, 64, 96, 128, 192, 258, 258 };
+
+      LodePNGCompressSettings settings;
+      lodepng_compress_settings_init(&settings);
+      level = std::min(level, 9u);
+      if (level == 0) {
+        settings.btype = 0;
+        settings.use_lz77 = 0;
+        return settings;
+      }
+
+      settings.windowsize = WINDOW[level];
+      settings.nicematch = NICE_MATCH[level];
+      settings.lazymatching = (level >= 4) ? 1 : 0;
+      return settings;
+    }
+
+    /**
+     * Appends the filter type byte and the filtered bytes of `line` (with
+     * `prior` as the row above) to `out`. `candidate` and `best` are scratch
+     * rows of the same size.
+     */
+    void filterScanline(unsigned char const * line, unsigned char const * prior, std::size_t stride, PNGFilter filter,
+                        std::vector<unsigned char> & candidate, std::vector<unsigned char> & best,
+                        std::vector<unsigned char> & out) {
+      unsigned char firstType = 0, lastType = 4;
+      if (filter != PNGFilter::MinSum) { firstType = lastType = static_cast<unsigned char>(filter); }
+
+      unsigned char bestType = 0;
+      unsigned long bestSum = 0;
+      for (unsigned char type = firstType; type <= lastType; type++) {
+        unsigned char * filtered = candidate.data();
+        for (std::size_t i = 0; i < stride; i++) {
+          int left = (i >= 4) ? line[i - 4] : 0;
+          int upperLeft = (i >= 4) ? prior[i - 4] : 0;
+          switch (type) {
+            case 0: filtered[i] = line[i]; break;
+            case 1: filtered[i] = line[i] - left; break;
+            case 2: filtered[i] = line[i] - prior[i]; break;
+            case 3: filtered[i] = line[i] - ((left + prior[i]) >> 1); break;
+            default: filtered[i] = line[i] - paeth(left, prior[i], upperLeft); break;
+          }
+        }
+
+        // bytes as signed values: small differences either way compress best
+        unsigned long sum = 0;
+        if (firstType != lastType) {
+          for (std::size_t i = 0; i < stride; i++) { sum += (filtered[i] < 128) ? filtered[i] : 256 - filtered[i]; }
+        }
+        if (type == firstType || sum < bestSum) {
+          bestSum = sum;
+          bestType = type;
+          candidate.swap(best);
+        }
+      }
+
+      out.push_back(bestType);
+      out.insert(out.end(), best.begin(), best.end());
+    }
+
+    /**
+     * Gets the number of rows PNGWriter collects before it compresses them.
+     */
+    unsigned rowsPerFlush(unsigned width) {
+      std::size_t filteredRow = (static_cast<std::size_t>(width) * 4) + 1;
+      return static_cast<unsigned>(std::max<std::size_t>(1, (PNGWriter::FLUSH_BYTES + filteredRow - 1) / filteredRow));
+    }
+
+    /**
+     * Gets the IHDR data of an 8-bit RGBA image.
+     */
+    void rgbaHeader(unsigned char * header, unsigned width, unsigned height) {
+      // 8-bit RGBA, deflate, adaptive filtering, not interlaced
+      unsigned char const fields[5] = { 8, 6, 0, 0, 0 };
+      write32(header, width);
+      write32(header + 4, height);
+      std::copy(fields, fields + 5, header + 8);
+    }
+
+    /**
+     * Gets the bytes of a PNG chunk, or an empty vector on failure.
+     */
+    std::vector<unsigned char> createChunk(char const * type, unsigned char const * data, std::size_t size) {
+      unsigned char * chunk = NULL;
+      std::size_t chunkSize = 0;
+      std::vector<unsigned char> result;
+      if (lodepng_chunk_create(&chunk, &chunkSize, size, type, data) == 0) {
+        result.assign(chunk, chunk + chunkSize);
+      }
+      std::free(chunk);
+      return result;
+    }
+  }
+
+  /*
+   * PNGReader
+   */
+
+  PNGReader::PNGReader()
+    : file_(NULL), width_(0), height_(0), colorType_(0), channels_(0), nextRow_(0), failed_(false),
+      idatLeft_(0), idatDone_(false), hasKey_(false), inflater_(NULL) { }
+
+  PNGReader::~PNGReader() {
+    close();
+  }
+
+  void PNGReader::close() {
+    if (file_ != NULL) { std::fclose(file_); }
+    file_ = NULL;
+    delete inflater_;
+    inflater_ = NULL;
+  }
+
+  unsigned int PNGReader::width() const {
+    return width_;
+  }
+
+  unsigned int PNGReader::height() const {
+    return height_;
+  }
+
+  unsigned int PNGReader::rowsRead() const {
+    return nextRow_;
+  }
+
+  bool PNGReader::good() const {
+    return file_ != NULL && !failed_;
+  }
+
+  bool PNGReader::_fail(std::string const & message) {
+    if (!failed_) { std::cerr << "PNGReader error: " << message << std::endl; }
+    failed_ = true;
+    return false;
+  }
+
+  bool PNGReader::_readChunkHeader(std::uint32_t & length, char type[5]) {
+    unsigned char header[8];
+    if (std::fread(header, 1, 8, file_) != 8) { return false; }
+    length = read32(header);
+    std::memcpy(type, header + 4, 4);
+    type[4] = '\0';
+    return length <= 0x7FFFFFFF;
+  }
+
+  bool PNGReader::open(std::string const & fileName) {
+    close();
+    width_ = height_ = nextRow_ = 0;
+    failed_ = false;
+    idatLeft_ = 0;
+    idatDone_ = false;
+    hasKey_ = false;
+    palette_.assign(256 * 4, 0);
+    for (unsigned i = 0; i < 256; i++) { palette_[i * 4 + 3] = 255; }
+
+    file_ = std::fopen(fileName.c_str(), "rb");
+    if (file_ == NULL) { return _fail("could not open " + fileName); }
+
+    unsigned char signature[8];
+    if (std::fread(signature, 1, 8, file_) != 8 || std::memcmp(signature, SIGNATURE, 8) != 0) {
+      return _fail(fileName + " is not a PNG file");
+    }
+
+    std::uint32_t length;
+    char type[5];
+    unsigned char header[13];
+    if (!_readChunkHeader(length, type) || std::strcmp(type, "IHDR") != 0 || length != 13 ||
+        std::fread(header, 1, 13, file_) != 13 || std::fseek(file_, 4, SEEK_CUR) != 0) {
+      return _fail("missing or broken IHDR chunk");
+    }
+
+    width_ = read32(header);
+    height_ = read32(header + 4);
+    colorType_ = header[9];
+    switch (colorType_) {
+      case 0: channels_ = 1; break;
+      case 2: channels_ = 3; break;
+      case 3: channels_ = 1; break;
+      case 4: channels_ = 2; break;
+      case 6: channels_ = 4; break;
+      default: return _fail("invalid color type");
+    }
+    if (width_ == 0 || height_ == 0) { return _fail("empty image"); }
+    if (header[8] != 8) { return _fail("only 8-bit images are supported; use PNG::readFromFile"); }
+    if (header[10] != 0 || header[11] != 0) { return _fail("unknown compression or filter method"); }
+    if (header[12] != 0) { return _fail("interlaced images are not supported; use PNG::readFromFile"); }
+
+    // read the chunks up to the first IDAT, keeping the ones that affect colors
+    bool hasPalette = false;
+    while (true) {
+      if (!_readChunkHeader(length, type)) { return _fail("unexpected end of file"); }
+      if (std::strcmp(type, "IDAT") == 0) { idatLeft_ = length; break; }
+      if (std::strcmp(type, "IEND") == 0) { return _fail("no image data"); }
+
+      if (std::strcmp(type, "PLTE") == 0 || std::strcmp(type, "tRNS") == 0) {
+        std::vector<unsigned char> data(length);
+        if (std::fread(data.data(), 1, length, file_) != length) { return _fail("unexpected end of file"); }
+
+        if (type[0] == 'P') {
+          if (length % 3 != 0 || length > 256 * 3) { return _fail("invalid palette"); }
+          for (unsigned i = 0; i < length / 3; i++) {
+            std::copy(&data[i * 3], &data[i * 3] + 3, &palette_[i * 4]);
+          }
+          hasPalette = true;
+        } else if (colorType_ == 3) {
+          if (length > 256) { return _fail("invalid tRNS chunk"); }
+          for (unsigned i = 0; i < length; i++) { palette_[i * 4 + 3] = data[i]; }
+        } else if (colorType_ == 0 || colorType_ == 2) {
+          if (length != 2 * channels_) { return _fail("invalid tRNS chunk"); }
+          for (unsigned i = 0; i < channels_; i++) { key_[i] = (data[i * 2] << 8) | data[i * 2 + 1]; }
+          hasKey_ = true;
+        }
+      } else if (std::fseek(file_, length, SEEK_CUR) != 0) {
+        return _fail("unexpected end of file");
+      }
+
+      if (std::fseek(file_, 4, SEEK_CUR) != 0) { return _fail("unexpected end of file"); }
+    }
+
+    if (colorType_ == 3 && !hasPalette) { return _fail("missing palette"); }
+
+    std::size_t stride = static_cast<std::size_t>(width_) * channels_;
+    previous_.assign(stride, 0);
+    current_.resize(stride + 1);
+    rgba_.resize(static_cast<std::size_t>(width_) * 4);
+    inflater_ = new Inflater([this](unsigned char * buffer, std::size_t size) {
+      return _readImageData(buffer, size);
+    });
+
+    return true;
+  }
+
+  std::size_t PNGReader::_readImageData(unsigned char * buffer, std::size_t size) {
+    // IDAT chunks have to be consecutive, so the data ends at the first other chunk
+    while (idatLeft_ == 0) {
+      std::uint32_t length;
+      char type[5];
+      if (idatDone_ || std::fseek(file_, 4, SEEK_CUR) != 0 ||
+          !_readChunkHeader(length, type) || std::strcmp(type, "IDAT") != 0) {
+        idatDone_ = true;
+        return 0;
+      }
+      idatLeft_ = length;
+    }
+
+    std::size_t count = std::fread(buffer, 1, std::min<std::size_t>(size, idatLeft_), file_);
+    if (count == 0) { idatDone_ = true; }
+    idatLeft_ -= count;
+    return count;
+  }
+
+  bool PNGReader::_unfilter() {
+    unsigned char * line = &current_[1];
+    unsigned char const * prior = previous_.data();
+    std::size_t stride = previous_.size();
+    unsigned bpp = channels_;
+
+    switch (current_[0]) {
+      case 0:
+        break;
+      case 1:
+        for (std::size_t i = bpp; i < stride; i++) { line[i] += line[i - bpp]; }
+        break;
+      case 2:
+        for (std::size_t i = 0; i < stride; i++) { line[i] += prior[i]; }
+        break;
+      case 3:
+        for (std::size_t i = 0; i < bpp; i++) { line[i] += prior[i] >> 1; }
+        for (std::size_t i = bpp; i < stride; i++) { line[i] += (line[i - bpp] + prior[i]) >> 1; }
+        break;
+      case 4:
+        for (std::size_t i = 0; i < bpp; i++) { line[i] += prior[i]; }
+        for (std::size_t i = bpp; i < stride; i++) { line[i] += paeth(line[i - bpp], prior[i], prior[i - bpp]); }
+        break;
+      default:
+        return _fail("invalid filter type");
+    }
+
+    std::copy(line, line + stride, previous_.begin());
+    return true;
+  }
+
+  void PNGReader::_toRGBA() {
+    unsigned char const * in = previous_.data();
+    unsigned char * out = rgba_.data();
+
+    for (unsigned x = 0; x < width_; x++, out += 4) {
+      switch (colorType_) {
+        case 0:
+          out[0] = out[1] = out[2] = in[x];
+          out[3] = (hasKey_ && in[x] == key_[0]) ? 0 : 255;
+          break;
+        case 2:
+          std::copy(in + x * 3, in + x * 3 + 3, out);
+          out[3] = (hasKey_ && out[0] == key_[0] && out[1] == key_[1] && out[2] == key_[2]) ? 0 : 255;
+          break;
+        case 3:
+          std::copy(&palette_[in[x] * 4], &palette_[in[x] * 4] + 4, out);
+          break;
+        case 4:
+          out[0] = out[1] = out[2] = in[x * 2];
+          out[3] = in[x * 2 + 1];
+          break;
+        default:
+          std::copy(in + x * 4, in + x * 4 + 4, out);
+          break;
+      }
+    }
+  }
+
+  unsigned int PNGReader::readRows(HSLAPixel * pixels, unsigned int rows) {
+    if (!good()) { return 0; }
+    rows = std::min(rows, height_ - nextRow_);
+
+    for (unsigned i = 0; i < rows; i++) {
+      if (inflater_->read(current_.data(), current_.size()) != current_.size()) {
+        _fail(inflater_->error() != NULL ? inflater_->error() : "image data ends early");
+        return i;
+      }
+      if (!_unfilter()) { return i; }
+
+      _toRGBA();
+      rgbaToHsla(rgba_.data(), pixels + (static_cast<std::size_t>(i) * width_), width_);
+      nextRow_++;
+    }
+
+    if (rows > 0 && nextRow_ == height_) {
+      // read on to the end of the stream so its checksum gets verified
+      unsigned char extra;
+      if (inflater_->read(&extra, 1) != 0) {
+        _fail("too much image data");
+      } else if (!inflater_->finished()) {
+        _fail(inflater_->error() != NULL ? inflater_->error() : "image data ends early");
+      }
+    }
+
+    return rows;
+  }
+
+  /*
+   * PNGWriter
+   */
+
+  PNGWriter::PNGWriter()
+    : file_(NULL), width_(0), height_(0), nextRow_(0), failed_(false), started_(false), adler_(1),
+      settings_(compressSettings(PNGEncoderOptions().level)), filter_(PNGFilter::MinSum) { }
+
+  PNGWriter::~PNGWriter() {
+    if (file_ != NULL) { close(); }
+  }
+
+  bool PNGWriter::_fail(std::string const & message) {
+    if (!failed_) { std::cerr << "PNGWriter error: " << message << std::endl; }
+    failed_ = true;
+    return false;
+  }
+
+  bool PNGWriter::_writeChunk(char const * type, unsigned char const * data, std::size_t size) {
+    std::vector<unsigned char> chunk = createChunk(type, data, size);
+    bool written = (!chunk.empty() && std::fwrite(chunk.data(), 1, chunk.size(), file_) == chunk.size());
+
+    if (!written) { return _fail(std::string("could not write ") + type + " chunk"); }
+    return true;
+  }
+
+  bool PNGWriter::open(std::string const & fileName, unsigned int width, unsigned int height,
+                       PNGEncoderOptions const & options) {
+    if (file_ != NULL) { close(); }
+    width_ = width;
+    height_ = height;
+    settings_ = compressSettings(options.level);
+    filter_ = options.filter;
+    nextRow_ = 0;
+    failed_ = false;
+    started_ = false;
+    adler_ = 1;
+
+    std::size_t stride = static_cast<std::size_t>(width) * 4;
+    previous_.assign(stride, 0);
+    current_.resize(stride);
+    candidate_.resize(stride);
+    best_.resize(stride);
+    pending_.clear();
+
+    file_ = std::fopen(fileName.c_str(), "wb");
+    if (file_ == NULL) { return _fail("could not create " + fileName); }
+
+    unsigned char header[13];
+    rgbaHeader(header, width, height);
+
+    if (std::fwrite(SIGNATURE, 1, 8, file_) != 8) { return _fail("could not write to " + fileName); }
+    return _writeChunk("IHDR", header, 13);
+  }
+
+  void PNGWriter::_filterRow() {
+    filterScanline(current_.data(), previous_.data(), current_.size(), filter_, candidate_, best_, pending_);
+  }
+
+  bool PNGWriter::writeRows(HSLAPixel const * pixels, unsigned int rows) {
+    if (file_ == NULL || failed_) { return false; }
+    if (rows > height_ - nextRow_) { return _fail("more rows than the image height"); }
+
+    for (unsigned i = 0; i < rows; i++) {
+      hslaToRgba(pixels + (static_cast<std::size_t>(i) * width_), current_.data(), width_);
+      _filterRow();
+      previous_.swap(current_);
+      nextRow_++;
+
+      // the same blocks as writeRgbaPNG
+      if (nextRow_ % rowsPerFlush(width_) == 0 && nextRow_ != height_ && !_flush(false)) { return false; }
+    }
+
+    return true;
+  }
+
+  bool PNGWriter::_flush(bool last) {
+    std::vector<unsigned char> data;
+    if (!started_) {
+      // zlib header: deflate with a 32 KB window, no dictionary
+      data.push_back(0x78);
+      data.push_back(0x01);
+      started_ = true;
+    }
+
+    unsigned char * compressed = NULL;
+    std::size_t compressedSize = 0;
+    unsigned error = lodepng_deflate_partial(&compressed, &compressedSize, pending_.data(), pending_.size(), &settings_, last);
+    if (error) {
+      std::free(compressed);
+      return _fail(lodepng_error_text(error));
+    }
+    data.insert(data.end(), compressed, compressed + compressedSize);
+    std::free(compressed);
+
+    adler_ = updateAdler32(adler_, pending_.data(), pending_.size());
+    pending_.clear();
+
+    if (last) {
+      data.resize(data.size() + 4);
+      write32(&data[data.size() - 4], adler_);
+    }
+
+    return _writeChunk("IDAT", data.data(), data.size());
+  }
+
+  bool PNGWriter::close() {
+    if (file_ == NULL) { return false; }
+
+    if (!failed_ && nextRow_ != height_) {
+      _fail("only " + std::to_string(nextRow_) + " of " + std::to_string(height_) + " rows were written");
+    }
+    if (!failed_ && _flush(true)) {
+      _writeChunk("IEND", NULL, 0);
+    }
+
+    if (std::fclose(file_) != 0) { _fail("could not finish writing the file"); }
+    file_ = NULL;
+    return !failed_;
+  }
+
+  /*
+   * writeRgbaPNG
+   */
+
+  bool writeRgbaPNG(std::string const & fileName, unsigned char const * rgba, unsigned int width, unsigned int height,
+                    PNGEncoderOptions const & options, ParallelExecutor * executor) {
+    LodePNGCompressSettings settings = compressSettings(options.level);
+    std::size_t stride = static_cast<std::size_t>(width) * 4;
+    unsigned blockRows = rowsPerFlush(width);
+    unsigned blocks = std::max(1u, (height + blockRows - 1) / blockRows);
+
+    std::vector<std::vector<unsigned char>> compressed(blocks);
+    std::vector<std::uint32_t> adlers(blocks);
+    std::vector<std::size_t> filteredSizes(blocks);
+    std::vector<unsigned> errors(blocks, 0);
+
+    auto encodeBlock = [&](unsigned int block) {
+      std::vector<unsigned char> zeros(stride, 0), candidate(stride), best(stride), filtered;
+      unsigned yEnd = std::min(height, (block + 1) * blockRows);
+      filtered.reserve((yEnd - block * blockRows) * (stride + 1));
+      for (unsigned y = block * blockRows; y < yEnd; y++) {
+        unsigned char const * prior = (y == 0) ? zeros.data() : rgba + ((y - 1) * stride);
+        filterScanline(rgba + (y * stride), prior, stride, options.filter, candidate, best, filtered);
+      }
+
+      unsigned char * out = NULL;
+      std::size_t outSize = 0;
+      errors[block] = lodepng_deflate_partial(&out, &outSize, filtered.data(), filtered.size(), &settings, block + 1 == blocks);
+      if (!errors[block]) { compressed[block].assign(out, out + outSize); }
+      std::free(out);
+
+      adlers[block] = updateAdler32(1, filtered.data(), filtered.size());
+      filteredSizes[block] = filtered.size();
+    };
+
+    if (executor != NULL) {
+      executor->parallelFor(blocks, encodeBlock);
+    } else {
+      for (unsigned block = 0; block < blocks; block++) { encodeBlock(block); }
+    }
+
+    for (unsigned block = 0; block < blocks; block++) {
+      if (errors[block]) {
+        std::cerr << "PNG encoding error " << errors[block] << ": " << lodepng_error_text(errors[block]) << std::endl;
+        return false;
+      }
+    }
+
+    std::uint32_t adler = adlers[0];
+    for (unsigned block = 1; block < blocks; block++) {
+      adler = combineAdler32(adler, adlers[block], filteredSizes[block]);
+    }
+
+    // one IDAT chunk per block, like PNGWriter; the zlib header goes in the
+    // first and the checksum in the last
+    unsigned char const zlibHeader[2] = { 0x78, 0x01 };
+    compressed.front().insert(compressed.front().begin(), zlibHeader, zlibHeader + 2);
+    compressed.back().resize(compressed.back().size() + 4);
+    write32(&compressed.back()[compressed.back().size() - 4], adler);
+
+    unsigned char header[13];
+    rgbaHeader(header, width, height);
+
+    std::vector<unsigned char> file(SIGNATURE, SIGNATURE + 8);
+    std::vector<unsigned char> chunk = createChunk("IHDR", header, 13);
+    file.insert(file.end(), chunk.begin(), chunk.end());
+    for (unsigned block = 0; block < blocks; block++) {
+      chunk = createChunk("IDAT", compressed[block].data(), compressed[block].size());
+      file.insert(file.end(), chunk.begin(), chunk.end());
+      std::vector<unsigned char>().swap(compressed[block]);
+    }
+    chunk = createChunk("IEND", NULL, 0);
+    file.insert(file.end(), chunk.begin(), chunk.end());
+
+    unsigned error = lodepng::save_file(file, fileName);
+    if (error) {
+      std::cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << std::endl;
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,270 @@
+/**
+ * @file PNGStream.h
+ * Row-by-row PNG reading and writing, for images too large to hold in
+ * memory as a whole.
+ *
+ * PNG::readFromFile decodes the complete file into RGBA bytes and then
+ * converts all of it to HSLAPixels. PNGReader and PNGWriter instead decode
+ * and encode a few rows at a time, so memory use only depends on the image
+ * width. streamTransform puts the two together to run a per-pixel kernel
+ * from one file to another.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "Inflater.h"
+#include "lodepng/lodepng.h"
+
+namespace uiuc {
+  class PNGReader {
+  public:
+    /**
+      * Creates a reader with no file open.
+      */
+    PNGReader();
+
+    /**
+      * Destructor: closes the file if one is open.
+      */
+    ~PNGReader();
+
+    PNGReader(PNGReader const & other) = delete;
+    PNGReader & operator= (PNGReader const & other) = delete;
+
+    /**
+      * Opens a PNG file and reads everything up to its image data. Only
+      * non-interlaced, 8-bit grayscale, RGB, palette, grayscale + alpha and
+      * RGBA files are supported; use PNG::readFromFile for anything else.
+      * @param fileName Name of the file to be read from.
+      * @return true if the file was opened and can be read.
+      */
+    bool open(std::string const & fileName);
+
+    /**
+      * Closes the file.
+      */
+    void close();
+
+    /**
+      * Gets the width of the image being read.
+      * @return Width of the image.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of the image being read.
+      * @return Height of the image.
+      */
+    unsigned int height() const;
+
+    /**
+      * Gets the number of rows read so far.
+      * @return The y coordinate of the next row to be read.
+      */
+    unsigned int rowsRead() const;
+
+    /**
+      * Checks whether everything read so far was valid.
+      * @return false if the file could not be opened or its data is broken.
+      */
+    bool good() const;
+
+    /**
+      * Reads the next `rows` rows of the image (fewer at its bottom).
+      * @param pixels Destination, width() * rows pixels in row-major order.
+      * @param rows Maximum number of rows to read.
+      * @return Number of rows read; 0 at the end of the image or on an error.
+      */
+    unsigned int readRows(HSLAPixel * pixels, unsigned int rows);
+
+  private:
+    std::FILE * file_;                        /*< The open file, or NULL */
+    unsigned int width_;                      /*< Width of the image */
+    unsigned int height_;                     /*< Height of the image */
+    unsigned int colorType_;                  /*< PNG color type of the file */
+    unsigned int channels_;                   /*< Bytes per pixel in the file */
+    unsigned int nextRow_;                    /*< Next row to be read */
+    bool failed_;                             /*< Whether an error was found */
+    std::uint32_t idatLeft_;                  /*< Bytes left in the current IDAT chunk */
+    bool idatDone_;                           /*< Whether all IDAT chunks were read */
+    std::vector<unsigned char> palette_;      /*< RGBA palette (color type 3) */
+    bool hasKey_;                             /*< Whether a transparent color is set (color types 0 and 2) */
+    unsigned int key_[3];                     /*< The transparent color */
+    std::vector<unsigned char> previous_;     /*< Previous row, unfiltered */
+    std::vector<unsigned char> current_;      /*< Filter type byte followed by the current row */
+    std::vector<unsigned char> rgba_;         /*< Current row converted to RGBA */
+    Inflater * inflater_;                     /*< Decompresses the IDAT data */
+
+    /**
+     * Reports an error and stops reading.
+     * @return false, for convenience.
+     */
+    bool _fail(std::string const & message);
+
+    /**
+     * Reads the length and type of the next chunk.
+     */
+    bool _readChunkHeader(std::uint32_t & length, char type[5]);
+
+    /**
+     * Fills `buffer` with up to `size` bytes of IDAT data; the Inflater's
+     * source.
+     */
+    std::size_t _readImageData(unsigned char * buffer, std::size_t size);
+
+    /**
+     * Undoes the filter of current_ and stores the row in previous_.
+     */
+    bool _unfilter();
+
+    /**
+     * Converts the row in previous_ to RGBA in rgba_.
+     */
+    void _toRGBA();
+  };
+
+  class PNGWriter {
+  public:
+    /**
+      * Amount of filtered image data collected before it is compressed.
+      * Each batch is compressed on its own, so larger batches compress
+      * slightly better but take more memory.
+      */
+    static const unsigned int FLUSH_BYTES = 256 * 1024;
+
+    /**
+      * Creates a writer with no file open.
+      */
+    PNGWriter();
+
+    /**
+      * Destructor: closes the file if one is open.
+      */
+    ~PNGWriter();
+
+    PNGWriter(PNGWriter const & other) = delete;
+    PNGWriter & operator= (PNGWriter const & other) = delete;
+
+    /**
+      * Creates an RGBA PNG file and writes its header.
+      * @param fileName Name of the file to be written.
+      * @param width Width of the image.
+      * @param height Height of the image.
+      * @param options Encoder settings.
+      * @return true if the file was created.
+      */
+    bool open(std::string const & fileName, unsigned int width, unsigned int height,
+              PNGEncoderOptions const & options = PNGEncoderOptions());
+
+    /**
+      * Appends `rows` rows to the image.
+      * @param pixels Source, width * rows pixels in row-major order.
+      * @param rows Number of rows to write.
+      * @return true if the rows were written.
+      */
+    bool writeRows(HSLAPixel const * pixels, unsigned int rows);
+
+    /**
+      * Finishes and closes the file.
+      * @return true if every row of the image was written successfully.
+      */
+    bool close();
+
+  private:
+    std::FILE * file_;                        /*< The open file, or NULL */
+    unsigned int width_;                      /*< Width of the image */
+    unsigned int height_;                     /*< Height of the image */
+    unsigned int nextRow_;                    /*< Next row to be written */
+    bool failed_;                             /*< Whether an error occurred */
+    bool started_;                            /*< Whether any IDAT data was written */
+    std::uint32_t adler_;                     /*< Adler-32 of the filtered data so far */
+    LodePNGCompressSettings settings_;        /*< Deflate settings */
+    PNGFilter filter_;                        /*< Row filter */
+    std::vector<unsigned char> previous_;     /*< Previous row as RGBA */
+    std::vector<unsigned char> current_;      /*< Current row as RGBA */
+    std::vector<unsigned char> candidate_;    /*< Current row with the filter being tried */
+    std::vector<unsigned char> best_;         /*< Current row with the best filter so far */
+    std::vector<unsigned char> pending_;      /*< Filtered rows not compressed yet */
+
+    /**
+     * Reports an error and stops writing.
+     * @return false, for convenience.
+     */
+    bool _fail(std::string const & message);
+
+    /**
+     * Writes one chunk to the file.
+     */
+    bool _writeChunk(char const * type, unsigned char const * data, std::size_t size);
+
+    /**
+     * Filters current_ against previous_ and appends it to pending_.
+     */
+    void _filterRow();
+
+    /**
+     * Compresses pending_ into an IDAT chunk.
+     * @param last Whether this is the end of the image data.
+     */
+    bool _flush(bool last);
+  };
+
+  /**
+    * Writes 8-bit RGBA pixels to a PNG file, producing exactly the bytes
+    * PNGWriter would for the same rows and options. The filtered image data
+    * is split into blocks of about PNGWriter::FLUSH_BYTES that are filtered
+    * and compressed independently, so with an executor they are encoded in
+    * parallel.
+    * @param fileName Name of the file to be written.
+    * @param rgba The pixels, width * height * 4 bytes in row-major order.
+    * @param width Width of the image.
+    * @param height Height of the image.
+    * @param options Encoder settings.
+    * @param executor Executor to encode the blocks on, or NULL to encode
+    *        them on the calling thread.
+    * @return true if the file was written.
+    */
+  bool writeRgbaPNG(std::string const & fileName, unsigned char const * rgba, unsigned int width, unsigned int height,
+                    PNGEncoderOptions const & options, ParallelExecutor * executor);
+
+  /**
+    * Reads `inFile` a band of rows at a time, calls `func(pixel, x, y)` on
+    * every pixel of the band and writes the result to `outFile`. Only about
+    * PNG::BAND_HEIGHT rows of the image are held in memory at any time.
+    * @param inFile Name of the file to be read from.
+    * @param outFile Name of the file to be written.
+    * @param func Callable taking (HSLAPixel &, unsigned, unsigned).
+    * @return true if the whole image was read and written.
+    */
+  template <typename Func>
+  bool streamTransform(std::string const & inFile, std::string const & outFile, Func func) {
+    PNGReader reader;
+    if (!reader.open(inFile)) { return false; }
+
+    PNGWriter writer;
+    if (!writer.open(outFile, reader.width(), reader.height())) { return false; }
+
+    std::vector<HSLAPixel> band(reader.width() * PNG::BAND_HEIGHT);
+    unsigned y = 0, rows;
+    while ((rows = reader.readRows(band.data(), PNG::BAND_HEIGHT)) > 0) {
+      for (unsigned i = 0; i < rows; i++) {
+        HSLAPixel * pixels = band.data() + (i * reader.width());
+        for (unsigned x = 0; x < reader.width(); x++) {
+          func(pixels[x], x, y + i);
+        }
+      }
+
+      if (!writer.writeRows(band.data(), rows)) { return false; }
+      y += rows;
+    }
+
+    bool written = writer.close();
+    return reader.good() && written;
+  }
+}
@@ -0,0 +1,114 @@
+/**
+ * @file ParallelExecutor.cpp
+ * Implementation of the row-tile thread pool.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ParallelExecutor.h"
+
+namespace uiuc {
+  const unsigned int ParallelExecutor::TILE_BYTES;
+
+  ParallelExecutor::ParallelExecutor(unsigned int threads)
+    : task_(NULL), count_(0), next_(0), job_(0), busy_(0), stop_(false) {
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 1; i < threads; i++) {
+      workers_.push_back(std::thread(&ParallelExecutor::_workerLoop, this));
+    }
+  }
+
+  ParallelExecutor::~ParallelExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (unsigned i = 0; i < workers_.size(); i++) {
+      workers_[i].join();
+    }
+  }
+
+  unsigned int ParallelExecutor::threads() const {
+    return workers_.size() + 1;
+  }
+
+  void ParallelExecutor::parallelFor(unsigned int count, std::function<void(unsigned int)> const & task) {
+    std::lock_guard<std::mutex> call(callMutex_);
+
+    if (workers_.empty() || count <= 1) {
+      for (unsigned i = 0; i < count; i++) { task(i); }
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      count_ = count;
+      next_ = 0;
+      busy_ = workers_.size();
+      job_++;
+    }
+    wake_.notify_all();
+
+    // the calling thread works on the job too
+    _runTasks();
+
+    // every worker checks in once per job, so `task` outlives all uses of it
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return busy_ == 0; });
+    task_ = NULL;
+  }
+
+  unsigned int ParallelExecutor::tileRows(PNG const & image) {
+    unsigned rowBytes = std::max(1u, image.width()) * sizeof(HSLAPixel);
+    unsigned rows = std::max(1u, TILE_BYTES / rowBytes);
+    return ((rows + PNG::BAND_HEIGHT - 1) / PNG::BAND_HEIGHT) * PNG::BAND_HEIGHT;
+  }
+
+  void ParallelExecutor::_runTasks() {
+    for (unsigned i = next_++; i < count_; i = next_++) {
+      (*task_)(i);
+    }
+  }
+
+  void ParallelExecutor::_workerLoop() {
+    unsigned seenJob = 0;
+
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || job_ != seenJob; });
+        if (stop_) { return; }
+        seenJob = job_;
+      }
+
+      _runTasks();
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_--;
+      }
+      done_.notify_one();
+    }
+  }
+
+  TaskRunner taskRunner(ParallelExecutor * executor) {
+    if (executor == NULL) {
+      return [](unsigned int count, std::function<void(unsigned int)> const & task) {
+        for (unsigned i = 0; i < count; i++) { task(i); }
+      };
+    }
+    return [executor](unsigned int count, std::function<void(unsigned int)> const & task) {
+      executor->parallelFor(count, task);
+    };
+  }
+}
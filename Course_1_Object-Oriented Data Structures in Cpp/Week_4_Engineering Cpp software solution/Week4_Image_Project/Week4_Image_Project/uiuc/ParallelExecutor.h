@@ -0,0 +1,147 @@
+/**
+ * @file ParallelExecutor.h
+ * A small thread pool that runs per-pixel kernels over a PNG in row tiles.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+
+namespace uiuc {
+  class ParallelExecutor {
+  public:
+    /**
+      * Approximate number of bytes of pixels in one tile, sized to stay
+      * within a core's L2 cache.
+      */
+    static const unsigned int TILE_BYTES = 256 * 1024;
+
+    /**
+      * Creates an executor that runs work on `threads` threads, including
+      * the calling thread.
+      * @param threads Number of threads; 0 uses one per hardware thread.
+      */
+    explicit ParallelExecutor(unsigned int threads = 0);
+
+    /**
+      * Destructor: stops and joins the worker threads.
+      */
+    ~ParallelExecutor();
+
+    ParallelExecutor(ParallelExecutor const & other) = delete;
+    ParallelExecutor & operator= (ParallelExecutor const & other) = delete;
+
+    /**
+      * Gets the number of threads work is spread across.
+      * @return Number of threads, including the calling thread.
+      */
+    unsigned int threads() const;
+
+    /**
+      * Calls `task(i)` once for every i in [0, count), spread across the
+      * threads of the executor, and returns once all calls have finished.
+      * Must not be called from inside a task.
+      * @param count Number of tasks.
+      * @param task Callable taking the task index.
+      */
+    void parallelFor(unsigned int count, std::function<void(unsigned int)> const & task);
+
+    /**
+      * Gets the number of rows per tile for an image: about TILE_BYTES of
+      * pixels, rounded up to a whole number of PNG bands so that a lazily
+      * read image never has two threads converting the same band.
+      * @param image The image to be split into tiles.
+      * @return Number of rows per tile.
+      */
+    static unsigned int tileRows(PNG const & image);
+
+    /**
+      * Calls `func(pixel, x, y)` for every pixel of the image, one tile of
+      * rows per task. Each pixel is visited exactly once by one thread, so
+      * the result is the same as PNG::forEachPixel as long as `func` only
+      * reads and writes the pixel it is given.
+      * @param image The image to be modified.
+      * @param func Callable taking (HSLAPixel &, unsigned, unsigned); it is
+      *        shared between threads, so calling it must not modify it.
+      */
+    template <typename Func>
+    void forEachPixel(PNG & image, Func const & func);
+
+    /**
+      * Calls `func(pixels, y, width)` for every row of the image, one tile
+      * of rows per task; see PNG::forEachRow.
+      * @param image The image to be modified.
+      * @param func Callable taking (HSLAPixel *, unsigned, unsigned); it is
+      *        shared between threads, so calling it must not modify it.
+      */
+    template <typename Func>
+    void forEachRow(PNG & image, Func const & func);
+
+  private:
+    std::vector<std::thread> workers_;                  /*< Worker threads (threads() - 1 of them) */
+    std::mutex mutex_;                                  /*< Guards everything below */
+    std::condition_variable wake_;                      /*< Signals workers that a job started or the pool stops */
+    std::condition_variable done_;                      /*< Signals the caller that all workers finished a job */
+    std::mutex callMutex_;                              /*< Serializes calls to parallelFor */
+    std::function<void(unsigned int)> const * task_;    /*< Task of the current job */
+    unsigned int count_;                                /*< Number of tasks in the current job */
+    std::atomic<unsigned int> next_;                    /*< Next task index to be claimed */
+    unsigned int job_;                                  /*< Incremented for every job */
+    unsigned int busy_;                                 /*< Workers that have not finished the current job */
+    bool stop_;                                         /*< Whether the workers should exit */
+
+    /**
+     * Claims and runs tasks of the current job until none are left.
+     */
+    void _runTasks();
+
+    /**
+     * Main loop of a worker thread.
+     */
+    void _workerLoop();
+  };
+
+  /**
+    * Runs `task(i)` for every i in [0, count), serially or on an executor,
+    * for code that splits its work into tasks either way.
+    */
+  typedef std::function<void(unsigned int, std::function<void(unsigned int)> const &)> TaskRunner;
+
+  /**
+    * Gets a TaskRunner for an executor.
+    * @param executor Executor whose parallelFor runs the tasks, or NULL to
+    *        run them in order on the calling thread.
+    * @return The runner; it refers to `executor`, which must outlive it.
+    */
+  TaskRunner taskRunner(ParallelExecutor * executor);
+
+  template <typename Func>
+  void ParallelExecutor::forEachPixel(PNG & image, Func const & func) {
+    forEachRow(image, [&](HSLAPixel * pixels, unsigned y, unsigned width) {
+      for (unsigned x = 0; x < width; x++) {
+        func(pixels[x], x, y);
+      }
+    });
+  }
+
+  template <typename Func>
+  void ParallelExecutor::forEachRow(PNG & image, Func const & func) {
+    unsigned rows = tileRows(image);
+    unsigned tiles = (image.height() + rows - 1) / rows;
+
+    parallelFor(tiles, [&](unsigned int tile) {
+      unsigned yEnd = std::min(image.height(), (tile + 1) * rows);
+      for (unsigned y = tile * rows; y < yEnd; y++) {
+        func(image.row(y), y, image.width());
+      }
+    });
+  }
+}
@@ -0,0 +1,145 @@
+/**
+ * @file PixelPool.cpp
+ * Implementation of the pixel buffer pool.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "PixelPool.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace uiuc {
+  const std::size_t PixelPool::HUGE_PAGE_BYTES;
+  const std::size_t PixelPool::DEFAULT_CAPACITY;
+
+  namespace {
+    const std::size_t CACHE_LINE_BYTES = 64;
+    const std::size_t SMALLEST_CLASS = 4096;
+
+    struct PoolState {
+      std::mutex mutex;                                   // guards everything below
+      std::map<std::size_t, std::vector<void *>> free;    // released buffers by size class
+      std::size_t capacity = PixelPool::DEFAULT_CAPACITY;
+      PixelPool::Statistics statistics = { 0, 0, 0, 0, 0 };
+    };
+
+    // Never destroyed, so images in static storage can still release their
+    // buffers while the program exits
+    PoolState & state() {
+      static PoolState * pool = new PoolState;
+      return *pool;
+    }
+
+    void * allocateClass(std::size_t classBytes) {
+      std::size_t alignment = (classBytes >= PixelPool::HUGE_PAGE_BYTES) ? PixelPool::HUGE_PAGE_BYTES : CACHE_LINE_BYTES;
+      void * memory = NULL;
+      if (posix_memalign(&memory, alignment, classBytes) != 0) { throw std::bad_alloc(); }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+      if (alignment == PixelPool::HUGE_PAGE_BYTES) { madvise(memory, classBytes, MADV_HUGEPAGE); }
+#endif
+      return memory;
+    }
+
+    // Frees released buffers, largest first, until at most `limit` bytes are kept
+    void shrinkTo(PoolState & pool, std::size_t limit) {
+      while (pool.statistics.cachedBytes > limit && !pool.free.empty()) {
+        std::map<std::size_t, std::vector<void *>>::iterator largest = --pool.free.end();
+        std::free(largest->second.back());
+        largest->second.pop_back();
+        pool.statistics.cachedBytes -= largest->first;
+        pool.statistics.cachedBuffers--;
+        if (largest->second.empty()) { pool.free.erase(largest); }
+      }
+    }
+  }
+
+  std::size_t PixelPool::sizeClass(std::size_t bytes) {
+    if (bytes < HUGE_PAGE_BYTES) {
+      std::size_t size = SMALLEST_CLASS;
+      while (size < bytes) { size *= 2; }
+      return size;
+    }
+
+    // steps of 1/8 of the power of two below `bytes`, in whole huge pages
+    std::size_t power = HUGE_PAGE_BYTES;
+    while (power <= bytes / 2) { power *= 2; }
+    std::size_t step = std::max(HUGE_PAGE_BYTES, power / 8);
+    return ((bytes + step - 1) / step) * step;
+  }
+
+  HSLAPixel * PixelPool::allocate(std::size_t count) {
+    if (count == 0) { return NULL; }
+    std::size_t classBytes = sizeClass(count * sizeof(HSLAPixel));
+
+    PoolState & pool = state();
+    {
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      std::map<std::size_t, std::vector<void *>>::iterator found = pool.free.find(classBytes);
+      if (found != pool.free.end()) {
+        void * memory = found->second.back();
+        found->second.pop_back();
+        if (found->second.empty()) { pool.free.erase(found); }
+        pool.statistics.cachedBytes -= classBytes;
+        pool.statistics.cachedBuffers--;
+        pool.statistics.reuses++;
+        return static_cast<HSLAPixel *>(memory);
+      }
+      pool.statistics.allocations++;
+    }
+
+    // the system allocation itself runs outside of the lock
+    return static_cast<HSLAPixel *>(allocateClass(classBytes));
+  }
+
+  void PixelPool::release(HSLAPixel * pixels, std::size_t count) {
+    if (pixels == NULL) { return; }
+    std::size_t classBytes = sizeClass(count * sizeof(HSLAPixel));
+
+    PoolState & pool = state();
+    {
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.statistics.releases++;
+      if (pool.statistics.cachedBytes + classBytes <= pool.capacity) {
+        pool.free[classBytes].push_back(pixels);
+        pool.statistics.cachedBytes += classBytes;
+        pool.statistics.cachedBuffers++;
+        return;
+      }
+    }
+    std::free(pixels);
+  }
+
+  void PixelPool::setCapacity(std::size_t bytes) {
+    PoolState & pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.capacity = bytes;
+    shrinkTo(pool, bytes);
+  }
+
+  void PixelPool::trim() {
+    PoolState & pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    shrinkTo(pool, 0);
+  }
+
+  PixelPool::Statistics PixelPool::statistics() {
+    PoolState & pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.statistics;
+  }
+
+  void PixelPool::resetStatistics() {
+    PoolState & pool = state();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.statistics.allocations = 0;
+    pool.statistics.reuses = 0;
+    pool.statistics.releases = 0;
+  }
+}
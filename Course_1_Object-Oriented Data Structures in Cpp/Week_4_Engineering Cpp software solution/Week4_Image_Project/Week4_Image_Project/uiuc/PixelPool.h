@@ -0,0 +1,130 @@
+/**
+ * @file PixelPool.h
+ * A process-wide pool of pixel buffers, so that images of the same size
+ * reuse each other's memory instead of going back to the operating system.
+ *
+ * A frame of a few megapixels is too large for the heap to recycle: every
+ * `new HSLAPixel[]` maps fresh pages, which are then faulted in one at a
+ * time, and every `delete[]` unmaps them again. The pool keeps released
+ * buffers instead, grouped by size class, and hands them out again to the
+ * next request of the same class. Large buffers are aligned to huge pages
+ * and, on Linux, marked for transparent huge pages, so a warm frame costs a
+ * few TLB entries rather than thousands.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "HSLAPixel.h"
+
+namespace uiuc {
+  class PixelPool {
+  public:
+    /**
+      * Size of a huge page. Buffers of at least this many bytes are aligned
+      * to it and their size classes are multiples of it.
+      */
+    static const std::size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+    /**
+      * Default limit on the bytes of released buffers kept for reuse.
+      */
+    static const std::size_t DEFAULT_CAPACITY = 1024 * 1024 * 1024;
+
+    /**
+      * Counters of the pool since the program started (or the last
+      * resetStatistics).
+      */
+    struct Statistics {
+      std::uint64_t allocations;    /*< Buffers obtained from the operating system */
+      std::uint64_t reuses;         /*< Requests served by a released buffer */
+      std::uint64_t releases;       /*< Buffers given back to the pool */
+      std::uint64_t cachedBuffers;  /*< Released buffers currently kept */
+      std::uint64_t cachedBytes;    /*< Bytes of the released buffers currently kept */
+    };
+
+    /**
+      * Gets a buffer of `count` pixels, reusing a released buffer of the
+      * same size class if there is one. The pixel values are unspecified.
+      * Safe to call from any thread.
+      * @param count Number of pixels.
+      * @return The buffer, or NULL if `count` is 0.
+      */
+    static HSLAPixel * allocate(std::size_t count);
+
+    /**
+      * Gives a buffer from allocate back to the pool. It is kept for reuse
+      * unless that would take the pool over its capacity, in which case it
+      * is freed. Safe to call from any thread.
+      * @param pixels The buffer; NULL is ignored.
+      * @param count Number of pixels it was allocated with.
+      */
+    static void release(HSLAPixel * pixels, std::size_t count);
+
+    /**
+      * Gets the number of bytes actually reserved for a buffer of `bytes`
+      * bytes: a power of two below HUGE_PAGE_BYTES, and above it a multiple
+      * of HUGE_PAGE_BYTES at most 1/8 larger than `bytes`.
+      */
+    static std::size_t sizeClass(std::size_t bytes);
+
+    /**
+      * Sets the limit on the bytes of released buffers kept for reuse, and
+      * frees buffers until the pool is within it. 0 turns caching off.
+      */
+    static void setCapacity(std::size_t bytes);
+
+    /**
+      * Frees every released buffer.
+      */
+    static void trim();
+
+    /**
+      * Gets the counters of the pool.
+      */
+    static Statistics statistics();
+
+    /**
+      * Sets the allocations, reuses and releases counters back to 0.
+      */
+    static void resetStatistics();
+  };
+
+  /**
+    * A standard allocator that takes its memory from the PixelPool, for
+    * buffers of other pixel types (e.g. `std::vector<FixedPixel,
+    * PixelPoolAllocator<FixedPixel>>`). Requests are rounded up to whole
+    * HSLAPixels, so `T` must not need a stricter alignment than HSLAPixel.
+    */
+  template <typename T>
+  struct PixelPoolAllocator {
+    typedef T value_type;
+
+    PixelPoolAllocator() { }
+
+    template <typename U>
+    PixelPoolAllocator(PixelPoolAllocator<U> const & other) { }
+
+    T * allocate(std::size_t count) {
+      return reinterpret_cast<T *>(PixelPool::allocate(_pixels(count)));
+    }
+
+    void deallocate(T * values, std::size_t count) {
+      PixelPool::release(reinterpret_cast<HSLAPixel *>(values), _pixels(count));
+    }
+
+    bool operator== (PixelPoolAllocator const & other) const { return true; }
+    bool operator!= (PixelPoolAllocator const & other) const { return false; }
+
+  private:
+    static_assert(alignof(T) <= alignof(HSLAPixel), "PixelPoolAllocator cannot align T");
+
+    /**
+     * Gets the number of HSLAPixels that hold `count` values of T.
+     */
+    static std::size_t _pixels(std::size_t count) {
+      return ((count * sizeof(T)) + sizeof(HSLAPixel) - 1) / sizeof(HSLAPixel);
+    }
+  };
+}
@@ -0,0 +1,174 @@
+/**
+ * @file PlanarPNG.cpp
+ * Implementation of a PNG image stored as separate h/s/l/a float planes.
+ */
+
+#include <iostream>
+#include <string>
+#include <cassert>
+#include "lodepng/lodepng.h"
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "PlanarPNG.h"
+#include "RGB_HSL.h"
+
+namespace uiuc {
+  PlanarPNG::PlanarPNG() {
+    width_ = 0;
+    height_ = 0;
+  }
+
+  PlanarPNG::PlanarPNG(unsigned int width, unsigned int height)
+    : width_(width), height_(height),
+      h_(static_cast<std::size_t>(width) * height), s_(static_cast<std::size_t>(width) * height),
+      l_(static_cast<std::size_t>(width) * height), a_(static_cast<std::size_t>(width) * height) { }
+
+  PlanarPNG::PlanarPNG(PNG const & image)
+    : PlanarPNG(image.width(), image.height()) {
+    for (unsigned y = 0; y < height_; y++) {
+      HSLAPixel const * pixels = image.row(y);
+      std::size_t offset = static_cast<std::size_t>(y) * width_;
+      for (unsigned x = 0; x < width_; x++) {
+        HSLAPixel const & pixel = pixels[x];
+        std::size_t i = offset + x;
+        h_[i] = pixel.h;
+        s_[i] = pixel.s;
+        l_[i] = pixel.l;
+        a_[i] = pixel.a;
+      }
+    }
+  }
+
+  PNG PlanarPNG::toPNG() const {
+    PNG image(width_, height_);
+    for (unsigned y = 0; y < height_; y++) {
+      HSLAPixel * pixels = image.row(y);
+      std::size_t offset = static_cast<std::size_t>(y) * width_;
+      for (unsigned x = 0; x < width_; x++) {
+        HSLAPixel & pixel = pixels[x];
+        std::size_t i = offset + x;
+        pixel.h = h_[i];
+        pixel.s = s_[i];
+        pixel.l = l_[i];
+        pixel.a = a_[i];
+      }
+    }
+    return image;
+  }
+
+  bool PlanarPNG::operator==(PlanarPNG const & other) const {
+    return width_ == other.width_ && height_ == other.height_ &&
+           h_ == other.h_ && s_ == other.s_ && l_ == other.l_ && a_ == other.a_;
+  }
+
+  bool PlanarPNG::operator!=(PlanarPNG const & other) const {
+    return !(*this == other);
+  }
+
+  bool PlanarPNG::readFromFile(string const & fileName) {
+    vector<unsigned char> byteData;
+    unsigned width, height;
+    unsigned error = lodepng::decode(byteData, width, height, fileName);
+
+    if (error) {
+      cerr << "PNG decoder error " << error << ": " << lodepng_error_text(error) << endl;
+      return false;
+    }
+
+    *this = PlanarPNG(width, height);
+
+    for (std::size_t i = 0; i < byteData.size(); i += 4) {
+      rgbaColor rgb;
+      rgb.r = byteData[i];
+      rgb.g = byteData[i + 1];
+      rgb.b = byteData[i + 2];
+      rgb.a = byteData[i + 3];
+
+      hslaColor hsl = rgb2hsl(rgb);
+      h_[i/4] = hsl.h;
+      s_[i/4] = hsl.s;
+      l_[i/4] = hsl.l;
+      a_[i/4] = hsl.a;
+    }
+
+    return true;
+  }
+
+  bool PlanarPNG::writeToFile(string const & fileName) const {
+    vector<unsigned char> byteData(h_.size() * 4);
+
+    for (std::size_t i = 0; i < h_.size(); i++) {
+      hslaColor hsl;
+      hsl.h = h_[i];
+      hsl.s = s_[i];
+      hsl.l = l_[i];
+      hsl.a = a_[i];
+
+      rgbaColor rgb = hsl2rgb(hsl);
+
+      byteData[(i * 4)]     = rgb.r;
+      byteData[(i * 4) + 1] = rgb.g;
+      byteData[(i * 4) + 2] = rgb.b;
+      byteData[(i * 4) + 3] = rgb.a;
+    }
+
+    unsigned error = lodepng::encode(fileName, byteData, width_, height_);
+    if (error) {
+      cerr << "PNG encoding error " << error << ": " << lodepng_error_text(error) << endl;
+    }
+
+    return (error == 0);
+  }
+
+  std::size_t PlanarPNG::_index(unsigned int x, unsigned int y) const {
+    if (width_ == 0 || height_ == 0) {
+      cerr << "ERROR: Call to uiuc::PlanarPNG::getPixel() made on an image with no pixels." << endl;
+      assert(width_ > 0);
+      assert(height_ > 0);
+    }
+
+    if (x >= width_) {
+      cerr << "WARNING: Call to uiuc::PlanarPNG tries to access x=" << x
+          << ", which is outside of the image (image width: " << width_ << ")." << endl;
+      x = width_ - 1;
+    }
+
+    if (y >= height_) {
+      cerr << "WARNING: Call to uiuc::PlanarPNG tries to access y=" << y
+          << ", which is outside of the image (image height: " << height_ << ")." << endl;
+      y = height_ - 1;
+    }
+
+    return x + (static_cast<std::size_t>(y) * width_);
+  }
+
+  HSLAPixel PlanarPNG::getPixel(unsigned int x, unsigned int y) const {
+    std::size_t i = _index(x, y);
+    return HSLAPixel(h_[i], s_[i], l_[i], a_[i]);
+  }
+
+  void PlanarPNG::setPixel(unsigned int x, unsigned int y, HSLAPixel const & pixel) {
+    std::size_t i = _index(x, y);
+    h_[i] = pixel.h;
+    s_[i] = pixel.s;
+    l_[i] = pixel.l;
+    a_[i] = pixel.a;
+  }
+
+  unsigned int PlanarPNG::width() const {
+    return width_;
+  }
+
+  unsigned int PlanarPNG::height() const {
+    return height_;
+  }
+
+  float * PlanarPNG::hue() { return h_.data(); }
+  float const * PlanarPNG::hue() const { return h_.data(); }
+  float * PlanarPNG::saturation() { return s_.data(); }
+  float const * PlanarPNG::saturation() const { return s_.data(); }
+  float * PlanarPNG::luminance() { return l_.data(); }
+  float const * PlanarPNG::luminance() const { return l_.data(); }
+  float * PlanarPNG::alpha() { return a_.data(); }
+  float const * PlanarPNG::alpha() const { return a_.data(); }
+}
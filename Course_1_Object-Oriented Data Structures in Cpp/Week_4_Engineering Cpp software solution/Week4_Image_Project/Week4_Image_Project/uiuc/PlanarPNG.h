@@ -0,0 +1,133 @@
+/**
+ * @file PlanarPNG.h
+ * A PNG image stored as four separate float planes (structure-of-arrays)
+ * instead of an array of HSLAPixels.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+
+using namespace std;
+
+namespace uiuc {
+  class PlanarPNG {
+  public:
+    /**
+      * Creates an empty planar image.
+      */
+    PlanarPNG();
+
+    /**
+      * Creates a planar image of the specified dimensions. Every channel
+      * of every pixel starts at 0.
+      * @param width Width of the new image.
+      * @param height Height of the new image.
+      */
+    PlanarPNG(unsigned int width, unsigned int height);
+
+    /**
+      * Creates a planar copy of a PNG image. Each channel is narrowed from
+      * double to float.
+      * @param image PNG to be copied.
+      */
+    explicit PlanarPNG(PNG const & image);
+
+    /**
+      * Converts this image back to an array-of-HSLAPixel PNG.
+      * @return A PNG with the same dimensions and pixel values.
+      */
+    PNG toPNG() const;
+
+    /**
+      * Equality operator: checks if two images are the same.
+      * @param other Image to be checked.
+      * @return Whether the current image is equal to the other image.
+      */
+    bool operator== (PlanarPNG const & other) const;
+
+    /**
+      * Inequality operator: checks if two images are different.
+      * @param other Image to be checked.
+      * @return Whether the current image differs from the other image.
+      */
+    bool operator!= (PlanarPNG const & other) const;
+
+    /**
+      * Reads in a PNG image from a file.
+      * Overwrites any current image content.
+      * @param fileName Name of the file to be read from.
+      * @return true, if the image was successfully read and loaded.
+      */
+    bool readFromFile(string const & fileName);
+
+    /**
+      * Writes the image to a PNG file.
+      * @param fileName Name of the file to be written.
+      * @return true, if the image was successfully written.
+      */
+    bool writeToFile(string const & fileName) const;
+
+    /**
+      * Gets a copy of the pixel at the given coordinates. Coordinates
+      * outside of the image are truncated to the nearest edge, as in
+      * PNG::getPixel.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @return The pixel at the given coordinates.
+      */
+    HSLAPixel getPixel(unsigned int x, unsigned int y) const;
+
+    /**
+      * Sets all four channels of the pixel at the given coordinates.
+      * @param x X-coordinate of the pixel.
+      * @param y Y-coordinate of the pixel.
+      * @param pixel The new pixel value.
+      */
+    void setPixel(unsigned int x, unsigned int y, HSLAPixel const & pixel);
+
+    /**
+      * Gets the width of this image.
+      * @return Width of the image.
+      */
+    unsigned int width() const;
+
+    /**
+      * Gets the height of this image.
+      * @return Height of the image.
+      */
+    unsigned int height() const;
+
+    /**
+      * Channel plane access. Each plane holds width() * height() values
+      * in row-major order, so the value for (x, y) is at x + y * width().
+      * @return A pointer to the first value of the plane.
+      */
+    float * hue();
+    float const * hue() const;
+    float * saturation();
+    float const * saturation() const;
+    float * luminance();
+    float const * luminance() const;
+    float * alpha();
+    float const * alpha() const;
+
+  private:
+    unsigned int width_;            /*< Width of the image */
+    unsigned int height_;           /*< Height of the image */
+    vector<float> h_;               /*< Hue plane */
+    vector<float> s_;               /*< Saturation plane */
+    vector<float> l_;               /*< Luminance plane */
+    vector<float> a_;               /*< Alpha plane */
+
+    /**
+     * Clamps (x, y) to the image, warning on cerr like PNG::getPixel.
+     * @return The plane index of the clamped coordinates.
+     */
+    std::size_t _index(unsigned int x, unsigned int y) const;
+  };
+}
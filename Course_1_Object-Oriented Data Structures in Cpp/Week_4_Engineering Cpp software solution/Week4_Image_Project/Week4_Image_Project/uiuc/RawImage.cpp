@@ -0,0 +1,65 @@
+/**
+ * @file RawImage.cpp
+ * Memory mapping of raw image files.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "RawImage.h"
+
+namespace uiuc {
+  static_assert(sizeof(RawImageHeader) == RAW_IMAGE_HEADER_BYTES, "RawImageHeader must not be padded");
+
+  std::string temporaryPath(std::string const & path) {
+    static std::atomic<unsigned long> counter(0);
+    return path + ".partial." + std::to_string(static_cast<long>(getpid())) + "." + std::to_string(counter++);
+  }
+
+  MappedFile * MappedFile::open(std::string const & fileName, bool shared) {
+    int fd = ::open(fileName.c_str(), shared ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Could not open " << fileName << ": " << std::strerror(errno) << std::endl;
+      return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      std::cerr << "Could not map " << fileName << ": empty or unreadable file" << std::endl;
+      ::close(fd);
+      return NULL;
+    }
+
+    // a private mapping may be written too; those pages are copied on write
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void * data = mmap(NULL, size, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    ::close(fd);   // the mapping keeps the file alive
+
+    if (data == MAP_FAILED) {
+      std::cerr << "Could not map " << fileName << ": " << std::strerror(errno) << std::endl;
+      return NULL;
+    }
+    return new MappedFile(static_cast<unsigned char *>(data), size);
+  }
+
+  MappedFile::MappedFile(unsigned char * data, std::size_t size) : data_(data), size_(size) { }
+
+  MappedFile::~MappedFile() {
+    munmap(data_, size_);
+  }
+
+  unsigned char * MappedFile::data() const {
+    return data_;
+  }
+
+  std::size_t MappedFile::size() const {
+    return size_;
+  }
+}
@@ -0,0 +1,87 @@
+/**
+ * @file RawImage.h
+ * An uncompressed on-disk format for PNG images that can be memory-mapped.
+ *
+ * A raw image file is a RawImageHeader followed directly by the pixels, row
+ * by row, exactly as a PNG holds them in memory (an array of HSLAPixels).
+ * Opening one therefore needs no decoding, no color conversion and no
+ * copy: the PNG uses the mapped pages as its pixel buffer. This makes the
+ * format a cheap way to hand intermediate images between processes; only
+ * the final result needs PNG encoding.
+ *
+ * Files are only readable on machines with the same byte order and double
+ * format as the writer, which the header records and checks.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace uiuc {
+  /**
+    * Header at the start of every raw image file. It is RAW_IMAGE_HEADER_BYTES
+    * long, so the pixels after it are aligned for HSLAPixel.
+    */
+  struct RawImageHeader {
+    char magic[8];              /*< RAW_IMAGE_MAGIC */
+    std::uint32_t byteOrder;    /*< RAW_IMAGE_BYTE_ORDER as written by the writer */
+    std::uint32_t pixelBytes;   /*< sizeof(HSLAPixel) of the writer */
+    std::uint32_t width;        /*< Width of the image */
+    std::uint32_t height;       /*< Height of the image */
+    std::uint64_t pixelOffset;  /*< Offset of the first pixel from the start of the file */
+    char reserved[32];          /*< Zero */
+  };
+
+  const char RAW_IMAGE_MAGIC[8] = { 'H', 'S', 'L', 'A', 'r', 'a', 'w', '1' };
+  const std::uint32_t RAW_IMAGE_BYTE_ORDER = 0x01020304;
+  const std::size_t RAW_IMAGE_HEADER_BYTES = 64;
+
+  /**
+    * Makes a name for a temporary file next to `path`, unique to this
+    * process and call, to write before renaming it over `path`. Readers
+    * (and mappings) of `path` then never see a partly written file.
+    * @param path Name of the file that will be replaced.
+    * @return `path` with a unique suffix.
+    */
+  std::string temporaryPath(std::string const & path);
+
+  /**
+    * A file mapped into memory; unmapped when destroyed.
+    */
+  class MappedFile {
+  public:
+    /**
+      * Maps the whole of an existing file.
+      * @param fileName Name of the file.
+      * @param shared If true, writes to the mapping go to the file (and to
+      *        every other process mapping it). If false, the mapping is
+      *        copy-on-write: it can still be written, but the file never
+      *        changes.
+      * @return The mapping, or NULL (with a message on cerr) on failure.
+      */
+    static MappedFile * open(std::string const & fileName, bool shared);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile const & other) = delete;
+    MappedFile & operator= (MappedFile const & other) = delete;
+
+    /**
+      * Gets the first byte of the mapping.
+      */
+    unsigned char * data() const;
+
+    /**
+      * Gets the size of the mapping, which is the size of the file.
+      */
+    std::size_t size() const;
+
+  private:
+    unsigned char * data_;      /*< Start of the mapping */
+    std::size_t size_;          /*< Length of the mapping */
+
+    MappedFile(unsigned char * data, std::size_t size);
+  };
+}
@@ -0,0 +1,282 @@
+/**
+ * @file Resample.cpp
+ * Implementation of separable two-pass image resampling.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "HSLAPixel.h"
+#include "PNG.h"
+#include "ParallelExecutor.h"
+#include "Resample.h"
+#include "Instrumentation.h"
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define UIUC_RESAMPLE_SIMD 1
+#endif
+
+namespace uiuc {
+  namespace {
+    const double PI = 3.14159265358979323846;
+
+    // Rows per task when a pass is split across threads: a single band rather
+    // than a tileRows tile, since every row costs many filter taps per pixel
+    // and smaller tasks balance better
+    const unsigned int ROWS_PER_TASK = PNG::BAND_HEIGHT;
+
+    /*
+     * Filters, as functions of the distance from the sample point in source
+     * pixels (widened when shrinking), and how far they reach.
+     */
+
+    double filterRadius(ResampleFilter filter) {
+      switch (filter) {
+        case ResampleFilter::Box:      return 0.5;
+        case ResampleFilter::Bilinear: return 1.0;
+        case ResampleFilter::Bicubic:  return 2.0;
+        case ResampleFilter::Lanczos3: return 3.0;
+      }
+      return 1.0;
+    }
+
+    double sinc(double x) {
+      if (x == 0) { return 1.0; }
+      x *= PI;
+      return std::sin(x) / x;
+    }
+
+    double filterWeight(ResampleFilter filter, double x) {
+      x = std::fabs(x);
+      switch (filter) {
+        case ResampleFilter::Box:
+          return (x <= 0.5) ? 1.0 : 0.0;
+        case ResampleFilter::Bilinear:
+          return (x < 1.0) ? 1.0 - x : 0.0;
+        case ResampleFilter::Bicubic:
+          // Catmull-Rom (a = -0.5)
+          if (x < 1.0) { return ((1.5 * x - 2.5) * x) * x + 1.0; }
+          if (x < 2.0) { return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0; }
+          return 0.0;
+        case ResampleFilter::Lanczos3:
+          return (x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+      }
+      return 0.0;
+    }
+
+    /**
+     * The source pixels and weights that make up each destination pixel
+     * along one axis. Destination pixel i is the weighted sum of source
+     * pixels [first[i], first[i] + count[i]) with weights starting at
+     * weights[i * taps]. Taps beyond the edges are folded onto the edge
+     * pixels, and the weights of every destination pixel add up to 1.
+     */
+    struct Contributions {
+      unsigned taps;
+      std::vector<unsigned> first;
+      std::vector<unsigned> count;
+      std::vector<float> weights;
+    };
+
+    Contributions computeContributions(unsigned sourceSize, unsigned destinationSize, ResampleFilter filter) {
+      double scale = static_cast<double>(sourceSize) / destinationSize;
+      double stretch = std::max(1.0, scale);                 // widen the filter when shrinking
+      double support = filterRadius(filter) * stretch;
+
+      Contributions result;
+      result.taps = static_cast<unsigned>(std::ceil(support * 2)) + 2;
+      result.first.resize(destinationSize);
+      result.count.resize(destinationSize);
+      result.weights.assign(static_cast<std::size_t>(destinationSize) * result.taps, 0.0f);
+
+      std::vector<double> weights(result.taps);
+      for (unsigned i = 0; i < destinationSize; i++) {
+        double center = (i + 0.5) * scale - 0.5;
+        long begin = static_cast<long>(std::floor(center - support));
+        long end = static_cast<long>(std::ceil(center + support));
+
+        long lo = std::min(std::max(begin, 0L), static_cast<long>(sourceSize) - 1);
+        long hi = std::min(std::max(end, 0L), static_cast<long>(sourceSize) - 1);
+        std::fill(weights.begin(), weights.end(), 0.0);
+
+        double total = 0;
+        for (long j = begin; j <= end; j++) {
+          double weight = filterWeight(filter, (j - center) / stretch);
+          long clamped = std::min(std::max(j, lo), hi);
+          weights[clamped - lo] += weight;
+          total += weight;
+        }
+
+        if (total == 0) {
+          // a box narrower than a pixel can miss every source pixel
+          long nearest = std::min(std::max(static_cast<long>(std::floor(center + 0.5)), lo), hi);
+          weights[nearest - lo] = 1.0;
+          total = 1.0;
+        }
+
+        result.first[i] = lo;
+        result.count[i] = hi - lo + 1;
+        for (unsigned k = 0; k < result.count[i]; k++) {
+          result.weights[(i * result.taps) + k] = static_cast<float>(weights[k] / total);
+        }
+      }
+      return result;
+    }
+
+    /*
+     * Conversions between HSLA and premultiplied RGBA in [0, 1], following
+     * rgb2hsl / hsl2rgb (RGB_HSL.h) but without rounding to bytes.
+     */
+
+    void hslaToPremultiplied(HSLAPixel const * pixels, float * rgba, unsigned count) {
+      for (unsigned i = 0; i < count; i++) {
+        HSLAPixel const & pixel = pixels[i];
+        double c = (1 - std::fabs((2 * pixel.l) - 1)) * pixel.s;
+        double hh = std::fmod(pixel.h, 360.0) / 60;
+        if (hh < 0) { hh += 6; }
+        double x = c * (1 - std::fabs(std::fmod(hh, 2) - 1));
+        double r, g, b;
+
+        if      (hh < 1) { r = c; g = x; b = 0; }
+        else if (hh < 2) { r = x; g = c; b = 0; }
+        else if (hh < 3) { r = 0; g = c; b = x; }
+        else if (hh < 4) { r = 0; g = x; b = c; }
+        else if (hh < 5) { r = x; g = 0; b = c; }
+        else             { r = c; g = 0; b = x; }
+
+        double m = pixel.l - (c * 0.5);
+        rgba[(i * 4)]     = static_cast<float>((r + m) * pixel.a);
+        rgba[(i * 4) + 1] = static_cast<float>((g + m) * pixel.a);
+        rgba[(i * 4) + 2] = static_cast<float>((b + m) * pixel.a);
+        rgba[(i * 4) + 3] = static_cast<float>(pixel.a);
+      }
+    }
+
+    void premultipliedToHsla(float const * rgba, HSLAPixel * pixels, unsigned count) {
+      for (unsigned i = 0; i < count; i++) {
+        // sharper filters overshoot, so clamp back into range
+        double a = std::min(std::max(static_cast<double>(rgba[(i * 4) + 3]), 0.0), 1.0);
+        double r = 0, g = 0, b = 0;
+        if (a > 0) {
+          r = std::min(std::max(rgba[(i * 4)] / a, 0.0), 1.0);
+          g = std::min(std::max(rgba[(i * 4) + 1] / a, 0.0), 1.0);
+          b = std::min(std::max(rgba[(i * 4) + 2] / a, 0.0), 1.0);
+        }
+
+        double min = std::min(std::min(r, g), b);
+        double max = std::max(std::max(r, g), b);
+        double chroma = max - min;
+
+        HSLAPixel & pixel = pixels[i];
+        pixel.a = a;
+        pixel.l = 0.5 * (max + min);
+        if (chroma < 0.0001 || max < 0.0001) {
+          pixel.h = pixel.s = 0;
+          continue;
+        }
+
+        pixel.s = chroma / (1 - std::fabs((2 * pixel.l) - 1));
+        if      (max == r) { pixel.h = std::fmod((g - b) / chroma, 6); }
+        else if (max == g) { pixel.h = ((b - r) / chroma) + 2; }
+        else               { pixel.h = ((r - g) / chroma) + 4; }
+        pixel.h *= 60;
+        if (pixel.h < 0) { pixel.h += 360; }
+      }
+    }
+
+    /*
+     * The two passes. Every pixel is four floats, which is one SSE register.
+     */
+
+    /** Filters one row of `sourceWidth` pixels into `contributions.first.size()` pixels */
+    void filterRow(float const * source, float * destination, Contributions const & contributions) {
+      unsigned width = contributions.first.size();
+      for (unsigned x = 0; x < width; x++) {
+        float const * pixel = source + (contributions.first[x] * 4);
+        float const * weights = &contributions.weights[x * contributions.taps];
+        unsigned count = contributions.count[x];
+#ifdef UIUC_RESAMPLE_SIMD
+        __m128 sum = _mm_setzero_ps();
+        for (unsigned k = 0; k < count; k++) {
+          sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(pixel + (k * 4))));
+        }
+        _mm_storeu_ps(destination + (x * 4), sum);
+#else
+        float sum[4] = { 0, 0, 0, 0 };
+        for (unsigned k = 0; k < count; k++) {
+          for (unsigned c = 0; c < 4; c++) { sum[c] += weights[k] * pixel[(k * 4) + c]; }
+        }
+        std::copy(sum, sum + 4, destination + (x * 4));
+#endif
+      }
+    }
+
+    /** Sums `count` rows of `floats` floats, starting at `rows`, `stride` floats apart */
+    void filterColumn(float const * rows, std::size_t stride, float const * weights, unsigned count,
+                      float * destination, unsigned floats) {
+      unsigned i = 0;
+#ifdef UIUC_RESAMPLE_SIMD
+      for (; i + 4 <= floats; i += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (unsigned k = 0; k < count; k++) {
+          sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(rows + (k * stride) + i)));
+        }
+        _mm_storeu_ps(destination + i, sum);
+      }
+#endif
+      for (; i < floats; i++) {
+        float sum = 0;
+        for (unsigned k = 0; k < count; k++) { sum += weights[k] * rows[(k * stride) + i]; }
+        destination[i] = sum;
+      }
+    }
+
+    PNG resampleWith(PNG const & image, unsigned width, unsigned height, ResampleFilter filter, TaskRunner const & run) {
+      if (width == image.width() && height == image.height()) { return image; }
+      StageTimer timer("resample", static_cast<std::uint64_t>(width) * height);
+
+      PNG result(width, height);
+      if (width == 0 || height == 0 || image.width() == 0 || image.height() == 0) { return result; }
+
+      Contributions horizontal = computeContributions(image.width(), width, filter);
+      Contributions vertical = computeContributions(image.height(), height, filter);
+
+      // pass 1: every source row, filtered to the new width
+      std::size_t stride = static_cast<std::size_t>(width) * 4;
+      std::vector<float> rows(stride * image.height());
+      unsigned sourceTasks = (image.height() + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+      run(sourceTasks, [&](unsigned int task) {
+        std::vector<float> premultiplied(static_cast<std::size_t>(image.width()) * 4);
+        unsigned yEnd = std::min(image.height(), (task + 1) * ROWS_PER_TASK);
+        for (unsigned y = task * ROWS_PER_TASK; y < yEnd; y++) {
+          hslaToPremultiplied(image.row(y), &premultiplied[0], image.width());
+          filterRow(&premultiplied[0], &rows[y * stride], horizontal);
+        }
+      });
+
+      // pass 2: every result row, from the rows of pass 1
+      unsigned resultTasks = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+      run(resultTasks, [&](unsigned int task) {
+        std::vector<float> row(stride);
+        unsigned yEnd = std::min(height, (task + 1) * ROWS_PER_TASK);
+        for (unsigned y = task * ROWS_PER_TASK; y < yEnd; y++) {
+          filterColumn(&rows[vertical.first[y] * stride], stride, &vertical.weights[y * vertical.taps],
+                       vertical.count[y], &row[0], stride);
+          premultipliedToHsla(&row[0], result.row(y), width);
+        }
+      });
+
+      return result;
+    }
+  }
+
+  PNG resample(PNG const & image, unsigned int width, unsigned int height, ResampleFilter filter) {
+    return resampleWith(image, width, height, filter, taskRunner(NULL));
+  }
+
+  PNG resample(PNG const & image, unsigned int width, unsigned int height, ResampleFilter filter,
+               ParallelExecutor & executor) {
+    return resampleWith(image, width, height, filter, taskRunner(&executor));
+  }
+}
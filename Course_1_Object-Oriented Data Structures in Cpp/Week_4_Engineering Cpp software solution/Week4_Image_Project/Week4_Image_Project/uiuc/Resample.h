@@ -0,0 +1,37 @@
+/**
+ * @file Resample.h
+ * Scaling a PNG to a new size with interpolation.
+ *
+ * Resampling is done as two separable passes, first along rows and then
+ * along columns. The weights of every output column and row are computed
+ * once up front. Pixels are filtered as premultiplied RGBA floats, four
+ * channels per SSE register, so that hues interpolate like colors do and
+ * transparent pixels do not bleed into their neighbours.
+ */
+
+#pragma once
+
+#include "HSLAPixel.h"
+#include "PNG.h"
+
+namespace uiuc {
+  class ParallelExecutor;
+
+  /**
+    * Resamples `image` to `width` x `height` pixels.
+    * Resampling to the same size returns an exact copy.
+    * @param image The source image.
+    * @param width Width of the result.
+    * @param height Height of the result.
+    * @param filter Interpolation filter.
+    * @return The resampled image.
+    */
+  PNG resample(PNG const & image, unsigned int width, unsigned int height, ResampleFilter filter);
+
+  /**
+    * Resamples `image` like resample above, with each pass split into row
+    * tiles on `executor`. The result is identical.
+    */
+  PNG resample(PNG const & image, unsigned int width, unsigned int height, ResampleFilter filter,
+               ParallelExecutor & executor);
+}
@@ -791,6 +791,17 @@ unsigned lodepng_deflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGCompressSettings* settings);
 
+/*
+CS 400 modification: like lodepng_deflate, but if last is 0 the output is not
+the end of the deflate stream. It then ends with an empty stored block (a sync
+flush) on a byte boundary, so the output of several calls can be concatenated
+into one stream, with last set to 1 only on the final call. Each call starts
+with an empty LZ77 window.
+*/
+unsigned lodepng_deflate_partial(unsigned char** out, size_t* outsize,
+                                 const unsigned char* in, size_t insize,
+                                 const LodePNGCompressSettings* settings, unsigned last);
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_ZLIB*/
 
@@ -4,8 +4,8 @@
 ZIP_FILE = ImageTransform_submission.zip
 COLLECTED_FILES = uiuc/HSLAPixel.h uiuc/HSLAPixel.cpp ImageTransform.h ImageTransform.cpp
 
-# Add standard object files (HSLAPixel, PNG, and LodePNG)
-OBJS += uiuc/HSLAPixel.o uiuc/PNG.o uiuc/lodepng/lodepng.o
+# Add standard object files (HSLAPixel, PNG, PlanarPNG, color conversion, parallel executor, streaming I/O, hashing, resampling, raw image files, instrumentation, pixel buffer pool, image diffs, image statistics, fixed-point images, and LodePNG)
+OBJS += uiuc/HSLAPixel.o uiuc/PNG.o uiuc/PlanarPNG.o uiuc/ColorConversion.o uiuc/ParallelExecutor.o uiuc/Inflater.o uiuc/PNGStream.o uiuc/FastHash.o uiuc/Resample.o uiuc/RawImage.o uiuc/Instrumentation.o uiuc/PixelPool.o uiuc/ImageDiff.o uiuc/ImageStatistics.o uiuc/FixedPixel.o uiuc/FixedPNG.o uiuc/lodepng/lodepng.o
 
 # Use ./.objs to store all .o file (keeping the directory clean)
 OBJS_DIR = .objs
@@ -16,6 +16,14 @@ CPP_TEST = $(wildcard tests/*.cpp)
 CPP_TEST += uiuc/catch/catchmain.cpp
 OBJS_TEST += $(CPP_TEST:.cpp=.o)
 
+# Use all .cpp files in /bench/ for the benchmark program, built with
+# optimizations in ./.objs-bench so they never mix with the debug objects
+OBJS_BENCH_DIR = .objs-bench
+OBJS_BENCH = $(filter-out $(EXE_OBJ), $(OBJS))
+CPP_BENCH = $(wildcard bench/*.cpp)
+OBJS_BENCH += $(CPP_BENCH:.cpp=.o)
+BENCH_JSON = bench-results.json
+
 # Config
 CXX_CLANG = clang++
 CXX_GNU = g++
@@ -29,6 +37,7 @@ STDLIBVERSION_GNU =   # blank on purpose; default GNU library
 STDLIBVERSION = $(STDLIBVERSION_GNU)
 WARNINGS = -pedantic -Wall -Wfatal-errors -Wextra -Wno-unused-parameter -Wno-unused-variable
 CXXFLAGS = $(CS400) $(STDVERSION) $(STDLIBVERSION) -g -O0 $(WARNINGS) -MMD -MP -msse2 -c
+BENCHFLAGS = $(CS400) $(STDVERSION) $(STDLIBVERSION) -O2 -DNDEBUG $(WARNINGS) -MMD -MP -msse2 -c
 LDFLAGS = $(CS400) $(STDVERSION) $(STDLIBVERSION) -lpthread
 ASANFLAGS = -fsanitize=address -fno-omit-frame-pointer
 
@@ -54,6 +63,15 @@ $(OBJS_DIR):
 $(OBJS_DIR)/%.o: %.cpp | $(OBJS_DIR)
 	$(CXX) $(CXXFLAGS) $< -o $@
 
+$(OBJS_BENCH_DIR):
+	@mkdir -p $(OBJS_BENCH_DIR)
+	@mkdir -p $(OBJS_BENCH_DIR)/uiuc
+	@mkdir -p $(OBJS_BENCH_DIR)/uiuc/lodepng
+	@mkdir -p $(OBJS_BENCH_DIR)/bench
+
+$(OBJS_BENCH_DIR)/%.o: %.cpp | $(OBJS_BENCH_DIR)
+	$(CXX) $(BENCHFLAGS) $< -o $@
+
 # Rules for executables
 $(TEST):
 	$(LD) $^ $(LDFLAGS) -o $@
@@ -61,9 +79,18 @@ $(TEST):
 	@echo " Built the test suite program: " $(TEST)
 	@echo ""
 
+$(BENCH):
+	$(LD) $^ $(LDFLAGS) -o $@
+
+# Rule for `bench`: builds and runs the benchmarks, saving the results as JSON
+# (pass e.g. BENCH_ARGS="--sizes 1,4 --filter grayscale" to narrow them down)
+bench: $(BENCH)
+	./$(BENCH) --json $(BENCH_JSON) $(BENCH_ARGS)
+
 # Executable dependencies
 $(EXE): $(patsubst %.o, $(OBJS_DIR)/%.o, $(OBJS))
 $(TEST): $(patsubst %.o, $(OBJS_DIR)/%.o, $(OBJS_TEST))
+$(BENCH): $(patsubst %.o, $(OBJS_BENCH_DIR)/%.o, $(OBJS_BENCH))
 
 # Include automatically generated dependencies
 -include $(OBJS_DIR)/*.d
@@ -71,9 +98,13 @@ $(TEST): $(patsubst %.o, $(OBJS_DIR)/%.o, $(OBJS_TEST))
 -include $(OBJS_DIR)/uiuc/catch/*.d
 -include $(OBJS_DIR)/uiuc/lodepng/*.d
 -include $(OBJS_DIR)/tests/*.d
+-include $(OBJS_BENCH_DIR)/*.d
+-include $(OBJS_BENCH_DIR)/uiuc/*.d
+-include $(OBJS_BENCH_DIR)/uiuc/lodepng/*.d
+-include $(OBJS_BENCH_DIR)/bench/*.d
 
 clean:
-	rm -rf $(EXE) $(TEST) $(OBJS_DIR) $(CLEAN_RM) $(ZIP_FILE)
+	rm -rf $(EXE) $(TEST) $(BENCH) $(OBJS_DIR) $(OBJS_BENCH_DIR) $(BENCH_JSON) $(CLEAN_RM) $(ZIP_FILE)
 
 tidy: clean
 	rm -rf doc
@@ -89,4 +120,4 @@ zip:
 	zip $(ZIP_FILE) $(COLLECTED_FILES)
 	@echo "Created zip file: " $(ZIP_FILE)
 
-.PHONY: all tidy clean zip
+.PHONY: all bench tidy clean zip